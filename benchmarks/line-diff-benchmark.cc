@@ -0,0 +1,150 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+
+// Compares LineDiff with the character based diff of diff_match_patch
+// on two versions of a song:
+//
+//   line-diff-benchmark [ITERATIONS] [SOURCE.sg TARGET.sg]
+//
+// Without files, a song of a few hundred lines with a few modified
+// chords and words is generated.
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+
+#include "diff_match_patch/diff_match_patch.h"
+#include "line-diff.hh"
+
+namespace // anonymous namespace
+{
+const int DefaultIterations = 200;
+
+QString readFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return QString();
+    return QString::fromUtf8(file.readAll());
+}
+
+QString generateSong(int verses)
+{
+    QString song("\\beginsong{Benchmark}[by={Patagui}]\n"
+                 "\\gtab{Am}{X02210}\n\\gtab{G}{320003}\n");
+    for (int verse = 0; verse < verses; ++verse) {
+        song += "\\beginverse\n";
+        for (int line = 0; line < 4; ++line)
+            song += QString("\\[Am]Line %1 of the \\[G]verse %2, "
+                            "with some \\[C]words\n")
+                        .arg(line + 1)
+                        .arg(verse + 1);
+        song += "\\endverse\n";
+    }
+    song += "\\endsong\n";
+    return song;
+}
+
+QString modifySong(const QString &song)
+{
+    QStringList lines = song.split('\n');
+    for (int i = lines.size() / 5; i < lines.size(); i += lines.size() / 4)
+        lines[i].replace("\\[G]", "\\[Em]").replace("words", "chords");
+    return lines.join("\n");
+}
+
+// diff_match_patch::diff_text2() without the copy of the diffs
+QString targetText(const QList<Diff> &diffs)
+{
+    QString text;
+    foreach (const Diff &diff, diffs)
+        if (diff.operation != DELETE)
+            text += diff.text;
+    return text;
+}
+
+void report(QTextStream &out, const QString &name, qint64 elapsed,
+            int iterations, int diffCount)
+{
+    out << QString("%1 %2 ms/diff, %3 diffs\n")
+               .arg(name, -24)
+               .arg(double(elapsed) / iterations, 0, 'f', 3)
+               .arg(diffCount);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QStringList arguments = application.arguments();
+    QTextStream out(stdout);
+
+    int iterations = DefaultIterations;
+    if (arguments.size() > 1)
+        iterations = qMax(1, arguments[1].toInt());
+
+    QString source;
+    QString target;
+    if (arguments.size() > 3) {
+        source = readFile(arguments[2]);
+        target = readFile(arguments[3]);
+    } else {
+        source = generateSong(60);
+        target = modifySong(source);
+    }
+    out << QString("%1 and %2 characters, %3 iterations\n")
+               .arg(source.size())
+               .arg(target.size())
+               .arg(iterations);
+
+    QElapsedTimer timer;
+    QList<Diff> diffs;
+
+    // a single LineDiff reuses its buffers, as in the RecoveryJournal
+    LineDiff lineDiff;
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        diffs = lineDiff.diff(source, target);
+    report(out, "LineDiff (reused)", timer.elapsed(), iterations,
+           diffs.size());
+    if (targetText(diffs) != target)
+        out << "LineDiff: wrong differences\n";
+
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        diffs = LineDiff().diff(source, target);
+    report(out, "LineDiff (new)", timer.elapsed(), iterations, diffs.size());
+
+    // the diffs computed by DiffDialog before LineDiff
+    diff_match_patch dmp;
+    dmp.Diff_Timeout = 1.0f;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        diffs = dmp.diff_main(source, target);
+        dmp.diff_cleanupSemantic(diffs);
+    }
+    report(out, "diff_match_patch", timer.elapsed(), iterations,
+           diffs.size());
+    if (targetText(diffs) != target)
+        out << "diff_match_patch: wrong differences\n";
+
+    return 0;
+}
@@ -0,0 +1,291 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "archive-extractor.hh"
+
+#ifdef ENABLE_LIBRARY_DOWNLOAD
+
+#include <cerrno>
+
+#include <QFile>
+#include <QNetworkReply>
+#include <QtConcurrent>
+
+#include <archive_entry.h>
+
+#include <QDebug>
+
+ArchiveExtractor::ArchiveExtractor(QObject *parent)
+    : QObject(parent)
+    , m_directory()
+    , m_reply(0)
+    , m_pool()
+    , m_watcher(new QFutureWatcher<bool>(this))
+    , m_mutex()
+    , m_dataAvailable()
+    , m_pendingData()
+    , m_block()
+    , m_endOfData(false)
+    , m_canceled(false)
+    , m_errorString()
+    , m_songs()
+{
+    // the worker waits for the network: it does not use the global pool
+    m_pool.setMaxThreadCount(1);
+    connect(m_watcher, SIGNAL(finished()), SLOT(extractionFinished()));
+}
+
+ArchiveExtractor::~ArchiveExtractor()
+{
+    cancel();
+    m_watcher->waitForFinished();
+}
+
+QDir ArchiveExtractor::directory() const { return m_directory; }
+
+void ArchiveExtractor::setDirectory(const QDir &directory)
+{
+    m_directory = directory;
+}
+
+bool ArchiveExtractor::isRunning() const { return m_watcher->isRunning(); }
+
+QStringList ArchiveExtractor::songs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_songs;
+}
+
+QString ArchiveExtractor::errorString() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_errorString;
+}
+
+void ArchiveExtractor::setErrorString(const QString &message)
+{
+    // the first error is the cause of the following ones
+    QMutexLocker locker(&m_mutex);
+    if (m_errorString.isEmpty())
+        m_errorString = message;
+}
+
+void ArchiveExtractor::extract(QNetworkReply *reply)
+{
+    cancel();
+    m_watcher->waitForFinished();
+    if (m_reply)
+        disconnect(m_reply, 0, this, 0);
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_pendingData.clear();
+        m_block.clear();
+        m_endOfData = false;
+        m_canceled = false;
+        m_errorString.clear();
+        m_songs.clear();
+    }
+
+    m_reply = reply;
+    connect(m_reply, SIGNAL(readyRead()), SLOT(readData()));
+    connect(m_reply, SIGNAL(finished()), SLOT(downloadFinished()));
+    m_watcher->setFuture(
+        QtConcurrent::run(&m_pool, this, &ArchiveExtractor::extractEntries));
+
+    if (m_reply->isFinished())
+        downloadFinished();
+}
+
+void ArchiveExtractor::readData()
+{
+    if (!m_reply)
+        return;
+
+    QByteArray data = m_reply->readAll();
+    if (data.isEmpty())
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    m_pendingData += data;
+    m_dataAvailable.wakeAll();
+}
+
+void ArchiveExtractor::downloadFinished()
+{
+    if (!m_reply)
+        return;
+
+    readData();
+    if (m_reply->error() != QNetworkReply::NoError) {
+        setErrorString(tr("Download of %1 failed: %2")
+                           .arg(m_reply->url().toString())
+                           .arg(m_reply->errorString()));
+        cancel();
+    }
+
+    disconnect(m_reply, 0, this, 0);
+    m_reply = 0;
+
+    QMutexLocker locker(&m_mutex);
+    m_endOfData = true;
+    m_dataAvailable.wakeAll();
+}
+
+void ArchiveExtractor::cancel()
+{
+    if (!isRunning())
+        return;
+
+    setErrorString(tr("The extraction was canceled"));
+
+    QMutexLocker locker(&m_mutex);
+    m_canceled = true;
+    m_dataAvailable.wakeAll();
+}
+
+void ArchiveExtractor::extractionFinished()
+{
+    emit(finished(m_watcher->result()));
+}
+
+la_ssize_t ArchiveExtractor::readBlock(struct archive *archive, void *data,
+                                       const void **buffer)
+{
+    ArchiveExtractor *extractor = static_cast<ArchiveExtractor *>(data);
+    QMutexLocker locker(&extractor->m_mutex);
+    while (extractor->m_pendingData.isEmpty() && !extractor->m_endOfData &&
+           !extractor->m_canceled)
+        extractor->m_dataAvailable.wait(&extractor->m_mutex);
+
+    if (extractor->m_canceled) {
+        archive_set_error(archive, ECANCELED, "%s",
+                          qPrintable(extractor->m_errorString));
+        return -1;
+    }
+
+    // libarchive uses the block until the next call
+    extractor->m_block.clear();
+    extractor->m_block.swap(extractor->m_pendingData);
+    *buffer = extractor->m_block.constData();
+    return extractor->m_block.size();
+}
+
+QString ArchiveExtractor::entryPath(struct archive_entry *entry) const
+{
+    QString name = QFile::decodeName(archive_entry_pathname(entry));
+    if (name.isEmpty() || QDir::isAbsolutePath(name))
+        return QString();
+
+    foreach (const QString &part, name.split('/'))
+        if (part == "..")
+            return QString();
+
+    return m_directory.absoluteFilePath(name);
+}
+
+bool ArchiveExtractor::extractEntries()
+{
+    struct archive *reader = archive_read_new();
+    archive_read_support_format_all(reader);
+    archive_read_support_filter_all(reader);
+
+    struct archive *writer = archive_write_disk_new();
+    archive_write_disk_set_options(writer, ARCHIVE_EXTRACT_TIME |
+                                               ARCHIVE_EXTRACT_PERM |
+                                               ARCHIVE_EXTRACT_SECURE_NODOTDOT);
+    archive_write_disk_set_standard_lookup(writer);
+
+    bool success = true;
+    if (archive_read_open(reader, this, 0, readBlock, 0) != ARCHIVE_OK) {
+        setErrorString(QString::fromLocal8Bit(archive_error_string(reader)));
+        success = false;
+    }
+
+    struct archive_entry *entry;
+    while (success) {
+        int result = archive_read_next_header(reader, &entry);
+        if (result == ARCHIVE_EOF)
+            break;
+
+        if (result < ARCHIVE_WARN) {
+            setErrorString(
+                QString::fromLocal8Bit(archive_error_string(reader)));
+            success = false;
+        } else {
+            success = extractEntry(reader, writer, entry);
+        }
+    }
+
+    archive_read_free(reader);
+    archive_write_free(writer);
+    return success;
+}
+
+bool ArchiveExtractor::extractEntry(struct archive *reader,
+                                    struct archive *writer,
+                                    struct archive_entry *entry)
+{
+    // only regular files and directories are extracted
+    QString path = entryPath(entry);
+    int type = archive_entry_filetype(entry);
+    if (path.isEmpty() || (type != AE_IFREG && type != AE_IFDIR) ||
+        archive_entry_hardlink(entry))
+        return archive_read_data_skip(reader) == ARCHIVE_OK;
+
+    archive_entry_copy_pathname(entry, QFile::encodeName(path).constData());
+
+    int result = archive_write_header(writer, entry);
+    if (result >= ARCHIVE_WARN && archive_entry_size(entry) > 0) {
+        const void *block;
+        size_t size;
+        la_int64_t offset;
+        while ((result = archive_read_data_block(reader, &block, &size,
+                                                 &offset)) == ARCHIVE_OK) {
+            if (archive_write_data_block(writer, block, size, offset) <
+                ARCHIVE_WARN) {
+                setErrorString(
+                    QString::fromLocal8Bit(archive_error_string(writer)));
+                return false;
+            }
+        }
+        if (result != ARCHIVE_EOF) {
+            setErrorString(
+                QString::fromLocal8Bit(archive_error_string(reader)));
+            return false;
+        }
+        result = ARCHIVE_OK;
+    }
+    if (result >= ARCHIVE_WARN)
+        result = archive_write_finish_entry(writer);
+    if (result < ARCHIVE_WARN) {
+        setErrorString(QString::fromLocal8Bit(archive_error_string(writer)));
+        return false;
+    }
+
+    if (type == AE_IFREG && path.endsWith(".sg")) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_songs << path;
+        }
+        emit(songExtracted(path));
+    }
+    return true;
+}
+
+#endif // ENABLE_LIBRARY_DOWNLOAD
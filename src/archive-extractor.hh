@@ -0,0 +1,159 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __ARCHIVE_EXTRACTOR_HH__
+#define __ARCHIVE_EXTRACTOR_HH__
+
+#include "config.hh"
+
+#ifdef ENABLE_LIBRARY_DOWNLOAD
+
+#include <QByteArray>
+#include <QDir>
+#include <QFutureWatcher>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <archive.h>
+
+class QNetworkReply;
+
+/*!
+  \file archive-extractor.hh
+  \class ArchiveExtractor
+  \brief ArchiveExtractor extracts an archive while it is downloaded
+
+  The data of a QNetworkReply is handed to libarchive as soon as it is
+  received: the archive is decompressed and its entries are written
+  into the destination directory by a worker thread while the rest of
+  the archive is being downloaded.
+
+  songExtracted() is emitted as soon as each song (.sg file) is written
+  so that songs may be processed before the download completes.
+
+  \code
+  ArchiveExtractor *extractor = new ArchiveExtractor(this);
+  extractor->setDirectory(MainWindow::_cachePath);
+  connect(extractor, SIGNAL(songExtracted(const QString &)),
+          SLOT(analyzeSong(const QString &)));
+  extractor->extract(manager->get(QNetworkRequest(url)));
+  \endcode
+
+  Since a QNetworkAccessManager also supports file:// urls, a local
+  archive may be extracted in the same way.
+
+  The entries are written relative to the destination directory: the
+  current directory of the application is never changed. Entries with
+  absolute paths or ".." components, links and special files are
+  skipped.
+*/
+class ArchiveExtractor : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    ArchiveExtractor(QObject *parent = 0);
+
+    /// Destructor: the pending extraction is canceled.
+    ~ArchiveExtractor();
+
+    /*!
+    Returns the directory the archive is extracted in.
+  */
+    QDir directory() const;
+
+    /*!
+    Sets \a directory as the directory the archive is extracted in.
+  */
+    void setDirectory(const QDir &directory);
+
+    /*!
+    Starts the extraction of the archive downloaded by \a reply.
+  */
+    void extract(QNetworkReply *reply);
+
+    /*!
+    Returns \a true while the archive is being extracted.
+  */
+    bool isRunning() const;
+
+    /*!
+    Returns the paths of the songs extracted so far.
+  */
+    QStringList songs() const;
+
+    /*!
+    Returns the description of the last error.
+  */
+    QString errorString() const;
+
+public slots:
+    /*!
+    Interrupts the extraction.
+  */
+    void cancel();
+
+signals:
+    /*!
+    This signal is emitted when the song \a path has been extracted.
+  */
+    void songExtracted(const QString &path);
+
+    /*!
+    This signal is emitted once the archive is extracted, with \a
+    success being \a false if the download or the extraction failed.
+  */
+    void finished(bool success);
+
+private slots:
+    void readData();
+    void downloadFinished();
+    void extractionFinished();
+
+private:
+    bool extractEntries();
+    bool extractEntry(struct archive *reader, struct archive *writer,
+                      struct archive_entry *entry);
+    QString entryPath(struct archive_entry *entry) const;
+    void setErrorString(const QString &message);
+
+    static la_ssize_t readBlock(struct archive *archive, void *data,
+                                const void **buffer);
+
+    QDir m_directory;
+    QNetworkReply *m_reply;
+    QThreadPool m_pool;
+    QFutureWatcher<bool> *m_watcher;
+
+    // data received from the network and not read by libarchive yet
+    mutable QMutex m_mutex;
+    QWaitCondition m_dataAvailable;
+    QByteArray m_pendingData;
+    QByteArray m_block;
+    bool m_endOfData;
+    bool m_canceled;
+    QString m_errorString;
+    QStringList m_songs;
+};
+
+#endif // ENABLE_LIBRARY_DOWNLOAD
+
+#endif // __ARCHIVE_EXTRACTOR_HH__
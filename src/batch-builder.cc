@@ -0,0 +1,428 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "batch-builder.hh"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonValue>
+#include <QRegExp>
+#include <QSettings>
+#include <QTextStream>
+#include <QThread>
+
+#include "library.hh"
+#include "patacrep.hh"
+#include "song-validator.hh"
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+void printError(const QString &message)
+{
+    QTextStream err(stderr);
+    err << QCoreApplication::applicationName() << ": " << message << endl;
+}
+}
+
+BatchBuilder::BatchBuilder(QObject *parent)
+    : QObject(parent)
+    , m_songbooks()
+    , m_outputDirectory(QDir::current())
+    , m_jobs(1)
+    , m_patacrep(0)
+    , m_logParser()
+    , m_currentSongbook()
+    , m_pendingSongbooks()
+    , m_workers()
+    , m_succeeded(0)
+    , m_failed(0)
+{
+}
+
+BatchBuilder::~BatchBuilder() {}
+
+bool BatchBuilder::isBatchMode(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+        if (qstrcmp(argv[i], "--build") == 0)
+            return true;
+    return false;
+}
+
+QString BatchBuilder::usage()
+{
+    return QString("    --build FILE.sb [FILE.sb ...]"
+                   "    build the songbooks without the graphical interface\n"
+                   "    -j, --jobs N"
+                   "    number of songbooks built in parallel (0: one per core)\n"
+                   "    -o, --output DIR"
+                   "    directory where the PDF files are produced\n");
+}
+
+bool BatchBuilder::parseArguments(const QStringList &arguments)
+{
+    bool songbookArguments = false;
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &argument = arguments[i];
+        if (argument == "--build") {
+            songbookArguments = true;
+        } else if (argument == "-j" || argument == "--jobs") {
+            bool ok = false;
+            if (i + 1 < arguments.size())
+                m_jobs = arguments[++i].toInt(&ok);
+            if (!ok || m_jobs < 0) {
+                printError(tr("invalid number of jobs"));
+                return false;
+            }
+            if (m_jobs == 0)
+                m_jobs = QThread::idealThreadCount();
+            songbookArguments = false;
+        } else if (argument == "-o" || argument == "--output") {
+            if (i + 1 >= arguments.size()) {
+                printError(tr("missing output directory"));
+                return false;
+            }
+            m_outputDirectory = QDir(arguments[++i]);
+            songbookArguments = false;
+        } else if (songbookArguments && !argument.startsWith("-")) {
+            QFileInfo fileInfo(argument);
+            if (!fileInfo.exists()) {
+                printError(tr("cannot find songbook: %1").arg(argument));
+                return false;
+            }
+            m_songbooks << fileInfo.absoluteFilePath();
+        } else {
+            printError(tr("unknown option: %1").arg(argument));
+            return false;
+        }
+    }
+
+    if (m_songbooks.isEmpty()) {
+        printError(tr("no songbook to build"));
+        return false;
+    }
+
+    if (!m_outputDirectory.exists() &&
+        !QDir().mkpath(m_outputDirectory.absolutePath())) {
+        printError(tr("cannot create output directory: %1")
+                       .arg(m_outputDirectory.absolutePath()));
+        return false;
+    }
+    m_outputDirectory = QDir(m_outputDirectory.absolutePath());
+    return true;
+}
+
+int BatchBuilder::exec()
+{
+    if (m_songbooks.size() > 1 && m_jobs > 1) {
+        m_pendingSongbooks = m_songbooks;
+        while (!m_pendingSongbooks.isEmpty() && m_workers.size() < m_jobs)
+            startWorker(m_pendingSongbooks.takeFirst());
+        return QCoreApplication::exec();
+    }
+
+    foreach (const QString &filename, m_songbooks) {
+        if (buildSongbook(filename))
+            ++m_succeeded;
+        else
+            ++m_failed;
+    }
+
+    if (m_songbooks.size() > 1) {
+        QJsonObject summary;
+        summary.insert("succeeded", m_succeeded);
+        summary.insert("failed", m_failed);
+        report("summary", QString(), summary);
+    }
+    return m_failed > 0 ? 1 : 0;
+}
+
+void BatchBuilder::report(const QString &event, const QString &filename,
+                          QJsonObject data)
+{
+    data.insert("event", event);
+    if (!filename.isEmpty())
+        data.insert("songbook", filename);
+
+    QTextStream out(stdout);
+    out << QJsonDocument(data).toJson(QJsonDocument::Compact) << endl;
+}
+
+bool BatchBuilder::buildSongbook(const QString &filename)
+{
+    QElapsedTimer timer;
+    timer.start();
+    report("start", filename);
+
+    QJsonObject result;
+    result.insert("status", QString("failed"));
+
+    // read the songbook file
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        result.insert("error", tr("unable to open file"));
+        report("done", filename, result);
+        return false;
+    }
+    QJsonParseError error;
+    QJsonDocument document(QJsonDocument::fromJson(file.readAll(), &error));
+    file.close();
+    if (!document.isObject()) {
+        result.insert("error", error.errorString());
+        report("done", filename, result);
+        return false;
+    }
+    QJsonObject json = document.object();
+
+    if (!loadLibrary(filename, json)) {
+        result.insert("error", tr("invalid datadir"));
+        report("done", filename, result);
+        return false;
+    }
+
+    foreach (const QString &song, missingSongs(json)) {
+        QJsonObject missing;
+        missing.insert("song", song);
+        report("missing", filename, missing);
+    }
+
+    // broken songs are reported without waiting for LaTeX
+    QStringList songs;
+    foreach (const QJsonValue &item, json.value("content").toArray())
+        songs << contentSongs(item);
+    QList<SongIssue> issues = SongValidator::validateSongs(songs);
+    if (!issues.isEmpty()) {
+        foreach (const SongIssue &issue, issues) {
+            QJsonObject invalid;
+            invalid.insert("song", issue.path);
+            if (issue.line > 0)
+                invalid.insert("line", issue.line);
+            invalid.insert("message", issue.message);
+            report("invalid", filename, invalid);
+        }
+        result.insert("error", tr("invalid songs"));
+        result.insert("elapsed", timer.elapsed());
+        report("done", filename, result);
+        return false;
+    }
+
+    QString pdf = m_outputDirectory.absoluteFilePath(
+        QFileInfo(filename).completeBaseName() + ".pdf");
+
+    m_currentSongbook = filename;
+    patacrep()->setWorkingDirectory(m_outputDirectory.absolutePath());
+    patacrep()->setSongbookFile(filename);
+    patacrep()->setDatadirs(QStringList()
+                            << Library::instance()->directory().absolutePath());
+    patacrep()->buildSongbook();
+    reportRecords(m_logParser.flush());
+    m_currentSongbook.clear();
+
+    bool success = patacrep()->buildSucceeded() && QFile::exists(pdf);
+
+    result.insert("status", QString(success ? "ok" : "failed"));
+    if (success)
+        result.insert("pdf", pdf);
+    result.insert("elapsed", timer.elapsed());
+    report("done", filename, result);
+    return success;
+}
+
+Patacrep *BatchBuilder::patacrep()
+{
+    // the python interpreter is only initialized once
+    if (!m_patacrep) {
+        m_patacrep = new Patacrep(this);
+        connect(m_patacrep, SIGNAL(message(const QString &, int)),
+                SLOT(patacrepMessage(const QString &)));
+        connect(m_patacrep, SIGNAL(output(const QString &)),
+                SLOT(patacrepOutput(const QString &)));
+    }
+    return m_patacrep;
+}
+
+bool BatchBuilder::loadLibrary(const QString &filename,
+                               const QJsonObject &json)
+{
+    // the first datadir of the songbook is the library, otherwise
+    // fallback on the library of the graphical interface
+    QString datadir;
+    QJsonValue value = json.value("datadir");
+    if (value.isArray() && !value.toArray().isEmpty())
+        value = value.toArray().first();
+    if (value.isString()) {
+        datadir = QFileInfo(filename).absoluteDir().absoluteFilePath(
+            value.toString());
+    } else {
+        QSettings settings;
+        settings.beginGroup("global");
+        datadir = settings.value("libraryPath").toString();
+        settings.endGroup();
+    }
+
+    QDir directory(datadir);
+    if (datadir.isEmpty() || !directory.exists("songs"))
+        return false;
+
+    Library::instance()->openDirectory(directory);
+    return true;
+}
+
+QStringList BatchBuilder::missingSongs(const QJsonObject &json) const
+{
+    QStringList missing;
+    QString songsPath =
+        QString("%1/songs").arg(Library::instance()->directory().absolutePath());
+
+    // only explicit .sg files can be resolved, other content items
+    // (directories, patterns, sorting directives) are left to patacrep
+    foreach (const QJsonValue &item, json.value("content").toArray()) {
+        QString song = item.toString();
+        if (!song.endsWith(".sg") || song.contains('*'))
+            continue;
+        QString path = QDir::cleanPath(QString("%1/%2").arg(songsPath).arg(song));
+        if (Library::instance()->getSongIndex(path) == -1)
+            missing << song;
+    }
+    return missing;
+}
+
+QStringList BatchBuilder::contentSongs(const QJsonValue &item) const
+{
+    QStringList songs;
+
+    // sections and other directives do not contain any song
+    if (!item.isString())
+        return songs;
+
+    QString content = item.toString();
+    Library *library = Library::instance();
+    QDir songsDirectory(
+        QString("%1/songs").arg(library->directory().absolutePath()));
+    if (content.endsWith(".sg") && !content.contains('*')) {
+        QString path = QDir::cleanPath(songsDirectory.absoluteFilePath(content));
+        if (library->getSongIndex(path) != -1)
+            songs << path;
+        return songs;
+    }
+
+    // directories and patterns are resolved against the library
+    QRegExp pattern(content, Qt::CaseSensitive, QRegExp::Wildcard);
+    QString directory = content.endsWith('/') ? content : content + '/';
+    for (int i = 0; i < library->rowCount(); ++i) {
+        QModelIndex index = library->index(i, 0);
+        QString song = library->data(index, Library::RelativePathRole).toString();
+        if (song.startsWith(directory) || pattern.exactMatch(song))
+            songs << library->data(index, Library::PathRole).toString();
+    }
+    return songs;
+}
+
+void BatchBuilder::patacrepMessage(const QString &message)
+{
+    reportRecords(m_logParser.parseLine(message));
+}
+
+void BatchBuilder::patacrepOutput(const QString &text)
+{
+    reportRecords(m_logParser.parse(text));
+}
+
+void BatchBuilder::reportRecords(const QList<LogRecord> &records)
+{
+    foreach (const LogRecord &record, records) {
+        QJsonObject log;
+        log.insert("type", LogRecord::typeToString(record.type));
+        log.insert("message", record.message);
+        if (!record.file.isEmpty())
+            log.insert("file", record.file);
+        if (record.line > 0)
+            log.insert("line", record.line);
+        report("log", m_currentSongbook, log);
+    }
+}
+
+void BatchBuilder::startWorker(const QString &filename)
+{
+    QProcess *worker = new QProcess(this);
+    worker->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    worker->setProperty("songbook", filename);
+    connect(worker, SIGNAL(readyReadStandardOutput()), SLOT(workerOutput()));
+    connect(worker, SIGNAL(finished(int, QProcess::ExitStatus)),
+            SLOT(workerFinished(int, QProcess::ExitStatus)));
+    m_workers << worker;
+
+    worker->start(QCoreApplication::applicationFilePath(),
+                  QStringList() << "--build" << filename << "--output"
+                                << m_outputDirectory.absolutePath());
+}
+
+void BatchBuilder::workerOutput()
+{
+    QProcess *worker = qobject_cast<QProcess *>(sender());
+    if (!worker)
+        return;
+
+    // each line of a worker is already a JSON event
+    QTextStream out(stdout);
+    while (worker->canReadLine())
+        out << worker->readLine();
+    out.flush();
+}
+
+void BatchBuilder::workerFinished(int exitCode,
+                                  QProcess::ExitStatus exitStatus)
+{
+    QProcess *worker = qobject_cast<QProcess *>(sender());
+    if (!worker)
+        return;
+
+    QTextStream out(stdout);
+    out << worker->readAllStandardOutput();
+    out.flush();
+
+    if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+        ++m_succeeded;
+    } else {
+        ++m_failed;
+        if (exitStatus == QProcess::CrashExit) {
+            QJsonObject result;
+            result.insert("status", QString("crashed"));
+            report("done", worker->property("songbook").toString(), result);
+        }
+    }
+
+    m_workers.removeOne(worker);
+    worker->deleteLater();
+
+    if (!m_pendingSongbooks.isEmpty()) {
+        startWorker(m_pendingSongbooks.takeFirst());
+    } else if (m_workers.isEmpty()) {
+        QJsonObject summary;
+        summary.insert("succeeded", m_succeeded);
+        summary.insert("failed", m_failed);
+        report("summary", QString(), summary);
+        QCoreApplication::exit(m_failed > 0 ? 1 : 0);
+    }
+}
@@ -0,0 +1,123 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __BATCH_BUILDER_HH__
+#define __BATCH_BUILDER_HH__
+
+#include <QObject>
+#include <QDir>
+#include <QJsonObject>
+#include <QProcess>
+#include <QStringList>
+
+#include "build-log.hh"
+
+class Patacrep;
+
+/*!
+  \file batch-builder.hh
+  \class BatchBuilder
+  \brief BatchBuilder builds songbooks from the command line without any GUI
+
+  A BatchBuilder is used instead of the MainWindow when the application
+  is started with the \a --build option:
+
+  \code
+  patagui --build book1.sb book2.sb --jobs 8 --output dir/
+  \endcode
+
+  For each songbook, the Library is loaded from the datadir of the .sb
+  file, the songs of the songbook are resolved against the library and
+  Patacrep is used to produce the PDF into the output directory.
+
+  When several songbooks are built with more than one job, each
+  songbook is built by a child process of the application (the python
+  interpreter being unique within a process).
+
+  Progress is reported on the standard output as one JSON object per
+  line, each object having an \a event field (start, log, missing,
+  invalid, done, summary). Songs are checked by the SongValidator before
+  starting LaTeX. Log events are classified by a LogParser.
+*/
+class BatchBuilder : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    BatchBuilder(QObject *parent = 0);
+
+    /// Destructor.
+    ~BatchBuilder();
+
+    /*!
+    Returns \a true if \a arguments request a headless build.
+  */
+    static bool isBatchMode(int argc, char *argv[]);
+
+    /*!
+    Parses the command line \a arguments.
+    Returns \a false and prints an error message if they are invalid.
+  */
+    bool parseArguments(const QStringList &arguments);
+
+    /*!
+    Builds all the songbooks and returns the exit code of the application:
+    \a 0 if all the songbooks were built, \a 1 otherwise.
+  */
+    int exec();
+
+    /*!
+    Returns the usage message of the batch mode options.
+  */
+    static QString usage();
+
+private slots:
+    void workerOutput();
+    void workerFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void patacrepMessage(const QString &message);
+    void patacrepOutput(const QString &text);
+
+private:
+    bool buildSongbook(const QString &filename);
+    bool loadLibrary(const QString &filename, const QJsonObject &json);
+    QStringList missingSongs(const QJsonObject &json) const;
+    QStringList contentSongs(const QJsonValue &item) const;
+    Patacrep *patacrep();
+
+    void startWorker(const QString &filename);
+    void report(const QString &event, const QString &filename,
+                QJsonObject data = QJsonObject());
+    void reportRecords(const QList<LogRecord> &records);
+
+    QStringList m_songbooks;
+    QDir m_outputDirectory;
+    int m_jobs;
+
+    Patacrep *m_patacrep;
+    LogParser m_logParser;
+    QString m_currentSongbook;
+
+    // child processes (one per songbook) when building in parallel
+    QStringList m_pendingSongbooks;
+    QList<QProcess *> m_workers;
+    int m_succeeded;
+    int m_failed;
+};
+
+#endif // __BATCH_BUILDER_HH__
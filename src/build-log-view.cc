@@ -0,0 +1,168 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "build-log-view.hh"
+
+#include <QBoxLayout>
+#include <QListView>
+#include <QScrollBar>
+#include <QToolButton>
+
+#include <QDebug>
+
+BuildLogFilterModel::BuildLogFilterModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , m_types(LogRecord::Info | LogRecord::Step | LogRecord::FileReference |
+              LogRecord::OverfullBox | LogRecord::Warning | LogRecord::Error)
+{
+}
+
+LogRecord::Types BuildLogFilterModel::types() const
+{
+    return m_types;
+}
+
+void BuildLogFilterModel::setTypes(LogRecord::Types types)
+{
+    if (m_types != types) {
+        m_types = types;
+        invalidateFilter();
+    }
+}
+
+bool BuildLogFilterModel::filterAcceptsRow(
+    int sourceRow, const QModelIndex &sourceParent) const
+{
+    int type = sourceModel()
+                   ->index(sourceRow, 0, sourceParent)
+                   .data(BuildLogModel::TypeRole)
+                   .toInt();
+    return m_types.testFlag(LogRecord::Type(type));
+}
+
+BuildLogView::BuildLogView(QWidget *parent)
+    : QWidget(parent)
+    , m_model(0)
+    , m_filterModel(new BuildLogFilterModel(this))
+    , m_view(new QListView(this))
+    , m_filters()
+    , m_clearButton(new QToolButton(this))
+    , m_followOutput(true)
+{
+    // only visible records are laid out
+    m_view->setModel(m_filterModel);
+    m_view->setUniformItemSizes(true);
+    m_view->setLayoutMode(QListView::Batched);
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    connect(m_view, SIGNAL(clicked(const QModelIndex &)),
+            SLOT(recordClicked(const QModelIndex &)));
+
+    connect(m_filterModel,
+            SIGNAL(rowsAboutToBeInserted(const QModelIndex &, int, int)),
+            SLOT(rowsAboutToBeInserted()));
+    connect(m_filterModel, SIGNAL(rowsInserted(const QModelIndex &, int, int)),
+            SLOT(rowsInserted()));
+
+    QBoxLayout *filterLayout = new QHBoxLayout;
+    filterLayout->addWidget(addFilter(tr("Errors"), LogRecord::Error));
+    filterLayout->addWidget(addFilter(tr("Warnings"), LogRecord::Warning));
+    filterLayout->addWidget(addFilter(tr("Boxes"), LogRecord::OverfullBox,
+                                      false));
+    filterLayout->addWidget(addFilter(tr("Files"), LogRecord::FileReference));
+    filterLayout->addWidget(
+        addFilter(tr("Messages"), LogRecord::Info | LogRecord::Step));
+    filterLayout->addStretch();
+
+    m_clearButton->setText(tr("Clear"));
+    m_clearButton->setIcon(QIcon::fromTheme(
+        "edit-clear", QIcon(":/icons/tango/32x32/actions/edit-clear.png")));
+    m_clearButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+    m_clearButton->setAutoRaise(true);
+    filterLayout->addWidget(m_clearButton);
+
+    QBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->setContentsMargins(0, 0, 0, 0);
+    mainLayout->setSpacing(0);
+    mainLayout->addLayout(filterLayout);
+    mainLayout->addWidget(m_view);
+    setLayout(mainLayout);
+
+    updateFilter();
+}
+
+BuildLogView::~BuildLogView() {}
+
+QToolButton *BuildLogView::addFilter(const QString &text,
+                                     LogRecord::Types types, bool checked)
+{
+    QToolButton *button = new QToolButton(this);
+    button->setText(text);
+    button->setCheckable(true);
+    button->setChecked(checked);
+    button->setAutoRaise(true);
+    button->setProperty("types", int(types));
+    connect(button, SIGNAL(toggled(bool)), SLOT(updateFilter()));
+    m_filters << button;
+    return button;
+}
+
+BuildLogModel *BuildLogView::model() const
+{
+    return m_model;
+}
+
+void BuildLogView::setModel(BuildLogModel *model)
+{
+    if (m_model)
+        disconnect(m_clearButton, 0, m_model, 0);
+
+    m_model = model;
+    m_filterModel->setSourceModel(model);
+
+    if (m_model)
+        connect(m_clearButton, SIGNAL(clicked()), m_model, SLOT(clear()));
+}
+
+void BuildLogView::updateFilter()
+{
+    int types = 0;
+    foreach (QToolButton *button, m_filters)
+        if (button->isChecked())
+            types |= button->property("types").toInt();
+    m_filterModel->setTypes(LogRecord::Types(QFlag(types)));
+}
+
+void BuildLogView::recordClicked(const QModelIndex &index)
+{
+    QString file = index.data(BuildLogModel::FileRole).toString();
+    if (!file.isEmpty())
+        emit(fileActivated(file, index.data(BuildLogModel::LineRole).toInt()));
+}
+
+void BuildLogView::rowsAboutToBeInserted()
+{
+    QScrollBar *scrollBar = m_view->verticalScrollBar();
+    m_followOutput = (scrollBar->value() == scrollBar->maximum());
+}
+
+void BuildLogView::rowsInserted()
+{
+    if (m_followOutput)
+        m_view->scrollToBottom();
+}
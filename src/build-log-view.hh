@@ -0,0 +1,118 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __BUILD_LOG_VIEW_HH__
+#define __BUILD_LOG_VIEW_HH__
+
+#include <QWidget>
+#include <QSortFilterProxyModel>
+
+#include "build-log.hh"
+
+class QListView;
+class QToolButton;
+class QModelIndex;
+
+/*!
+  \file build-log-view.hh
+  \class BuildLogFilterModel
+  \brief BuildLogFilterModel only accepts the records of some types
+*/
+class BuildLogFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    BuildLogFilterModel(QObject *parent = 0);
+
+    /*!
+    Returns the types of the records that are displayed.
+  */
+    LogRecord::Types types() const;
+
+    /*!
+    Displays only the records whose type belongs to \a types.
+  */
+    void setTypes(LogRecord::Types types);
+
+protected:
+    virtual bool filterAcceptsRow(int sourceRow,
+                                  const QModelIndex &sourceParent) const;
+
+private:
+    LogRecord::Types m_types;
+};
+
+/*!
+  \class BuildLogView
+  \brief BuildLogView displays the records of a BuildLogModel
+
+  The records are displayed in a list view with uniform item sizes so
+  that only the visible records are laid out, whatever the size of the
+  logs. A set of toggle buttons filters the records by type.
+
+  Clicking on a record that refers to a song emits fileActivated().
+*/
+class BuildLogView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    BuildLogView(QWidget *parent = 0);
+
+    /// Destructor.
+    ~BuildLogView();
+
+    /*!
+    Returns the model displayed by the view.
+  */
+    BuildLogModel *model() const;
+
+    /*!
+    Sets \a model as the model displayed by the view.
+  */
+    void setModel(BuildLogModel *model);
+
+signals:
+    /*!
+    This signal is emitted when a record referring to the song \a file
+    at line \a line is clicked.
+  */
+    void fileActivated(const QString &file, int line);
+
+private slots:
+    void updateFilter();
+    void recordClicked(const QModelIndex &index);
+    void rowsAboutToBeInserted();
+    void rowsInserted();
+
+private:
+    QToolButton *addFilter(const QString &text, LogRecord::Types types,
+                           bool checked = true);
+
+    BuildLogModel *m_model;
+    BuildLogFilterModel *m_filterModel;
+    QListView *m_view;
+    QList<QToolButton *> m_filters;
+    QToolButton *m_clearButton;
+    bool m_followOutput;
+};
+
+#endif // __BUILD_LOG_VIEW_HH__
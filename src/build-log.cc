@@ -0,0 +1,353 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "build-log.hh"
+
+#include <QFont>
+
+#include "utils/tango-colors.hh"
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+// longest message kept for a single record
+const int MaxMessageLength = 1024;
+
+// number of context lines LaTeX prints between "! error" and "l.123"
+const int MaxErrorContext = 8;
+
+// default number of records kept by the model
+const int DefaultCapacity = 20000;
+
+LogRecord makeRecord(LogRecord::Type type, const QString &message,
+                     const QString &file = QString(), int line = 0)
+{
+    LogRecord record;
+    record.type = type;
+    record.message = message;
+    record.file = file;
+    record.line = line;
+    return record;
+}
+}
+
+QString LogRecord::typeToString(Type type)
+{
+    switch (type) {
+    case Step:
+        return "step";
+    case FileReference:
+        return "file";
+    case OverfullBox:
+        return "box";
+    case Warning:
+        return "warning";
+    case Error:
+        return "error";
+    default:
+        return "info";
+    }
+}
+
+LogParser::LogParser()
+    : m_buffer()
+    , m_currentFile()
+    , m_pendingError(makeRecord(LogRecord::Error, QString()))
+    , m_pendingContext()
+    , m_hasPendingError(false)
+    , m_pendingLines(0)
+    , m_reFileLineError("^([^\\s:]+\\.(sg|tex)):(\\d+):\\s*(.*)$")
+    , m_reError(
+          "^(ERROR:|Building error|(LaTeX|Package|Class)( \\S+)? Error:)")
+    , m_reWarning("^(WARNING:|(LaTeX|Package|Class)( \\S+)? Warning:)")
+    , m_reSongFile("([^\\s'\"():]+\\.sg)")
+    , m_reSongFileLine("[Ll]ine\\s+(\\d+)")
+    , m_reErrorLine("^l\\.(\\d+)")
+    , m_reInputLine("input line (\\d+)")
+    , m_reBoxLines("at lines? (\\d+)")
+{
+}
+
+QList<LogRecord> LogParser::parse(const QString &chunk)
+{
+    QList<LogRecord> records;
+    m_buffer += chunk;
+
+    int start = 0;
+    int end;
+    while ((end = m_buffer.indexOf('\n', start)) != -1) {
+        classify(m_buffer.mid(start, end - start), records);
+        start = end + 1;
+    }
+    m_buffer.remove(0, start);
+
+    // do not let a line without newline grow forever
+    if (m_buffer.size() > MaxMessageLength) {
+        classify(m_buffer, records);
+        m_buffer.clear();
+    }
+    return records;
+}
+
+QList<LogRecord> LogParser::parseLine(const QString &line)
+{
+    QList<LogRecord> records;
+    classify(line, records);
+    return records;
+}
+
+QList<LogRecord> LogParser::flush()
+{
+    QList<LogRecord> records;
+    if (!m_buffer.isEmpty())
+        classify(m_buffer, records);
+    if (m_hasPendingError)
+        flushError(records);
+    m_buffer.clear();
+    m_currentFile.clear();
+    return records;
+}
+
+void LogParser::flushError(QList<LogRecord> &records)
+{
+    records << m_pendingError << m_pendingContext;
+    m_pendingContext.clear();
+    m_hasPendingError = false;
+    m_pendingLines = 0;
+}
+
+void LogParser::classify(const QString &text, QList<LogRecord> &records)
+{
+    QString line = text.trimmed();
+    if (line.isEmpty())
+        return;
+    if (line.size() > MaxMessageLength)
+        line.truncate(MaxMessageLength);
+
+    // a LaTeX error waits for its line number (l.123)
+    if (m_hasPendingError) {
+        if (line.startsWith("l.") && m_reErrorLine.indexIn(line) != -1) {
+            m_pendingError.line = m_reErrorLine.cap(1).toInt();
+            m_pendingContext << makeRecord(LogRecord::Info, line);
+            flushError(records);
+            return;
+        }
+        if (line.startsWith('!') || ++m_pendingLines > MaxErrorContext) {
+            flushError(records);
+        } else {
+            m_pendingContext << makeRecord(LogRecord::Info, line);
+            return;
+        }
+    }
+
+    if (line.startsWith('!')) {
+        m_pendingError = makeRecord(LogRecord::Error, line.mid(1).trimmed(),
+                                    m_currentFile);
+        m_hasPendingError = true;
+        m_pendingLines = 0;
+        return;
+    }
+
+    if (line.startsWith("Building songbook")) {
+        records << makeRecord(LogRecord::Step, line);
+        return;
+    }
+
+    // file:line: error (-file-line-error mode)
+    if (line.contains(':') && m_reFileLineError.indexIn(line) != -1) {
+        records << makeRecord(LogRecord::Error, m_reFileLineError.cap(4),
+                              m_reFileLineError.cap(1),
+                              m_reFileLineError.cap(3).toInt());
+        return;
+    }
+
+    if (line.startsWith("Overfull") || line.startsWith("Underfull")) {
+        int number = 0;
+        if (m_reBoxLines.indexIn(line) != -1)
+            number = m_reBoxLines.cap(1).toInt();
+        records << makeRecord(LogRecord::OverfullBox, line, m_currentFile,
+                              number);
+        return;
+    }
+
+    // only the prefixes used by LaTeX, its packages and the python
+    // logging module, song titles and lyrics may contain these words
+    bool isError = m_reError.indexIn(line) != -1;
+    if (isError || m_reWarning.indexIn(line) != -1) {
+        LogRecord record = makeRecord(
+            isError ? LogRecord::Error : LogRecord::Warning, line,
+            m_currentFile);
+        if (line.contains(".sg") && m_reSongFile.indexIn(line) != -1)
+            record.file = m_reSongFile.cap(1);
+        if (m_reInputLine.indexIn(line) != -1)
+            record.line = m_reInputLine.cap(1).toInt();
+        else if (m_reSongFileLine.indexIn(line) != -1)
+            record.line = m_reSongFileLine.cap(1).toInt();
+        records << record;
+        return;
+    }
+
+    // LaTeX opens files with "(./path/to/file.sg"
+    if (line.contains(".sg")) {
+        int index = 0;
+        QString file;
+        while ((index = m_reSongFile.indexIn(line, index)) != -1) {
+            file = m_reSongFile.cap(1);
+            index += m_reSongFile.matchedLength();
+        }
+        if (!file.isEmpty()) {
+            m_currentFile = file;
+            records << makeRecord(LogRecord::FileReference, line, file);
+            return;
+        }
+    }
+
+    records << makeRecord(LogRecord::Info, line);
+}
+
+BuildLogModel::BuildLogModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_parser()
+    , m_records(DefaultCapacity)
+    , m_first(0)
+    , m_count(0)
+{
+}
+
+BuildLogModel::~BuildLogModel() {}
+
+int BuildLogModel::capacity() const
+{
+    return m_records.size();
+}
+
+void BuildLogModel::setCapacity(int capacity)
+{
+    beginResetModel();
+    m_records = QVector<LogRecord>(qMax(1, capacity));
+    m_first = 0;
+    m_count = 0;
+    endResetModel();
+}
+
+const LogRecord &BuildLogModel::record(int row) const
+{
+    return m_records[(m_first + row) % m_records.size()];
+}
+
+int BuildLogModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_count;
+}
+
+QVariant BuildLogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_count)
+        return QVariant();
+
+    const LogRecord &logRecord = record(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return logRecord.message;
+    case Qt::ToolTipRole:
+        if (logRecord.file.isEmpty())
+            return QVariant();
+        if (logRecord.line > 0)
+            return QString("%1:%2").arg(logRecord.file).arg(logRecord.line);
+        return logRecord.file;
+    case Qt::ForegroundRole:
+        switch (logRecord.type) {
+        case LogRecord::Error:
+            return _TangoScarletRed1;
+        case LogRecord::Warning:
+            return _TangoOrange1;
+        case LogRecord::OverfullBox:
+            return _TangoChocolate1;
+        case LogRecord::FileReference:
+            return _TangoSkyBlue1;
+        default:
+            return QVariant();
+        }
+    case Qt::FontRole:
+        if (logRecord.type == LogRecord::Step) {
+            QFont font;
+            font.setBold(true);
+            return font;
+        }
+        return QVariant();
+    case TypeRole:
+        return int(logRecord.type);
+    case FileRole:
+        return logRecord.file;
+    case LineRole:
+        return logRecord.line;
+    }
+    return QVariant();
+}
+
+void BuildLogModel::appendOutput(const QString &chunk)
+{
+    appendRecords(m_parser.parse(chunk));
+}
+
+void BuildLogModel::appendMessage(const QString &message)
+{
+    appendRecords(m_parser.parseLine(message));
+}
+
+void BuildLogModel::flush()
+{
+    appendRecords(m_parser.flush());
+}
+
+void BuildLogModel::clear()
+{
+    beginResetModel();
+    m_parser.flush();
+    m_records = QVector<LogRecord>(capacity());
+    m_first = 0;
+    m_count = 0;
+    endResetModel();
+}
+
+void BuildLogModel::appendRecords(const QList<LogRecord> &records)
+{
+    if (records.isEmpty())
+        return;
+
+    const int size = capacity();
+    QList<LogRecord> added =
+        records.size() > size ? records.mid(records.size() - size) : records;
+
+    // discard the oldest records to make room for the new ones
+    int overflow = m_count + added.size() - size;
+    if (overflow > 0) {
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        m_first = (m_first + overflow) % size;
+        m_count -= overflow;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), m_count, m_count + added.size() - 1);
+    foreach (const LogRecord &logRecord, added) {
+        m_records[(m_first + m_count) % size] = logRecord;
+        ++m_count;
+    }
+    endInsertRows();
+}
@@ -0,0 +1,202 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __BUILD_LOG_HH__
+#define __BUILD_LOG_HH__
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QRegExp>
+#include <QString>
+#include <QVector>
+
+/*!
+  \file build-log.hh
+  \struct LogRecord "build-log.hh"
+  \brief LogRecord is a classified line of the build output
+*/
+struct LogRecord {
+    /*!
+    \enum Type
+    Kind of a record, sorted by increasing severity.
+  */
+    enum Type {
+        Info = 0x01,          /*!< any other output.*/
+        Step = 0x02,          /*!< the beginning of a build step.*/
+        FileReference = 0x04, /*!< a song file opened by LaTeX.*/
+        OverfullBox = 0x08,   /*!< an overfull or underfull box.*/
+        Warning = 0x10,       /*!< a LaTeX or patacrep warning.*/
+        Error = 0x20          /*!< a LaTeX or patacrep error.*/
+    };
+    Q_DECLARE_FLAGS(Types, Type)
+
+    Type type;       /*!< the kind of record.*/
+    QString message; /*!< the text of the record.*/
+    QString file;    /*!< the .sg file the record refers to (may be empty).*/
+    int line;        /*!< the line in file (0 if unknown).*/
+
+    /*!
+    Returns a lower case name for \a type (ie "error", "warning").
+  */
+    static QString typeToString(Type type);
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(LogRecord::Types)
+
+/*!
+  \class LogParser
+  \brief LogParser classifies the build output as it arrives
+
+  The output of the build is received by chunks that do not necessarily
+  end with a newline. The parser keeps the incomplete line until the
+  next chunk, tracks the .sg file currently read by LaTeX and attaches
+  the \a l.123 line of a LaTeX error to the error itself.
+
+  Each line is classified with cheap prefix/substring tests before any
+  regular expression is evaluated, so that long LaTeX logs are parsed
+  in linear time.
+*/
+class LogParser
+{
+public:
+    /// Constructor.
+    LogParser();
+
+    /*!
+    Parses a \a chunk of output and returns the completed records.
+    \sa flush
+  */
+    QList<LogRecord> parse(const QString &chunk);
+
+    /*!
+    Classifies a complete \a line (such as a status message).
+  */
+    QList<LogRecord> parseLine(const QString &line);
+
+    /*!
+    Returns the pending records (incomplete line, LaTeX error waiting
+    for its line number) and resets the parser.
+  */
+    QList<LogRecord> flush();
+
+private:
+    void classify(const QString &line, QList<LogRecord> &records);
+    void flushError(QList<LogRecord> &records);
+
+    QString m_buffer;
+    QString m_currentFile;
+
+    LogRecord m_pendingError;
+    QList<LogRecord> m_pendingContext;
+    bool m_hasPendingError;
+    int m_pendingLines;
+
+    QRegExp m_reFileLineError;
+    QRegExp m_reError;
+    QRegExp m_reWarning;
+    QRegExp m_reSongFile;
+    QRegExp m_reSongFileLine;
+    QRegExp m_reErrorLine;
+    QRegExp m_reInputLine;
+    QRegExp m_reBoxLines;
+};
+
+/*!
+  \class BuildLogModel
+  \brief BuildLogModel stores the records of the build output
+
+  Records are stored in a ring buffer: once \a capacity records are
+  reached, the oldest ones are discarded so that the memory footprint
+  of the logs remains bounded whatever the size of the LaTeX output.
+*/
+class BuildLogModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    /*!
+    \enum Roles
+    Data of a record that are available through the model.
+  */
+    enum Roles {
+        TypeRole = Qt::UserRole + 1, /*!< the LogRecord::Type of the record.*/
+        FileRole = Qt::UserRole + 2, /*!< the .sg file of the record.*/
+        LineRole = Qt::UserRole + 3  /*!< the line of the record in file.*/
+    };
+
+    /// Constructor.
+    BuildLogModel(QObject *parent = 0);
+
+    /// Destructor.
+    ~BuildLogModel();
+
+    /*!
+    Returns the maximum number of records kept by the model.
+  */
+    int capacity() const;
+
+    /*!
+    Sets the maximum number of records kept by the model.
+    The model is cleared.
+  */
+    void setCapacity(int capacity);
+
+    /*!
+    Returns the record at position \a row.
+  */
+    const LogRecord &record(int row) const;
+
+    /*!
+    Appends already classified \a records, for instance the issues
+    found before the build.
+  */
+    void appendRecords(const QList<LogRecord> &records);
+
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex &index,
+                          int role = Qt::DisplayRole) const;
+
+public slots:
+    /*!
+    Appends a \a chunk of the raw build output.
+  */
+    void appendOutput(const QString &chunk);
+
+    /*!
+    Appends a complete status \a message.
+  */
+    void appendMessage(const QString &message);
+
+    /*!
+    Appends the pending records (end of the build).
+  */
+    void flush();
+
+    /*!
+    Removes all the records.
+  */
+    void clear();
+
+private:
+    LogParser m_parser;
+    QVector<LogRecord> m_records;
+    int m_first;
+    int m_count;
+};
+
+#endif // __BUILD_LOG_HH__
@@ -0,0 +1,185 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "chord-index.hh"
+
+#include "chord.hh"
+#include "song.hh"
+
+#include <QDebug>
+
+ChordIndex::ChordIndex()
+    : m_songChords()
+    , m_songDiagrams()
+    , m_chordSongs()
+    , m_diagramSongs()
+    , m_chords()
+{
+}
+
+ChordIndex::~ChordIndex()
+{
+    qDeleteAll(m_chords);
+}
+
+QString ChordIndex::normalizedName(const QString &name)
+{
+    QString normalized = name.trimmed();
+    normalized.replace(QChar(0x266D), '&');
+
+    // a lowercase b following the root or the bass note is a flat
+    for (int i = 0; i + 1 < normalized.size(); ++i) {
+        if (normalized[i] < 'A' || normalized[i] > 'G' ||
+            normalized[i + 1] != 'b')
+            continue;
+        QChar previous = (i > 0) ? normalized[i - 1] : QChar(' ');
+        if (previous == ' ' || previous == '/' || previous == '(' ||
+            previous == ',')
+            normalized[i + 1] = '&';
+    }
+    return normalized;
+}
+
+QStringList ChordIndex::songChords(const Song &song)
+{
+    QStringList names;
+    QSet<QString> found;
+    foreach (const QString &line, song.lyrics) {
+        int start = 0;
+        while ((start = line.indexOf("\\[", start)) != -1) {
+            int end = line.indexOf(']', start + 2);
+            if (end == -1)
+                break;
+
+            // \[Am G] plays several chords
+            QStringList chords = line.mid(start + 2, end - start - 2)
+                                     .split(' ', QString::SkipEmptyParts);
+            foreach (const QString &chord, chords) {
+                QString name = normalizedName(chord);
+                if (!name.isEmpty() && !found.contains(name)) {
+                    found.insert(name);
+                    names << name;
+                }
+            }
+            start = end + 1;
+        }
+    }
+    return names;
+}
+
+void ChordIndex::addSong(const Song &song)
+{
+    removeSong(song.path);
+
+    QStringList chords = songChords(song);
+    foreach (const QString &name, chords)
+        m_chordSongs[name].insert(song.path);
+    m_songChords.insert(song.path, chords);
+
+    QStringList diagrams;
+    foreach (const QString &line, song.gtabs + song.utabs) {
+        QString diagram = line.trimmed();
+        if (diagrams.contains(diagram))
+            continue;
+
+        if (!m_chords.contains(diagram)) {
+            Chord *chord = new Chord(diagram);
+            if (!chord->isValid()) {
+                delete chord;
+                continue;
+            }
+            m_chords.insert(diagram, chord);
+        }
+        m_diagramSongs[diagram].insert(song.path);
+        diagrams << diagram;
+    }
+    m_songDiagrams.insert(song.path, diagrams);
+}
+
+void ChordIndex::removeSong(const QString &path)
+{
+    QHash<QString, QStringList>::iterator it = m_songChords.find(path);
+    if (it == m_songChords.end())
+        return;
+
+    foreach (const QString &name, it.value()) {
+        QSet<QString> &songs = m_chordSongs[name];
+        songs.remove(path);
+        if (songs.isEmpty())
+            m_chordSongs.remove(name);
+    }
+    m_songChords.erase(it);
+
+    foreach (const QString &diagram, m_songDiagrams.take(path))
+        releaseDiagram(diagram, path);
+}
+
+void ChordIndex::releaseDiagram(const QString &diagram, const QString &path)
+{
+    QSet<QString> &songs = m_diagramSongs[diagram];
+    songs.remove(path);
+    if (!songs.isEmpty())
+        return;
+
+    // the last song declaring the diagram is gone
+    m_diagramSongs.remove(diagram);
+    delete m_chords.take(diagram);
+}
+
+void ChordIndex::clear()
+{
+    qDeleteAll(m_chords);
+    m_chords.clear();
+    m_songChords.clear();
+    m_songDiagrams.clear();
+    m_chordSongs.clear();
+    m_diagramSongs.clear();
+}
+
+QStringList ChordIndex::songsWithChord(const QString &name) const
+{
+    QStringList songs = m_chordSongs.value(normalizedName(name)).toList();
+    songs.sort();
+    return songs;
+}
+
+QStringList ChordIndex::songsPlayableWith(const QStringList &names) const
+{
+    QSet<QString> chords;
+    foreach (const QString &name, names)
+        chords.insert(normalizedName(name));
+
+    // a song is playable if each of its chords is counted
+    QHash<QString, int> counts;
+    foreach (const QString &name, chords)
+        foreach (const QString &path, m_chordSongs.value(name))
+            ++counts[path];
+
+    QStringList songs;
+    QHash<QString, int>::const_iterator it;
+    for (it = counts.constBegin(); it != counts.constEnd(); ++it)
+        if (it.value() == m_songChords.value(it.key()).size())
+            songs << it.key();
+    songs.sort();
+    return songs;
+}
+
+const Chord *ChordIndex::chord(const QString &diagram) const
+{
+    return m_chords.value(diagram.trimmed());
+}
@@ -0,0 +1,127 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __CHORD_INDEX_HH__
+#define __CHORD_INDEX_HH__
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class Chord;
+struct Song;
+
+/*!
+  \file chord-index.hh
+  \class ChordIndex
+  \brief ChordIndex maps the chords of the library to the songs using them
+
+  The index records, for each song of the library:
+  \li the names of the chords played in its lyrics (\\[Am] markers);
+  \li the diagrams declared in its header (\\gtab and \\utab macros).
+
+  Chord names are normalized so that \a Bbm7 and \a B&m7 are the same
+  chord. Each distinct diagram is parsed only once into a Chord that is
+  shared by all the songs declaring it, and by the ChordListModel of
+  the song editors; it is released when the last of these songs is
+  removed from the index.
+
+  The index is updated incrementally by the Library whenever a song is
+  added, reloaded, saved or removed. It answers the \a chord: and
+  \a chords: keywords of the library filter
+  (see SongSortFilterProxyModel::setFilterString()).
+
+  \code
+  const ChordIndex &index = Library::instance()->chordIndex();
+  QStringList songs = index.songsPlayableWith(
+      QStringList() << "C" << "G" << "Am" << "F" << "Em" << "Dm");
+  \endcode
+*/
+class ChordIndex
+{
+public:
+    /// Constructor.
+    ChordIndex();
+
+    /// Destructor.
+    ~ChordIndex();
+
+    /*!
+    Indexes the chords of \a song, replacing those previously indexed
+    for the same path.
+  */
+    void addSong(const Song &song);
+
+    /*!
+    Removes the song \a path from the index.
+  */
+    void removeSong(const QString &path);
+
+    /*!
+    Removes all the songs from the index.
+  */
+    void clear();
+
+    /*!
+    Returns the paths of the songs playing the chord \a name.
+  */
+    QStringList songsWithChord(const QString &name) const;
+
+    /*!
+    Returns the paths of the songs whose chords all belong to \a names.
+  */
+    QStringList songsPlayableWith(const QStringList &names) const;
+
+    /*!
+    Returns the chord of the \a diagram, such as \\gtab{Am}{X02210},
+    if it is declared by a song of the library; 0 otherwise.
+  */
+    const Chord *chord(const QString &diagram) const;
+
+    /*!
+    Returns the normalized form of the chord \a name: the flats of the
+    root and bass notes (such as Bb/Eb or the flat sign) are written
+    with \a & as in the songs LaTeX package.
+  */
+    static QString normalizedName(const QString &name);
+
+    /*!
+    Returns the normalized names of the chords played in the lyrics of
+    \a song, without duplicates.
+  */
+    static QStringList songChords(const Song &song);
+
+private:
+    Q_DISABLE_COPY(ChordIndex)
+
+    void releaseDiagram(const QString &diagram, const QString &path);
+
+    // chords and diagrams of each song
+    QHash<QString, QStringList> m_songChords;
+    QHash<QString, QStringList> m_songDiagrams;
+
+    // songs using each chord or diagram
+    QHash<QString, QSet<QString> > m_chordSongs;
+    QHash<QString, QSet<QString> > m_diagramSongs;
+
+    // parsed diagrams, shared by the songs
+    QHash<QString, Chord *> m_chords;
+};
+
+#endif // __CHORD_INDEX_HH__
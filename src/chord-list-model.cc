@@ -19,8 +19,12 @@
 
 #include "chord-list-model.hh"
 #include "chord.hh"
+#include "diagram-renderer.hh"
+#include "library.hh"
 
+#include <QGuiApplication>
 #include <QMimeData>
+#include <QScopedPointer>
 
 #include <QDebug>
 
@@ -29,15 +33,14 @@ ChordListModel::ChordListModel(QObject *parent)
 {
     m_fixedColumnCount = false;
     m_fixedRowCount = false;
-}
 
-ChordListModel::~ChordListModel()
-{
-    foreach (Chord *chord, m_data)
-        delete chord;
-    m_data.clear();
+    connect(DiagramRenderer::instance(),
+            SIGNAL(diagramRendered(const DiagramKey &)),
+            SLOT(diagramRendered(const DiagramKey &)));
 }
 
+ChordListModel::~ChordListModel() {}
+
 int ChordListModel::columnCount(const QModelIndex &) const
 {
     return m_columnCount;
@@ -45,45 +48,70 @@ int ChordListModel::columnCount(const QModelIndex &) const
 
 void ChordListModel::setColumnCount(int value)
 {
-    emit(layoutAboutToBeChanged());
+    beginResetModel();
     m_fixedColumnCount = true;
-    m_columnCount = value;
-    emit(layoutChanged());
+    m_fixedRowCount = false;
+    m_columnCount = qMax(1, value);
+    gridSize(m_data.size(), m_rowCount, m_columnCount);
+    endResetModel();
 }
 
 int ChordListModel::rowCount(const QModelIndex &) const { return m_rowCount; }
 
 void ChordListModel::setRowCount(int value)
 {
-    emit(layoutAboutToBeChanged());
+    beginResetModel();
     m_fixedRowCount = true;
-    m_rowCount = value;
-    emit(layoutChanged());
+    m_fixedColumnCount = false;
+    m_rowCount = qMax(1, value);
+    gridSize(m_data.size(), m_rowCount, m_columnCount);
+    endResetModel();
 }
 
 QVariant ChordListModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid() || m_data.size() == 0)
+    if (!index.isValid())
+        return QVariant();
+
+    int position = positionFromIndex(index);
+    if (position < 0 || position >= m_data.size())
         return QVariant();
 
+    const Item &item = m_data[position];
     switch (role) {
     case Qt::DisplayRole:
-        return m_data[positionFromIndex(index)]->toString();
+        return item.text;
     case Qt::DecorationRole:
-        return *(m_data[positionFromIndex(index)]->toPixmap());
+        return DiagramRenderer::instance()->diagram(item.key);
     case Qt::ToolTipRole:
-        return data(index, Qt::DisplayRole);
+        return item.text;
     case NameRole:
-        return m_data[positionFromIndex(index)]->name();
+        return item.name;
     case StringsRole:
-        return m_data[positionFromIndex(index)]->strings();
+        return item.strings;
     case ImportantRole:
-        return m_data[positionFromIndex(index)]->isImportant();
+        return item.important;
     default:
         return QVariant();
     }
 }
 
+void ChordListModel::diagramRendered(const DiagramKey &key)
+{
+    if (m_columnCount == 0)
+        return;
+
+    // the blank diagrams of this chord are replaced by the rendered one
+    for (int position = 0; position < m_data.size(); ++position) {
+        if (m_data[position].key == key) {
+            QModelIndex cell =
+                index(position / m_columnCount, position % m_columnCount);
+            emit(dataChanged(cell, cell,
+                             QVector<int>() << Qt::DecorationRole));
+        }
+    }
+}
+
 bool ChordListModel::setData(const QModelIndex &index, const QVariant &value,
                              int role)
 {
@@ -92,97 +120,150 @@ bool ChordListModel::setData(const QModelIndex &index, const QVariant &value,
     if (!index.isValid())
         return false;
 
-    Chord *chord = new Chord(value.toString());
-    if (chord->isValid()) {
-        int pos = positionFromIndex(index);
-        delete m_data[pos];
-        m_data[pos] = chord;
-        return true;
-    }
+    int position = positionFromIndex(index);
+    Item item;
+    if (position < 0 || position >= m_data.size() ||
+        !parseItem(value.toString(), item))
+        return false;
 
-    delete chord;
-    return false;
+    m_data[position] = item;
+    emit(dataChanged(index, index));
+    return true;
 }
 
-void ChordListModel::insertItem(const QModelIndex &index, const QString &value)
+bool ChordListModel::parseItem(const QString &value, Item &item)
 {
-    setColumnCount(columnCount() + 1);
-    m_fixedColumnCount = false;
-    int pos = index.column() < 0 ? columnCount() - 1 : index.column();
+    // the diagrams of the library are already parsed by its chord index,
+    // other chords are only parsed to read their string representation
+    const Chord *chord = Library::instance()->chordIndex().chord(value);
+    QScopedPointer<Chord> parsedChord;
+    if (!chord) {
+        parsedChord.reset(new Chord(value));
+        chord = parsedChord.data();
+    }
+    if (!chord->isValid())
+        return false;
 
-    Chord *chord = new Chord(value);
-    if (chord->isValid())
-        m_data.insert(pos, chord);
-    else
-        delete chord;
+    item.text = chord->toString();
+    item.name = chord->name();
+    item.strings = chord->strings();
+    item.important = chord->isImportant();
+    item.key = DiagramRenderer::key(*chord, qApp->devicePixelRatio());
+    return true;
 }
 
-void ChordListModel::removeItem(const QModelIndex &index)
+QStringList ChordListModel::chords() const
+{
+    QStringList list;
+    foreach (const Item &item, m_data)
+        list << item.text;
+    return list;
+}
+
+void ChordListModel::setChords(const QStringList &chords)
 {
-    int pos = positionFromIndex(index);
-    delete m_data[pos];
-    m_data.remove(pos);
+    QVector<Item> items;
+    items.reserve(chords.size());
 
-    int row = indexFromPosition(m_data.size()).row();
-    int col = indexFromPosition(m_data.size()).column();
+    Item item;
+    foreach (const QString &chord, chords)
+        if (parseItem(chord, item))
+            items << item;
 
-    // dynamically reduce the QListModel
-    if (rowCount() > row + 1) {
-        setRowCount(row + 1);
-        m_fixedRowCount = false;
-    }
-    if (columnCount() > col + 1) {
-        setColumnCount(col + 1);
-        m_fixedColumnCount = false;
-    }
+    m_data = items;
+    itemsChanged(0, resizeGrid());
 }
 
-void ChordListModel::addItem(const QString &value)
+void ChordListModel::insertItem(const QModelIndex &index, const QString &value)
 {
-    Chord *chord = new Chord(value);
-    if (!chord->isValid()) {
-        delete chord;
+    Item item;
+    if (!parseItem(value, item))
         return;
-    }
 
-    m_data.append(chord);
+    int position = index.isValid() ? positionFromIndex(index) : m_data.size();
+    position = qBound(0, position, m_data.size());
+    m_data.insert(position, item);
+    itemsChanged(position, resizeGrid());
+}
 
-    int row = indexFromPosition(m_data.size()).row();
-    int col = indexFromPosition(m_data.size()).column();
+void ChordListModel::removeItem(const QModelIndex &index)
+{
+    int position = positionFromIndex(index);
+    if (index.isValid() && position >= 0 && position < m_data.size())
+        removeAt(position);
+}
 
-    // dynamically expand the QListModel
-    if (rowCount() < row + 1) {
-        setRowCount(row + 1);
-        m_fixedRowCount = false;
-    }
-    if (columnCount() < col + 1) {
-        setColumnCount(col + 1);
-        m_fixedColumnCount = false;
-    }
+void ChordListModel::removeAt(int position)
+{
+    m_data.remove(position);
+    itemsChanged(position, resizeGrid());
+}
+
+void ChordListModel::addItem(const QString &value)
+{
+    insertItem(QModelIndex(), value);
 }
 
-QModelIndex ChordListModel::indexFromPosition(int position)
+void ChordListModel::gridSize(int count, int &rows, int &columns) const
 {
-    int row = 1, col = 1;
     if (m_fixedColumnCount) {
-        row = (position - 1) / columnCount();
-        col = (position - 1) % columnCount();
+        columns = m_columnCount;
+        rows = (count + columns - 1) / columns;
+    } else if (m_fixedRowCount) {
+        rows = m_rowCount;
+        columns = (count + rows - 1) / rows;
+    } else {
+        rows = count > 0 ? 1 : 0;
+        columns = count;
+    }
+}
+
+bool ChordListModel::resizeGrid()
+{
+    int rows, columns;
+    gridSize(m_data.size(), rows, columns);
+    bool columnsChanged = (columns != m_columnCount);
+
+    // only the rows and columns at the end of the grid change
+    if (columns > m_columnCount) {
+        beginInsertColumns(QModelIndex(), m_columnCount, columns - 1);
+        m_columnCount = columns;
+        endInsertColumns();
+    } else if (columns < m_columnCount) {
+        beginRemoveColumns(QModelIndex(), columns, m_columnCount - 1);
+        m_columnCount = columns;
+        endRemoveColumns();
     }
-    if (m_fixedRowCount) {
-        row = (position - 1) % rowCount();
-        col = (position - 1) / rowCount();
+
+    if (rows > m_rowCount) {
+        beginInsertRows(QModelIndex(), m_rowCount, rows - 1);
+        m_rowCount = rows;
+        endInsertRows();
+    } else if (rows < m_rowCount) {
+        beginRemoveRows(QModelIndex(), rows, m_rowCount - 1);
+        m_rowCount = rows;
+        endRemoveRows();
     }
-    return QAbstractListModel::createIndex(row, col);
+    return columnsChanged;
 }
 
-int ChordListModel::positionFromIndex(const QModelIndex &index) const
+void ChordListModel::itemsChanged(int position, bool columnsChanged)
 {
-    return columnCount() * index.row() + index.column();
+    if (m_rowCount == 0 || m_columnCount == 0)
+        return;
+
+    // the chords that follow position have moved to the next cells;
+    // when the number of columns changes (with a fixed number of rows),
+    // every chord has moved
+    int row = columnsChanged ? 0 : position / m_columnCount;
+    if (row < m_rowCount)
+        emit(dataChanged(index(row, 0),
+                         index(m_rowCount - 1, m_columnCount - 1)));
 }
 
-Chord *ChordListModel::getChord(const QModelIndex &index) const
+int ChordListModel::positionFromIndex(const QModelIndex &index) const
 {
-    return m_data[positionFromIndex(index)];
+    return columnCount() * index.row() + index.column();
 }
 
 Qt::DropActions ChordListModel::supportedDropActions() const
@@ -245,9 +326,9 @@ bool ChordListModel::dropMimeData(const QMimeData *data, Qt::DropAction action,
 
     QString newItem = data->text();
     insertItem(index(0, beginColumn), newItem);
-    for (int j = 0; j < columnCount(); ++j)
-        if (m_data[j]->toString() == newItem && j != beginColumn) {
-            removeItem(index(0, j));
+    for (int j = 0; j < m_data.size(); ++j)
+        if (m_data[j].text == newItem && j != beginColumn) {
+            removeAt(j);
             return true;
         }
 
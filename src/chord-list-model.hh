@@ -22,9 +22,10 @@
 #include <QAbstractListModel>
 #include <QModelIndex>
 #include <QString>
+#include <QStringList>
 #include <QVector>
 
-class Chord;
+#include "diagram-renderer.hh"
 
 /*!
   \file chord-list-model.hh
@@ -61,6 +62,11 @@ class Chord;
   model->addItem("\gtab{G}{X02210}");
   model->addItem("\gtab{D}{XX0232}");
   \endcode
+
+  Chords are stored by value with the properties displayed by the views,
+  and the grid only grows or shrinks by the rows and columns that are
+  inserted or removed. The chords of a song are set with setChords() so
+  that the grid is computed once whatever the number of chords.
 */
 class ChordListModel : public QAbstractListModel
 {
@@ -145,10 +151,17 @@ public:
                  int role = Qt::EditRole);
 
     /*!
-    Returns the Chord object at position \a index.
-    \sa data, setData
+    Returns the string representations of the chords of the model.
+    \sa setChords
+  */
+    QStringList chords() const;
+
+    /*!
+    Replaces the chords of the model by \a chords, given in their string
+    representation.
+    \sa chords, addItem
   */
-    Chord *getChord(const QModelIndex &index) const;
+    void setChords(const QStringList &chords);
 
 public slots:
     /*!
@@ -167,16 +180,32 @@ public slots:
   */
     void addItem(const QString &value);
 
+private slots:
+    void diagramRendered(const DiagramKey &key);
+
 private:
-    QModelIndex indexFromPosition(int position);
+    struct Item
+    {
+        QString text;
+        QString name;
+        QString strings;
+        bool important;
+        DiagramKey key;
+    };
+
+    static bool parseItem(const QString &value, Item &item);
     int positionFromIndex(const QModelIndex &index) const;
+    void gridSize(int count, int &rows, int &columns) const;
+    bool resizeGrid();
+    void itemsChanged(int position, bool columnsChanged);
+    void removeAt(int position);
 
 private:
     bool m_fixedColumnCount;
     bool m_fixedRowCount;
     int m_columnCount;
     int m_rowCount;
-    QVector<Chord *> m_data;
+    QVector<Item> m_data;
 };
 
 #endif //__CHORD_LIST_MODEL_HH__
@@ -0,0 +1,395 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "chord-transposer.hh"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include "chord-index.hh"
+#include "fingering-database.hh"
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+const char *const SharpNames[12] = {"C",  "C#", "D",  "D#", "E",  "F",
+                                    "F#", "G",  "G#", "A",  "A#", "B"};
+const char *const FlatNames[12] = {"C",  "D&", "D",  "E&", "E",  "F",
+                                   "G&", "G",  "A&", "A",  "B&", "B"};
+
+// pitch class of a note name, -1 if c is not a note
+int naturalPitch(QChar c)
+{
+    switch (c.unicode()) {
+    case 'C':
+        return 0;
+    case 'D':
+        return 2;
+    case 'E':
+        return 4;
+    case 'F':
+        return 5;
+    case 'G':
+        return 7;
+    case 'A':
+        return 9;
+    case 'B':
+        return 11;
+    default:
+        return -1;
+    }
+}
+
+// a note starts a chord or follows a separator within \[...]
+bool isNotePosition(const QString &text, int begin, int position)
+{
+    if (naturalPitch(text[position]) == -1)
+        return false;
+    if (position == begin)
+        return true;
+    QChar previous = text[position - 1];
+    return previous == ' ' || previous == '/' || previous == '(' ||
+           previous == ',';
+}
+
+// the chords between begin and end, with the flats written as &
+QString normalizedChords(const QString &text, int begin, int end)
+{
+    QStringList names = text.mid(begin, end - begin).split(' ');
+    for (int i = 0; i < names.size(); ++i)
+        names[i] = ChordIndex::normalizedName(names[i]);
+    return names.join(' ');
+}
+
+struct TransposeSong {
+    typedef Transposition result_type;
+
+    TransposeSong(const ChordTransposer &transposer) : m_transposer(transposer)
+    {
+    }
+
+    Transposition operator()(const QString &path) const
+    {
+        return m_transposer.transposeSong(path);
+    }
+
+    ChordTransposer m_transposer;
+};
+}
+
+ChordTransposer::ChordTransposer(int semitones)
+    : m_semitones(((semitones % 12) + 12) % 12)
+{
+}
+
+int ChordTransposer::semitones() const { return m_semitones; }
+
+bool ChordTransposer::isFlatKey(int pitch)
+{
+    switch (((pitch % 12) + 12) % 12) {
+    case 1:  // D&
+    case 3:  // E&
+    case 5:  // F
+    case 6:  // G&
+    case 8:  // A&
+    case 10: // B&
+        return true;
+    default:
+        return false;
+    }
+}
+
+int ChordTransposer::transposeNote(const QString &text, int position,
+                                   bool flats, QString &output) const
+{
+    int pitch = naturalPitch(text[position++]);
+    while (position < text.size() &&
+           (text[position] == '#' || text[position] == '&')) {
+        pitch += (text[position] == '#') ? 1 : -1;
+        ++position;
+    }
+
+    pitch = (((pitch + m_semitones) % 12) + 12) % 12;
+    output += QLatin1String(flats ? FlatNames[pitch] : SharpNames[pitch]);
+    return position;
+}
+
+bool ChordTransposer::hasFlatKey(const QString &text) const
+{
+    // the first chord of the lyrics gives the key of the song, the
+    // diagrams declared before it are not played in that order
+    int start = 0;
+    while ((start = text.indexOf("\\[", start)) != -1) {
+        int end = text.indexOf(']', start + 2);
+        if (end == -1)
+            break;
+        QString chords = normalizedChords(text, start + 2, end);
+        for (int i = 0; i < chords.size(); ++i) {
+            if (!isNotePosition(chords, 0, i))
+                continue;
+            QString note;
+            int next = transposeNote(chords, i, false, note);
+            int pitch = naturalPitch(note[0]) + (note.size() > 1 ? 1 : 0);
+            QStringRef quality = chords.midRef(next);
+            if (quality.startsWith('m') && !quality.startsWith("maj"))
+                pitch += 3; // relative major key
+            return isFlatKey(pitch);
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+int ChordTransposer::transposeChords(const QString &text, int begin, int end,
+                                     bool flats, QString &output) const
+{
+    int notes = 0;
+    int i = begin;
+    while (i < end) {
+        if (!isNotePosition(text, begin, i)) {
+            output += text[i++];
+            continue;
+        }
+
+        i = transposeNote(text, i, flats, output);
+        ++notes;
+    }
+    return notes;
+}
+
+QString ChordTransposer::transposeChord(const QString &name, bool flats) const
+{
+    QString output;
+    QString chords = normalizedChords(name, 0, name.size());
+    transposeChords(chords, 0, chords.size(), flats, output);
+    return output;
+}
+
+bool ChordTransposer::moveShape(QString &fret, QString &strings) const
+{
+    // open strings do not move along the neck
+    if (strings.contains('0'))
+        return false;
+
+    if (!fret.isEmpty()) {
+        int newFret = fret.toInt() + m_semitones;
+        if (newFret > 9)
+            newFret -= 12;
+        if (newFret < 1)
+            return false;
+        fret = QString::number(newFret);
+        return true;
+    }
+
+    // without fret, the digits are the pinched frets
+    QList<int> frets;
+    int highest = 0;
+    for (int i = 0; i < strings.size(); ++i) {
+        if (strings[i] == 'X' || strings[i] == 'x')
+            continue;
+        if (!strings[i].isDigit())
+            return false;
+        highest = qMax(highest, strings[i].digitValue() + m_semitones);
+    }
+    int shift = (highest > 9) ? m_semitones - 12 : m_semitones;
+
+    QString moved(strings);
+    for (int i = 0; i < strings.size(); ++i) {
+        if (!strings[i].isDigit())
+            continue;
+        int value = strings[i].digitValue() + shift;
+        if (value < 1 || value > 9)
+            return false;
+        moved[i] = QChar('0' + value);
+    }
+    strings = moved;
+    return true;
+}
+
+bool ChordTransposer::transposeDiagram(const QString &text, int &position,
+                                       bool flats, QString &output,
+                                       Transposition &result) const
+{
+    // \gtab{name}{fret:strings} or \utab*{name}{strings:fingers}
+    int i = position + 5;
+    bool important = (i < text.size() && text[i] == '*');
+    if (important)
+        ++i;
+    if (i >= text.size() || text[i] != '{')
+        return false;
+    int nameEnd = text.indexOf('}', i + 1);
+    if (nameEnd == -1 || nameEnd + 1 >= text.size() ||
+        text[nameEnd + 1] != '{')
+        return false;
+    int argumentEnd = text.indexOf('}', nameEnd + 2);
+    if (argumentEnd == -1)
+        return false;
+
+    QString name;
+    QString chords = normalizedChords(text, i + 1, nameEnd);
+    transposeChords(chords, 0, chords.size(), flats, name);
+
+    // ~: and fret prefixes, then strings and optional fingers
+    QString argument = text.mid(nameEnd + 2, argumentEnd - nameEnd - 2);
+    QString prefix;
+    QString fret;
+    if (argument.startsWith("~:")) {
+        prefix = "~:";
+        argument.remove(0, 2);
+    } else if (argument.size() > 1 && argument[0].isDigit() &&
+               argument[1] == ':') {
+        fret = argument.left(1);
+        argument.remove(0, 2);
+    }
+    QString strings = argument.section(':', 0, 0);
+    QString fingers = argument.section(':', 1);
+
+    // a shape that cannot be moved is replaced by a fingering of the
+    // new chord, keeping the old name would contradict the lyrics
+    bool moved = moveShape(fret, strings);
+    if (moved) {
+        argument = prefix + (fret.isEmpty() ? QString() : fret + ":") + strings;
+        if (!fingers.isEmpty())
+            argument += ":" + fingers;
+    } else {
+        Chord::Instrument instrument =
+            (text[position + 1] == 'u') ? Chord::Ukulele : Chord::Guitar;
+        QStringList fingerings =
+            FingeringDatabase::fingerings(name, instrument);
+        argument = fingerings.isEmpty() ? QString() : fingerings.first();
+    }
+
+    if (moved || !argument.isEmpty()) {
+        output += text.midRef(position, i + 1 - position);
+        output += name;
+        output += "}{";
+        output += argument;
+        output += "}";
+        ++result.diagrams;
+    } else {
+        // unknown chord: the diagram is removed, with its line if alone
+        int lineStart = output.lastIndexOf('\n') + 1;
+        if (argumentEnd + 1 < text.size() && text[argumentEnd + 1] == '\n' &&
+            output.midRef(lineStart).trimmed().isEmpty()) {
+            output.truncate(lineStart);
+            ++argumentEnd;
+        }
+        ++result.removedDiagrams;
+    }
+
+    position = argumentEnd + 1;
+    return true;
+}
+
+QString ChordTransposer::transposeText(const QString &text,
+                                       Transposition *result) const
+{
+    Transposition counts;
+    counts.chords = 0;
+    counts.diagrams = 0;
+    counts.removedDiagrams = 0;
+    if (m_semitones == 0) {
+        if (result)
+            *result = counts;
+        return text;
+    }
+
+    QString output;
+    output.reserve(text.size() + text.size() / 16);
+    bool flats = hasFlatKey(text);
+
+    const int size = text.size();
+    int i = 0;
+    while (i < size) {
+        if (text[i] != '\\' || i + 1 == size) {
+            output += text[i++];
+            continue;
+        }
+
+        if (text[i + 1] == '[') {
+            int end = text.indexOf(']', i + 2);
+            if (end == -1)
+                break;
+            output += "\\[";
+            QString chords = normalizedChords(text, i + 2, end);
+            if (transposeChords(chords, 0, chords.size(), flats, output) > 0)
+                ++counts.chords;
+            output += ']';
+            i = end + 1;
+            continue;
+        }
+
+        QStringRef macro = text.midRef(i + 1, 4);
+        bool diagram = (macro == QLatin1String("gtab") ||
+                        macro == QLatin1String("utab"));
+        if (diagram &&
+            transposeDiagram(text, i, flats, output, counts))
+            continue;
+
+        output += text[i++];
+    }
+    output += text.midRef(i);
+
+    if (result) {
+        result->chords = counts.chords;
+        result->diagrams = counts.diagrams;
+        result->removedDiagrams = counts.removedDiagrams;
+    }
+    return output;
+}
+
+Transposition ChordTransposer::transposeSong(const QString &path) const
+{
+    Transposition result;
+    result.path = path;
+    result.chords = 0;
+    result.diagrams = 0;
+    result.removedDiagrams = 0;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = file.errorString();
+        return result;
+    }
+    QString text = QString::fromUtf8(file.readAll());
+    file.close();
+
+    QString transposed = transposeText(text, &result);
+    if (result.chords == 0 && result.diagrams == 0 &&
+        result.removedDiagrams == 0)
+        return result;
+
+    // the song is replaced only once completely written
+    QSaveFile output(path);
+    if (!output.open(QIODevice::WriteOnly)) {
+        result.error = output.errorString();
+        return result;
+    }
+    output.write(transposed.toUtf8());
+    if (!output.commit())
+        result.error = output.errorString();
+    return result;
+}
+
+QFuture<Transposition>
+ChordTransposer::transposeSongs(const QStringList &paths) const
+{
+    return QtConcurrent::mapped(paths, TransposeSong(*this));
+}
@@ -0,0 +1,130 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __CHORD_TRANSPOSER_HH__
+#define __CHORD_TRANSPOSER_HH__
+
+#include <QCoreApplication>
+#include <QFuture>
+#include <QString>
+#include <QStringList>
+
+/*!
+  \file chord-transposer.hh
+  \struct Transposition "chord-transposer.hh"
+  \brief Transposition is the result of the transposition of a song
+*/
+struct Transposition {
+    QString path;        /*!< the path of the .sg file.*/
+    int chords;          /*!< the number of transposed chords.*/
+    int diagrams;        /*!< the number of transposed \\gtab and \\utab
+                            diagrams.*/
+    int removedDiagrams; /*!< the diagrams that could not be moved (open
+                            strings or frets out of range) and whose new
+                            chord has no known fingering.*/
+    QString error;       /*!< the error message if the file was not written.*/
+};
+
+/*!
+  \class ChordTransposer
+  \brief ChordTransposer rewrites the chords of songs in another key
+
+  Chords are read from \\[...] in a single pass over the text of a
+  song. Every root and bass note (A to G, followed by # or & for sharps
+  and flats, as in the Songs LaTeX Package) is moved by the same number
+  of semitones, while the quality of the chord is kept:
+  \code
+  \[E&m7/B&]  transposed by 2 semitones  \[Fm7/C]
+  \endcode
+
+  Flats may also be written with a lowercase b (Bb, see
+  ChordIndex::normalizedName()); they are rewritten with &.
+
+  Notes are spelled with sharps or flats according to the key of the
+  transposed song, which is the key of the first chord of its lyrics
+  (the relative major key for a minor chord): flats for F, B&, E&, A&,
+  D& and G&, sharps otherwise.
+
+  The names of \\gtab and \\utab diagrams are transposed as well. Their
+  shapes are moved along the neck when they do not use open strings
+  and the new frets remain between 1 and 9; otherwise the shape is
+  replaced by a fingering of the FingeringDatabase, or the diagram is
+  removed and counted in Transposition::removedDiagrams.
+
+  All the functions of this class are reentrant and the fingerings are
+  looked up in the thread-safe FingeringDatabase, so that
+  transposeSongs() processes a selection of songs on the global thread
+  pool.
+*/
+class ChordTransposer
+{
+    Q_DECLARE_TR_FUNCTIONS(ChordTransposer)
+
+public:
+    /// Constructor.
+    ChordTransposer(int semitones = 0);
+
+    /*!
+    Returns the number of semitones of the transposition (0 to 11).
+  */
+    int semitones() const;
+
+    /*!
+    Returns the chord \a name (such as E&m7/B&) transposed. The notes
+    are spelled with flats if \a flats is true, with sharps otherwise.
+  */
+    QString transposeChord(const QString &name, bool flats) const;
+
+    /*!
+    Returns \a text (the content of a .sg file) with all its chords
+    transposed. \a result, if not null, receives the number of
+    transposed chords and diagrams.
+  */
+    QString transposeText(const QString &text,
+                          Transposition *result = 0) const;
+
+    /*!
+    Transposes the song \a path; the file is replaced atomically.
+  */
+    Transposition transposeSong(const QString &path) const;
+
+    /*!
+    Transposes the songs \a paths in parallel.
+  */
+    QFuture<Transposition> transposeSongs(const QStringList &paths) const;
+
+    /*!
+    Returns true if the major key whose tonic is the pitch class
+    \a pitch (0 for C) is written with flats.
+  */
+    static bool isFlatKey(int pitch);
+
+private:
+    int transposeNote(const QString &text, int position, bool flats,
+                      QString &output) const;
+    bool hasFlatKey(const QString &text) const;
+    int transposeChords(const QString &text, int begin, int end, bool flats,
+                        QString &output) const;
+    bool transposeDiagram(const QString &text, int &position, bool flats,
+                          QString &output, Transposition &result) const;
+    bool moveShape(QString &fret, QString &strings) const;
+
+    int m_semitones;
+};
+
+#endif // __CHORD_TRANSPOSER_HH__
@@ -18,12 +18,10 @@
 //******************************************************************************
 #include "chord.hh"
 #include "diagram-editor.hh"
+#include "diagram-renderer.hh"
 #include "utils/tango-colors.hh"
 
 #include <QPixmap>
-#include <QPixmapCache>
-#include <QRect>
-#include <QPainter>
 #include <QDebug>
 
 const QRegExp Chord::reChordWithFret(
@@ -37,18 +35,14 @@ const QColor Chord::_ukuleleChordColor(_TangoPlum1);
 const QColor Chord::_importantUkuleleChordColor(_TangoPlum3);
 
 Chord::Chord(const QString &chord, QObject *parent)
-    : QObject(parent), m_isValid(true), m_drawBorder(false), m_pixmap(0)
+    : QObject(parent), m_isValid(true), m_drawBorder(false)
 {
     fromString(chord);
 }
 
-Chord::~Chord()
-{
-    delete m_pixmap;
-    m_pixmap = 0;
-}
+Chord::~Chord() {}
 
-QString Chord::toString()
+QString Chord::toString() const
 {
     QString str;
     switch (m_instrument) {
@@ -105,139 +99,34 @@ void Chord::fromString(const QString &str)
 
 bool Chord::isValid() const { return m_isValid; }
 
-QPixmap *Chord::toPixmap()
+QPixmap Chord::toPixmap() const
 {
-    if (m_pixmap)
-        return m_pixmap;
-
     if (!isValid())
-        return 0;
-
-    m_pixmap = new QPixmap(100, 120);
-    m_pixmap->fill(Qt::white);
-
-    if (!QPixmapCache::find(toString(), m_pixmap)) {
-        QPainter painter;
-        painter.begin(m_pixmap);
-        painter.setRenderHint(QPainter::Antialiasing, true);
-
-        int cellWidth = 12, cellHeight = 12;
-        int width = (strings().length() - 1) * cellWidth;
-        int padding = 13;
-
-        // draw chord name
-        painter.setPen(QPen(Qt::white));
-        QRect chordRect(10, padding, 70, 10 + padding);
-        QPainterPath path;
-        path.addRoundedRect(chordRect, 4, 4);
-        painter.fillPath(path, color());
-        painter.setFont(QFont("Helvetica [Cronyx]", 10, QFont::Bold));
-        painter.drawText(chordRect, Qt::AlignCenter,
-                         name().replace("&", QChar(0x266D)));
-
-        // border
-        if (m_drawBorder) {
-            painter.setPen(QPen(color()));
-            painter.setBrush(QBrush());
-            QPainterPath border;
-            QRect borderRect(3, padding - 5, 82, 110);
-            border.addRoundedRect(borderRect, 4, 4);
-            painter.drawPath(border);
-        }
-
-        // draw horizontal lines
-        int max = 4;
-        foreach (QChar c, strings())
-            if (c.digitValue() > max)
-                max = c.digitValue();
-
-        // grid background
-        int hOffset =
-            (instrument() == Guitar) ? 0 : cellWidth; // offset from the left
-        int vOffset = 45;                             // offset from the top
-        QRect gridRect(4, vOffset, 80, cellHeight * max + padding + 5);
-
-        painter.setPen(QPen(Qt::black));
-        painter.fillRect(gridRect, QBrush(QColor(Qt::white)));
-
-        Q_ASSERT(max < 10);
-        for (int i = 0; i < max + 1; ++i) {
-            painter.drawLine(
-                padding + hOffset, i * cellHeight + padding + vOffset,
-                width + padding + hOffset, i * cellHeight + padding + vOffset);
-        }
-
-        int height = max * cellHeight;
-        // draw a vertical line for each string
-        for (int i = 0; i < strings().length(); ++i) {
-            painter.drawLine(
-                i * cellWidth + padding + hOffset, padding + vOffset,
-                i * cellWidth + padding + hOffset, height + padding + vOffset);
-        }
-
-        // draw played strings
-        for (int i = 0; i < strings().length(); ++i) {
-            QRect stringRect(0, 0, cellWidth - 4, cellHeight - 4);
-            int value = strings()[i].digitValue();
-            if (value == -1) {
-                stringRect.moveTo((i * cellWidth) + cellWidth / 2.0 + 3 +
-                                      hOffset,
-                                  3 + vOffset);
-                painter.setFont(QFont("Arial", 9));
-                painter.drawText(stringRect, Qt::AlignCenter, "X");
-            } else {
-                stringRect.moveTo((i * cellWidth) + cellWidth / 2.0 + 3 +
-                                      hOffset,
-                                  value * cellHeight + 3 + vOffset);
-                if (value == 0)
-                    painter.drawEllipse(stringRect);
-                else
-                    fillEllipse(&painter, stringRect,
-                                QBrush(QColor(Qt::black)));
-            }
-        }
-
-        // draw fret
-        QRect fretRect(padding - (cellWidth - 2) + hOffset,
-                       padding + (cellHeight + vOffset) / 2.0, cellWidth - 4,
-                       cellHeight + vOffset);
-        painter.setFont(QFont("Arial", 9));
-        painter.drawText(fretRect, Qt::AlignCenter, fret());
-
-        painter.end();
-        QPixmapCache::insert(toString(), *m_pixmap);
-    }
-
-    return m_pixmap;
+        return QPixmap();
+    return DiagramRenderer::instance()->diagram(*this);
 }
 
-void Chord::fillEllipse(QPainter *painter, const QRect &rect,
-                        const QBrush &brush)
-{
-    QPainterPath path;
-    path.addEllipse(rect.topLeft().x(), rect.topLeft().y(), rect.width(),
-                    rect.height());
-    ;
-    painter->fillPath(path, brush);
-}
+QColor Chord::color() const { return color(instrument(), isImportant()); }
 
-QColor Chord::color()
+QColor Chord::color(Instrument instrument, bool important)
 {
-    if (isImportant()) {
-        if (instrument() == Guitar)
+    if (important) {
+        if (instrument == Guitar)
             return _importantGuitarChordColor;
-        else if (instrument() == Ukulele)
+        else if (instrument == Ukulele)
             return _importantUkuleleChordColor;
     } else {
-        if (instrument() == Guitar)
+        if (instrument == Guitar)
             return _guitarChordColor;
-        else if (instrument() == Ukulele)
+        else if (instrument == Ukulele)
             return _ukuleleChordColor;
     }
 
     return QColor(Qt::white);
 }
 
+bool Chord::drawBorder() const { return m_drawBorder; }
+
 void Chord::setDrawBorder(bool value) { m_drawBorder = value; }
 
 QString Chord::name() const { return m_name; }
@@ -26,8 +26,6 @@
 #include <QBrush>
 #include <QRegExp>
 
-class QPainter;
-
 /*!
   \file chord.hh
   \class Chord
@@ -96,7 +94,7 @@ public:
     Returns the string representation of the chord.
     \sa fromString
   */
-    QString toString();
+    QString toString() const;
 
     /*!
     Builds a chord from a string.
@@ -106,9 +104,11 @@ public:
 
     /*!
     Returns the graphical representation (diagram) of the chord.
+    The diagram is shared with the other chords of the same shape; it
+    is blank while being rendered by the DiagramRenderer.
     \sa toString
   */
-    QPixmap *toPixmap();
+    QPixmap toPixmap() const;
 
     /*!
     Returns the chord name.
@@ -155,7 +155,19 @@ public:
     and whether or not it is important (yes: dark; no: light).
     \sa setType, setImportant
   */
-    QColor color();
+    QColor color() const;
+
+    /*!
+    Returns the color of the chords of the \a instrument that are
+    \a important or not.
+  */
+    static QColor color(Instrument instrument, bool important);
+
+    /*!
+    Returns true if a rounded path is drawn around the whole diagram.
+    \sa setDrawBorder
+  */
+    bool drawBorder() const;
 
     /*!
     Draws a rounded path around the whole diagram if \a value is true.
@@ -164,6 +176,18 @@ public:
   */
     void setDrawBorder(bool value);
 
+    /*!
+    Extracts the name, the fret and the strings of a chord such as
+    \code \gtab{E&m}{5:X02210} \endcode
+  */
+    const static QRegExp reChordWithFret;
+
+    /*!
+    Extracts the name and the strings of a chord without fret such as
+    \code \gtab{C}{X32010} \endcode
+  */
+    const static QRegExp reChordWithoutFret;
+
 public slots:
     /*!
     Sets the chord name \a name.
@@ -223,8 +247,6 @@ signals:
     void instrumentChanged();
 
 private:
-    void fillEllipse(QPainter *painter, const QRect &rect, const QBrush &brush);
-
     Instrument m_instrument;
     QString m_name;
     QString m_fret;
@@ -232,10 +254,6 @@ private:
     bool m_important;
     bool m_isValid;
     bool m_drawBorder;
-    QPixmap *m_pixmap;
-
-    const static QRegExp reChordWithFret;
-    const static QRegExp reChordWithoutFret;
 
     const static QColor _guitarChordColor;
     const static QColor _importantGuitarChordColor;
@@ -46,7 +46,15 @@
 #include <QDebug>
 
 CodeEditor::CodeEditor(QWidget *parent)
-    : QPlainTextEdit(parent), m_highlightMode(false), m_lineNumberMode(false)
+    : QPlainTextEdit(parent)
+    , m_highlightMode(false)
+    , m_lineNumberMode(false)
+    , m_largeDocumentMode(false)
+    , m_lineNumberAreaWidth(-1)
+    , m_digitPixmaps()
+    , m_digitWidth(0)
+    , m_firstVisibleBlock(-1)
+    , m_lastVisibleBlock(-1)
 {
     lineNumberArea = new LineNumberArea(this);
 
@@ -79,7 +87,23 @@ int CodeEditor::lineNumberAreaWidth()
 
 void CodeEditor::updateLineNumberAreaWidth(int /* newBlockCount */)
 {
-    setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
+    // the width only depends on the number of digits of the block count
+    int width = lineNumberAreaWidth();
+    if (width != m_lineNumberAreaWidth) {
+        m_lineNumberAreaWidth = width;
+        setViewportMargins(width, 0, 0, 0);
+    }
+
+    bool large = blockCount() > LargeDocumentBlockCount;
+    if (large != m_largeDocumentMode) {
+        m_largeDocumentMode = large;
+        m_firstVisibleBlock = -1;
+        m_lastVisibleBlock = -1;
+        if (large)
+            updateVisibleBlocks();
+        else
+            emit(visibleBlocksChanged(-1, -1));
+    }
 }
 
 void CodeEditor::updateLineNumberArea(const QRect &rect, int dy)
@@ -90,8 +114,8 @@ void CodeEditor::updateLineNumberArea(const QRect &rect, int dy)
         lineNumberArea->update(0, rect.y(), lineNumberArea->width(),
                                rect.height());
 
-    if (rect.contains(viewport()->rect()))
-        updateLineNumberAreaWidth(0);
+    if (m_largeDocumentMode && (dy || rect.contains(viewport()->rect())))
+        updateVisibleBlocks();
 }
 
 void CodeEditor::resizeEvent(QResizeEvent *e)
@@ -101,6 +125,70 @@ void CodeEditor::resizeEvent(QResizeEvent *e)
     QRect cr = contentsRect();
     lineNumberArea->setGeometry(
         QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+
+    if (m_largeDocumentMode)
+        updateVisibleBlocks();
+}
+
+void CodeEditor::changeEvent(QEvent *e)
+{
+    QPlainTextEdit::changeEvent(e);
+
+    if (e->type() == QEvent::FontChange) {
+        m_digitPixmaps.clear();
+        updateLineNumberAreaWidth(0);
+    }
+}
+
+bool CodeEditor::largeDocumentMode() const { return m_largeDocumentMode; }
+
+void CodeEditor::visibleBlocks(int &first, int &last) const
+{
+    QTextBlock block = firstVisibleBlock();
+    first = block.blockNumber();
+    last = first;
+
+    int bottom = viewport()->rect().bottom();
+    int top =
+        (int)blockBoundingGeometry(block).translated(contentOffset()).top();
+    while (block.isValid() && top <= bottom) {
+        last = block.blockNumber();
+        top += (int)blockBoundingRect(block).height();
+        block = block.next();
+    }
+}
+
+void CodeEditor::updateVisibleBlocks()
+{
+    int first;
+    int last;
+    visibleBlocks(first, last);
+    if (first != m_firstVisibleBlock || last != m_lastVisibleBlock) {
+        m_firstVisibleBlock = first;
+        m_lastVisibleBlock = last;
+        emit(visibleBlocksChanged(first, last));
+    }
+}
+
+void CodeEditor::updateDigitPixmaps()
+{
+    // each digit is drawn once with the current font
+    const QFontMetrics metrics = fontMetrics();
+    const int ratio = devicePixelRatio();
+    m_digitWidth = metrics.width(QLatin1Char('9'));
+    m_digitPixmaps.clear();
+    for (int digit = 0; digit < 10; ++digit) {
+        QPixmap pixmap(m_digitWidth * ratio, metrics.height() * ratio);
+        pixmap.setDevicePixelRatio(ratio);
+        pixmap.fill(Qt::transparent);
+
+        QPainter painter(&pixmap);
+        painter.setFont(font());
+        painter.setPen(Qt::black);
+        painter.drawText(0, 0, m_digitWidth, metrics.height(), Qt::AlignRight,
+                         QString::number(digit));
+        m_digitPixmaps << pixmap;
+    }
 }
 
 QTextEdit::ExtraSelection CodeEditor::currentLineSelection()
@@ -123,6 +211,9 @@ void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event)
     QPainter painter(lineNumberArea);
     painter.fillRect(event->rect(), Qt::lightGray);
 
+    if (m_digitPixmaps.isEmpty())
+        updateDigitPixmaps();
+
     QTextBlock block = firstVisibleBlock();
     int blockNumber = block.blockNumber();
     int top =
@@ -131,10 +222,12 @@ void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event)
 
     while (block.isValid() && top <= event->rect().bottom()) {
         if (block.isVisible() && bottom >= event->rect().top()) {
-            QString number = QString::number(blockNumber + 1);
-            painter.setPen(Qt::black);
-            painter.drawText(0, top, lineNumberArea->width(),
-                             fontMetrics().height(), Qt::AlignRight, number);
+            // right-aligned digits, from the last one
+            int x = lineNumberArea->width();
+            for (int number = blockNumber + 1; number > 0; number /= 10) {
+                x -= m_digitWidth;
+                painter.drawPixmap(x, top, m_digitPixmaps[number % 10]);
+            }
         }
 
         block = block.next();
@@ -44,6 +44,8 @@
 #include <QObject>
 #include <QPlainTextEdit>
 #include <QKeyEvent>
+#include <QPixmap>
+#include <QVector>
 
 class QPaintEvent;
 class QResizeEvent;
@@ -61,6 +63,14 @@ class LineNumberArea;
  *  \li displaying the current line number on the left
  *  \li highlighting the current line
  *
+ * The digits of the line numbers are rendered once into pixmaps that
+ * are reused by every repaint of the line number area.
+ *
+ * Documents of more than LargeDocumentBlockCount lines switch the
+ * editor to the large-document mode: visibleBlocksChanged() is then
+ * emitted when the visible lines change, so that the costly features
+ * (syntax highlighting, environments) may be limited to them.
+ *
  * The original code can be found at :
  * http://doc.trolltech.com/4.7/widgets-codeeditor-codeeditor-cpp.html
  *
@@ -84,17 +94,43 @@ public:
 
     QTextEdit::ExtraSelection currentLineSelection();
 
+    /// Number of lines from which the large-document mode is used.
+    static const int LargeDocumentBlockCount = 5000;
+
+    bool largeDocumentMode() const;
+
+    /// Returns the numbers of the first and last visible blocks.
+    void visibleBlocks(int &first, int &last) const;
+
+signals:
+    /// Emitted, in large-document mode only, when the visible blocks
+    /// change or when the mode is switched (\a first is then -1 if the
+    /// whole document should be processed).
+    void visibleBlocksChanged(int first, int last);
+
 protected:
     void resizeEvent(QResizeEvent *event);
+    void changeEvent(QEvent *event);
 
 private slots:
     void updateLineNumberAreaWidth(int newBlockCount);
     void updateLineNumberArea(const QRect &, int);
 
 private:
+    void updateDigitPixmaps();
+    void updateVisibleBlocks();
+
     QWidget *lineNumberArea;
     bool m_highlightMode;
     bool m_lineNumberMode;
+    bool m_largeDocumentMode;
+
+    int m_lineNumberAreaWidth;
+    QVector<QPixmap> m_digitPixmaps;
+    int m_digitWidth;
+
+    int m_firstVisibleBlock;
+    int m_lastVisibleBlock;
 };
 
 /**
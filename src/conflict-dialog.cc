@@ -20,7 +20,7 @@
 #include "conflict-dialog.hh"
 #include "song.hh"
 
-#include "diff_match_patch/diff_match_patch.h"
+#include "diff-dialog.hh"
 
 #include <QUrl>
 #include <QDir>
@@ -36,9 +36,8 @@
 #include <QPixmap>
 #include <QPixmapCache>
 #include <QDesktopServices>
-#include <QCryptographicHash>
-#include <QWizard>
-#include <QPlainTextEdit>
+#include <QMessageBox>
+#include <QCloseEvent>
 
 #include <QDebug>
 
@@ -51,7 +50,9 @@ ConflictDialog::ConflictDialog(QWidget *parent)
     , m_albumLabel(new QLabel)
     , m_coverLabel(new QLabel)
     , m_pixmap(new QPixmap(42, 42))
-    , m_fileCopier(new FileCopier(parent))
+    , m_fileCopier(new FileCopier(this))
+    , m_analysisWatcher(new QFutureWatcher<ImportItem>(this))
+    , m_songCount(0)
 {
     setWindowTitle(tr("Resolve conflicts"));
     setParent(static_cast<MainWindow *>(parent));
@@ -73,6 +74,11 @@ ConflictDialog::ConflictDialog(QWidget *parent)
     buttonBox->addButton(m_diffButton, QDialogButtonBox::ActionRole);
 
     connect(progressBar(), SIGNAL(canceled()), SLOT(cancelCopy()));
+    connect(m_fileCopier, SIGNAL(progress(int, int, qint64)),
+            SLOT(copyProgress(int, int, qint64)));
+    connect(m_fileCopier, SIGNAL(error(const QString &, const QString &)),
+            SLOT(copyError(const QString &, const QString &)));
+    connect(m_fileCopier, SIGNAL(finished()), SLOT(copyFinished()));
 
     m_conflictView->setColumnWidth(0, 290);
     m_conflictView->setColumnWidth(1, 290);
@@ -87,16 +93,20 @@ ConflictDialog::ConflictDialog(QWidget *parent)
     connect(m_conflictView, SIGNAL(itemDoubleClicked(QTableWidgetItem *)), this,
             SLOT(openItem(QTableWidgetItem *)));
 
-    QLabel *messageLabel = new QLabel;
-    messageLabel->setText(tr("Importing the following source items would "
-                             "overwrite those target items: "));
-    messageLabel->setWordWrap(true);
+    connect(m_analysisWatcher, SIGNAL(resultsReadyAt(int, int)),
+            SLOT(analysisResultsReady(int, int)));
+    connect(m_analysisWatcher, SIGNAL(finished()), SLOT(analysisFinished()));
+
+    m_mainLabel = new QLabel;
+    m_mainLabel->setText(tr("Importing the following source items would "
+                            "overwrite those target items: "));
+    m_mainLabel->setWordWrap(true);
     QIcon warningIcon = QIcon::fromTheme("dialog-warning");
     QLabel *iconLabel = new QLabel;
     iconLabel->setPixmap(warningIcon.pixmap(32, 32));
     QHBoxLayout *warningLayout = new QHBoxLayout;
     warningLayout->addWidget(iconLabel);
-    warningLayout->addWidget(messageLabel, 1);
+    warningLayout->addWidget(m_mainLabel, 1);
     warningLayout->addStretch();
 
     QHBoxLayout *detailsLayout = new QHBoxLayout;
@@ -126,13 +136,15 @@ ConflictDialog::ConflictDialog(QWidget *parent)
 
 ConflictDialog::~ConflictDialog()
 {
+    m_analysisWatcher->cancel();
+    m_analysisWatcher->waitForFinished();
+
     delete m_conflictView;
     delete m_titleLabel;
     delete m_artistLabel;
     delete m_albumLabel;
     delete m_coverLabel;
     delete m_pixmap;
-    delete m_fileCopier;
 }
 
 void ConflictDialog::setParent(MainWindow *parent) { m_parent = parent; }
@@ -154,14 +166,21 @@ void ConflictDialog::updateItemDetails(QTableWidgetItem *item)
     QString path = item->data(Qt::ToolTipRole).toString();
     QFileInfo fi(path);
 
-    Song song = Song::fromFile(path);
+    // songs read from an archive are not files
+    const ImportItem importItem = m_items.value(path);
+    Song song = importItem.contents.isEmpty()
+                    ? Song::fromFile(path)
+                    : Song::headerFromData(importItem.contents, path);
     m_titleLabel->setText(song.title);
     m_artistLabel->setText(song.artist);
     m_albumLabel->setText(song.album);
 
     QString cover =
         QString("%1/%2.jpg").arg(fi.absolutePath()).arg(song.coverName);
-    if (QFile(cover).exists()) {
+    if (!importItem.cover.isEmpty() &&
+        m_pixmap->loadFromData(importItem.cover)) {
+        *m_pixmap = m_pixmap->scaled(42, 42);
+    } else if (QFile(cover).exists()) {
         m_pixmap->load(cover);
         *m_pixmap = m_pixmap->scaled(42, 42);
     } else if (!QPixmapCache::find("cover-missing-full", m_pixmap)) {
@@ -190,140 +209,229 @@ void ConflictDialog::openItem(QTableWidgetItem *item)
     }
 }
 
-void ConflictDialog::setSourceTargetFiles(const QMap<QString, QString> &files)
+void ConflictDialog::analyzeSongs(const QStringList &filenames,
+                                  const QString &directory)
+{
+    reset(filenames.size());
+
+    ImportAnalyzer analyzer(directory);
+    m_analysisWatcher->setFuture(analyzer.analyzeSongs(filenames));
+}
+
+void ConflictDialog::setItems(const QList<ImportItem> &items)
+{
+    reset(items.size());
+
+    foreach (const ImportItem &item, items)
+        addItem(item);
+    analysisComplete();
+}
+
+void ConflictDialog::reset(int songCount)
 {
     m_conflictsFound = false;
-    m_conflictView->setRowCount(files.size());
-    int row = 0;
-    QMap<QString, QString>::const_iterator it = files.constBegin();
-    while (it != files.constEnd()) {
-        if (QFile(it.value()).exists()) {
-            QFile source(it.key());
-            QFile target(it.value());
-
-            if (source.open(QIODevice::ReadOnly) &&
-                target.open(QIODevice::ReadOnly)) {
-                QCryptographicHash sourceHash(QCryptographicHash::Sha1);
-                sourceHash.addData(source.readAll());
-                source.close();
-
-                QCryptographicHash targetHash(QCryptographicHash::Sha1);
-                targetHash.addData(target.readAll());
-                target.close();
-
-                if (sourceHash.result() != targetHash.result()) {
-                    m_conflictsFound = true;
-                    m_conflicts.insert(it.key(), it.value());
-
-                    QFileInfo fileInfo(it.key());
-                    QTableWidgetItem *srcItem = new QTableWidgetItem;
-                    srcItem->setIcon(QIcon(":/icons/songbook/48x48/song.png"));
-                    srcItem->setData(Qt::DisplayRole, fileInfo.fileName());
-                    srcItem->setData(Qt::ToolTipRole,
-                                     fileInfo.absoluteFilePath());
-                    m_conflictView->setItem(row, 0, srcItem);
-
-                    fileInfo = QFileInfo(it.value());
-                    QTableWidgetItem *targetItem = new QTableWidgetItem;
-                    targetItem->setIcon(
-                        QIcon(":/icons/songbook/48x48/song.png"));
-                    targetItem->setData(Qt::DisplayRole, fileInfo.fileName());
-                    targetItem->setData(Qt::ToolTipRole,
-                                        fileInfo.absoluteFilePath());
-                    m_conflictView->setItem(row, 1, targetItem);
-                    ++row;
-                } else {
-                    m_noConflicts.insert(it.key(), it.value());
-                }
-            }
-        }
-        ++it;
+    m_conflicts.clear();
+    m_noConflicts.clear();
+    m_items.clear();
+    m_unreadable.clear();
+    m_conflictView->setRowCount(0);
+    m_songCount = songCount;
+
+    // conflicts are resolved once every song is analyzed
+    m_overwriteButton->setEnabled(false);
+    m_keepOriginalButton->setEnabled(false);
+    m_mainLabel->setText(tr("Analyzing %1 songs...").arg(m_songCount));
+}
+
+void ConflictDialog::addItem(const ImportItem &item)
+{
+    m_items.insert(item.source, item);
+    switch (item.status) {
+    case ImportItem::Conflict:
+        addConflict(item);
+        break;
+    case ImportItem::NewSong:
+    case ImportItem::Identical:
+        m_noConflicts.insert(item.source, item.target);
+        break;
+    case ImportItem::Unreadable:
+        m_unreadable << item.source;
+        break;
+    default:
+        break;
     }
+}
+
+void ConflictDialog::analysisResultsReady(int begin, int end)
+{
+    for (int i = begin; i < end; ++i)
+        addItem(m_analysisWatcher->resultAt(i));
 
-    m_conflictView->setRowCount(row);
-    if (row > 0)
-        updateItemDetails(m_conflictView->itemAt(0, 0));
+    m_mainLabel->setText(tr("Analyzing %1 songs: %2 conflicts found...")
+                             .arg(m_songCount)
+                             .arg(m_conflicts.size()));
 }
 
-bool ConflictDialog::conflictsFound() const { return m_conflictsFound; }
+void ConflictDialog::addConflict(const ImportItem &item)
+{
+    m_conflictsFound = true;
+    m_conflicts.insert(item.source, item.target);
+
+    int row = m_conflictView->rowCount();
+    m_conflictView->insertRow(row);
+
+    QFileInfo fileInfo(item.source);
+    QTableWidgetItem *srcItem = new QTableWidgetItem;
+    srcItem->setIcon(QIcon(":/icons/songbook/48x48/song.png"));
+    srcItem->setData(Qt::DisplayRole, fileInfo.fileName());
+    srcItem->setData(Qt::ToolTipRole, fileInfo.absoluteFilePath());
+    m_conflictView->setItem(row, 0, srcItem);
+
+    fileInfo = QFileInfo(item.target);
+    QTableWidgetItem *targetItem = new QTableWidgetItem;
+    targetItem->setIcon(QIcon(":/icons/songbook/48x48/song.png"));
+    targetItem->setData(Qt::DisplayRole, fileInfo.fileName());
+    targetItem->setData(Qt::ToolTipRole, fileInfo.absoluteFilePath());
+    m_conflictView->setItem(row, 1, targetItem);
+
+    if (row == 0)
+        updateItemDetails(srcItem);
+}
 
-void ConflictDialog::cancelCopy() { m_fileCopier->setCancelCopy(true); }
+void ConflictDialog::analysisFinished()
+{
+    if (!m_analysisWatcher->isCanceled())
+        analysisComplete();
+}
 
-void ConflictDialog::showDiff()
+void ConflictDialog::analysisComplete()
 {
-    QWizard *wizard = new QWizard(this);
-    wizard->setWindowTitle("Show differences");
-
-    QMap<QString, QString>::const_iterator it = m_conflicts.constBegin();
-    while (it != m_conflicts.constEnd()) {
-        QFile source(it.key());
-        QFile target(it.value());
-
-        if (source.open(QIODevice::ReadOnly) &&
-            target.open(QIODevice::ReadOnly)) {
-            // retrieve source song infos
-            Song song = Song::fromFile(it.key());
-            QFileInfo fi(it.key());
-            QString cover =
-                QString("%1/%2.jpg").arg(fi.absolutePath()).arg(song.coverName);
-            QPixmap *pixmap = 0;
-            if (QFile(cover).exists()) {
-                pixmap = new QPixmap(cover);
-                *pixmap = pixmap->scaled(42, 42);
-            }
-
-            // retrieve diffs info
-            diff_match_patch *dmp = new diff_match_patch();
-            QList<Diff> diffList =
-                dmp->diff_main(source.readAll(), target.readAll());
-            source.close();
-            target.close();
-            dmp->diff_cleanupSemantic(diffList);
-
-            // setup wizard page
-            QWizardPage *page = new QWizardPage;
-            page->setTitle(song.title);
-            page->setSubTitle(song.artist);
-            if (pixmap && !pixmap->isNull())
-                page->setPixmap(QWizard::LogoPixmap, *pixmap);
-
-            QPlainTextEdit *area = new QPlainTextEdit;
-            area->setReadOnly(true);
-            area->appendHtml(dmp->diff_prettyHtml(diffList));
-            area->moveCursor(QTextCursor::Start);
-
-            QVBoxLayout *layout = new QVBoxLayout;
-            layout->addWidget(area);
-            page->setLayout(layout);
-            wizard->addPage(page);
-        }
-        ++it;
+    if (!m_unreadable.isEmpty())
+        QMessageBox::warning(this, tr("Unreadable songs"),
+                             tr("The following items can't be read and "
+                                "won't be imported:\n%1")
+                                 .arg(m_unreadable.join("\n")));
+
+    // songs without conflict are imported without asking
+    if (!m_conflictsFound) {
+        copySongs(false);
+        return;
     }
 
-    wizard->show();
+    m_mainLabel->setText(tr("Importing the following source items would "
+                            "overwrite those target items: "));
+    m_overwriteButton->setEnabled(true);
+    m_keepOriginalButton->setEnabled(true);
+}
+
+void ConflictDialog::closeEvent(QCloseEvent *event)
+{
+    m_analysisWatcher->cancel();
+    QDialog::closeEvent(event);
+}
+
+bool ConflictDialog::conflictsFound() const { return m_conflictsFound; }
+
+void ConflictDialog::reject()
+{
+    // the dialog is accepted once the files being copied are discarded
+    if (m_fileCopier->isCopying()) {
+        m_fileCopier->cancel();
+        return;
+    }
+    QDialog::reject();
+}
+
+void ConflictDialog::cancelCopy() { m_fileCopier->cancel(); }
+
+void ConflictDialog::showDiff()
+{
+    QList<QPair<QString, QString> > songs;
+    for (int row = 0; row < m_conflictView->rowCount(); ++row)
+        songs << qMakePair(
+            m_conflictView->item(row, 0)->data(Qt::ToolTipRole).toString(),
+            m_conflictView->item(row, 1)->data(Qt::ToolTipRole).toString());
+    if (songs.isEmpty())
+        return;
+
+    QHash<QString, QByteArray> contents;
+    foreach (const ImportItem &item, m_items)
+        if (!item.contents.isEmpty())
+            contents.insert(item.source, item.contents);
+
+    // differences are computed page by page
+    DiffDialog *dialog = new DiffDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setContents(contents);
+    dialog->setSongs(songs);
+    dialog->setCurrentIndex(qMax(0, m_conflictView->currentRow()));
+    dialog->show();
 }
 
 bool ConflictDialog::resolve()
 {
     QPushButton *button = qobject_cast<QPushButton *>(QObject::sender());
-    if (button == m_overwriteButton) {
-        QMap<QString, QString>::const_iterator it = m_conflicts.constBegin();
-        while (it != m_conflicts.constEnd()) {
-            QFile target(it.value());
-            if (!target.remove()) {
-                parent()->statusBar()->showMessage(
-                    tr("An unexpected error occurred while removing: %1")
-                        .arg(target.fileName()));
-            }
-            ++it;
+    copySongs(button == m_overwriteButton);
+    return true;
+}
+
+void ConflictDialog::copySongs(bool overwrite)
+{
+    // targets are replaced atomically: they are not removed beforehand
+    QMap<QString, QString> files = m_noConflicts;
+    if (overwrite)
+        files.unite(m_conflicts);
+
+    // songs read from an archive are written from memory with their cover
+    QHash<QString, QByteArray> contents;
+    foreach (const QString &source, files.keys()) {
+        const ImportItem item = m_items.value(source);
+        if (!item.contents.isEmpty())
+            contents.insert(source, item.contents);
+        if (!item.cover.isEmpty()) {
+            files.insert(item.coverSource, item.coverTarget);
+            contents.insert(item.coverSource, item.cover);
         }
-        m_fileCopier->setSourceTargets(m_conflicts.unite(m_noConflicts));
-    } else if (button == m_keepOriginalButton) {
-        m_fileCopier->setSourceTargets(m_noConflicts);
     }
 
+    m_overwriteButton->setEnabled(false);
+    m_keepOriginalButton->setEnabled(false);
+
+    progressBar()->setCancelable(true);
+    progressBar()->setRange(0, qMax(1, files.size()));
+    progressBar()->setValue(0);
+    progressBar()->show();
+
+    m_fileCopier->setOverwrite(overwrite);
+    m_fileCopier->setSourceTargets(files);
+    m_fileCopier->setContents(contents);
     m_fileCopier->copy();
+}
+
+void ConflictDialog::copyProgress(int count, int total,
+                                  qint64 bytesPerSecond)
+{
+    progressBar()->setValue(count);
+    m_mainLabel->setText(tr("Copying %1 of %2 songs (%3 KiB/s)...")
+                             .arg(count)
+                             .arg(total)
+                             .arg(bytesPerSecond / 1024));
+}
 
+void ConflictDialog::copyError(const QString &source, const QString &target)
+{
+    showMessage(tr("An unexpected error occurred while copying: %1 to %2")
+                    .arg(source)
+                    .arg(target));
+}
+
+void ConflictDialog::copyFinished()
+{
+    progressBar()->hide();
+    if (m_fileCopier->isCanceled())
+        showMessage(tr("Import canceled: %1 songs copied")
+                        .arg(m_fileCopier->copiedCount()));
+
+    // the library is updated even if the copy was canceled
     accept();
-    return true;
 }
@@ -22,9 +22,14 @@
 
 #include "main-window.hh"
 #include "progress-bar.hh"
+#include "import-analyzer.hh"
+#include "file-copier.hh"
 
 #include <QDialog>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QString>
+#include <QStringList>
 #include <QMap>
 #include <QStatusBar>
 
@@ -35,7 +40,6 @@ class QPushButton;
 class QPixmap;
 
 class ProgressBar;
-class FileCopier;
 
 /*!
   \file conflict-dialog.hh
@@ -54,6 +58,15 @@ class FileCopier;
   href="http://code.google.com/p/google-diff-match-patch/">diff_match_patch</a>
   library)
 
+  The imported songs are analyzed in the background by an
+  ImportAnalyzer: conflicts are added to the list as soon as they are
+  found and the songs are copied once the analysis is complete. When no
+  conflict is found, the new songs are copied without asking.
+
+  The songs are copied in the background by a FileCopier and the
+  dialog is accepted once the copy is complete. Closing the dialog
+  during the copy cancels it.
+
   \image html conflict-dialog.png
 
 */
@@ -70,16 +83,21 @@ public:
     virtual ~ConflictDialog();
 
     /*!
-    Define \a map as the double list of existing / to be imported files
-    Key: path to source file (new song)
-    Value: path to target file (existing song)
+    Analyzes the songs \a filenames that are imported in the library
+    whose canonical path is \a directory.
   */
-    void setSourceTargetFiles(const QMap<QString, QString> &map);
+    void analyzeSongs(const QStringList &filenames, const QString &directory);
+
+    /*!
+    Displays the conflicts among \a items, the songs that have already
+    been analyzed by an ImportAnalyzer.
+  */
+    void setItems(const QList<ImportItem> &items);
 
     /*!
     Determines whether there are some conflicts between
     source and target files. Returns \a true if
-    there are some conflicting names, \a false otherwise.
+    some conflicting names have been found so far, \a false otherwise.
   */
     bool conflictsFound() const;
 
@@ -124,12 +142,29 @@ private slots:
     void updateItemDetails(QTableWidgetItem *item);
     void openItem(QTableWidgetItem *item);
     void cancelCopy();
+    void analysisResultsReady(int begin, int end);
+    void analysisFinished();
+    void copyProgress(int count, int total, qint64 bytesPerSecond);
+    void copyError(const QString &source, const QString &target);
+    void copyFinished();
+
+protected:
+    void closeEvent(QCloseEvent *event);
+    void reject();
 
 private:
+    void reset(int songCount);
+    void addItem(const ImportItem &item);
+    void addConflict(const ImportItem &item);
+    void analysisComplete();
+    void copySongs(bool overwrite);
+
     MainWindow *m_parent;
     bool m_conflictsFound;
     QMap<QString, QString> m_conflicts;
     QMap<QString, QString> m_noConflicts;
+    QHash<QString, ImportItem> m_items;
+    QStringList m_unreadable;
 
     QLabel *m_mainLabel;
 
@@ -147,79 +182,9 @@ private:
     QPushButton *m_diffButton;
 
     FileCopier *m_fileCopier;
-};
-
-/*!
-  \file conflict-dialog.hh
-  \class FileCopier
-  \brief FileCopier manages the copy of potentially conflicting files
-*/
-class FileCopier : public QObject
-{
-    Q_OBJECT
 
-public:
-    /// Constructor
-    FileCopier(QWidget *parent) : m_cancelCopy(false)
-    {
-        setParent(static_cast<MainWindow *>(parent));
-    }
-
-    /// Define \a files as the list of source / target files to be copied
-    void setSourceTargets(QMap<QString, QString> &files)
-    {
-        m_sourceTargets = files;
-    }
-
-    /// Returns \a true if the copy can be interrupted
-    bool cancelCopy() const { return m_cancelCopy; }
-
-    /// Returns the parent widget
-    MainWindow *parent() const { return m_parent; }
-
-    /// Defines the parent widget
-    void setParent(MainWindow *parent) { m_parent = parent; }
-
-    /// If value is \a true, the copy can be interrupted
-    void setCancelCopy(bool value) { m_cancelCopy = value; }
-
-public slots:
-
-    /*!
-    Performs the copy operation of sources to targets
-    \sa setSourceTargets
-  */
-    void copy()
-    {
-        int count = 0;
-        ProgressBar *progressBar = parent()->progressBar();
-        progressBar->setRange(0, m_sourceTargets.size());
-        progressBar->show();
-
-        QMap<QString, QString>::const_iterator it =
-            m_sourceTargets.constBegin();
-        while (it != m_sourceTargets.constEnd()) {
-            if (cancelCopy())
-                break;
-
-            QFile source(it.key());
-            QFile target(it.value());
-            if (!target.exists() && !source.copy(target.fileName())) {
-                parent()->statusBar()->showMessage(
-                    tr("An unexpected error occurred while copying: %1 to %2")
-                        .arg(source.fileName())
-                        .arg(target.fileName()));
-            }
-            progressBar->setValue(++count);
-            ++it;
-        }
-        progressBar->hide();
-    }
-
-private:
-    MainWindow *m_parent;
-    bool m_cancelCopy;
-    QMap<QString, QString> m_sourceTargets;
+    QFutureWatcher<ImportItem> *m_analysisWatcher;
+    int m_songCount;
 };
 
 #endif // __CONFLICT_DIALOG_HH
@@ -62,13 +62,11 @@ DiagramArea::DiagramArea(QWidget *parent)
     m_diagramView->setStyleSheet(
         "QTableView::item { border: 0px; padding: 10px;}");
     m_diagramView->setShowGrid(false);
+    m_diagramView->verticalHeader()->setDefaultSectionSize(120);
     m_diagramView->setContextMenuPolicy(Qt::CustomContextMenu);
 
     connect(m_diagramView, SIGNAL(clicked(const QModelIndex &)), this,
             SLOT(onViewClicked(const QModelIndex &)));
-    connect(m_diagramModel, SIGNAL(layoutChanged()), this, SLOT(resizeRows()));
-
-    connect(this, SIGNAL(layoutChanged()), this, SLOT(resizeRows()));
     connect(this, SIGNAL(readOnlyModeChanged()), this, SLOT(update()));
 
     QBoxLayout *mainLayout = new QHBoxLayout;
@@ -113,14 +111,7 @@ void DiagramArea::update()
 void DiagramArea::onViewClicked(const QModelIndex &index)
 {
     if (index.isValid())
-        emit(diagramClicked(
-            m_diagramModel->getChord(m_proxyModel->mapToSource(index))));
-}
-
-void DiagramArea::resizeRows()
-{
-    for (int i = 0; i < m_diagramModel->rowCount(); ++i)
-        m_diagramView->setRowHeight(i, 120);
+        emit(diagramClicked(index.data(Qt::DisplayRole).toString()));
 }
 
 void DiagramArea::newDiagram() { editDiagram(QModelIndex()); }
@@ -135,18 +126,18 @@ void DiagramArea::editDiagram(QModelIndex index)
 
     bool newChord = !index.isValid();
 
-    Chord *chord = newChord ? new Chord : m_diagramModel->getChord(
-                                              m_proxyModel->mapToSource(index));
+    Chord chord(newChord ? QString("\\gtab{}{0:}")
+                         : index.data(Qt::DisplayRole).toString());
 
     DiagramEditor dialog(this);
-    dialog.setChord(chord);
+    dialog.setChord(&chord);
 
     if (dialog.exec() == QDialog::Accepted) {
         if (newChord)
-            addDiagram(chord->toString());
+            addDiagram(chord.toString());
         else
             m_diagramModel->setData(m_proxyModel->mapToSource(index),
-                                    chord->toString());
+                                    chord.toString());
 
         emit(contentsChanged());
     }
@@ -157,6 +148,11 @@ void DiagramArea::addDiagram(const QString &chord)
     m_diagramModel->addItem(chord);
 }
 
+void DiagramArea::setDiagrams(const QStringList &chords)
+{
+    m_diagramModel->setChords(chords);
+}
+
 void DiagramArea::removeDiagram(QModelIndex index)
 {
     if (!index.isValid())
@@ -241,13 +237,7 @@ void DiagramArea::setColumnCount(int value)
 
 void DiagramArea::setRowCount(int value) { m_diagramModel->setRowCount(value); }
 
-QList<Chord *> DiagramArea::chords()
+QStringList DiagramArea::diagrams() const
 {
-    QList<Chord *> list;
-    for (int i = 0; i < m_diagramModel->rowCount(); ++i)
-        for (int j = 0; j < m_diagramModel->columnCount(); ++j) {
-            list << m_diagramModel->getChord(m_diagramModel->index(i, j));
-        }
-
-    return list;
+    return m_diagramModel->chords();
 }
@@ -22,6 +22,7 @@
 #include <QWidget>
 #include <QModelIndex>
 #include <QString>
+#include <QStringList>
 #include <QList>
 #include <QPoint>
 #include <QVector>
@@ -128,11 +129,11 @@ public:
     void setRowCount(int value);
 
     /*!
-    Returns all the chords. Note that it returns chords from the model, not the
-    view;
+    Returns all the chords in their string representation. Note that it
+    returns chords from the model, not the view;
     thus, filtered chords are also included.
   */
-    QList<Chord *> chords();
+    QStringList diagrams() const;
 
 public slots:
     /*!
@@ -147,6 +148,12 @@ public slots:
   */
     void addDiagram(const QString &chord);
 
+    /*!
+    Replaces the list by the chords \a chords at once.
+    The user is responsible for the correctness of the chords.
+  */
+    void setDiagrams(const QStringList &chords);
+
     /*!
     Triggers a DiagramEditor associated to the chord at position \a index.
     This slot is only available in editable mode.
@@ -187,7 +194,6 @@ public slots:
 
 private slots:
     void update();
-    void resizeRows();
     void onDiagramChanged();
     void contextMenu(const QPoint &pos);
     void onViewClicked(const QModelIndex &);
@@ -217,7 +223,7 @@ signals:
     /*!
     This signal is emitted when a chord from the list is clicked.
   */
-    void diagramClicked(Chord *diagram);
+    void diagramClicked(const QString &diagram);
 
 private:
     bool m_isReadOnly;
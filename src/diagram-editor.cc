@@ -20,6 +20,7 @@
 
 #include "song.hh"
 #include "diagram-area.hh"
+#include "fingering-database.hh"
 
 #include <QFile>
 #include <QScrollArea>
@@ -29,6 +30,7 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QSpinBox>
+#include <QComboBox>
 #include <QCheckBox>
 #include <QGroupBox>
 #include <QRadioButton>
@@ -40,6 +42,7 @@
 
 DiagramEditor::DiagramEditor(QWidget *parent)
     : QDialog(parent)
+    , m_stringsProposed(false)
     , m_infoIconLabel(new QLabel(this))
     , m_messageLabel(new QLabel(this))
     , m_diagramArea(0)
@@ -85,6 +88,14 @@ DiagramEditor::DiagramEditor(QWidget *parent)
         "  0: string is to be played open\n"
         "  [1-9]: string is to be played on the given numbered fret."));
 
+    m_fingeringComboBox = new QComboBox;
+    m_fingeringComboBox->setToolTip(
+        tr("Usual fingerings of the chord, the easiest first"));
+    connect(m_fingeringComboBox, SIGNAL(activated(int)), this,
+            SLOT(fingeringActivated(int)));
+    connect(m_nameLineEdit, SIGNAL(textEdited(const QString &)), this,
+            SLOT(updateFingerings()));
+
     QRegExp rx("[X\\d]+");
     QRegExpValidator *validator = new QRegExpValidator(rx, 0);
     m_stringsLineEdit->setValidator(validator);
@@ -107,6 +118,7 @@ DiagramEditor::DiagramEditor(QWidget *parent)
     chordLayout->addRow(tr("Name:"), m_nameLineEdit);
     chordLayout->addRow(tr("Fret:"), m_fretSpinBox);
     chordLayout->addRow(tr("Strings:"), m_stringsLineEdit);
+    chordLayout->addRow(tr("Fingerings:"), m_fingeringComboBox);
 
     QSettings settings;
     settings.beginGroup("global");
@@ -126,8 +138,8 @@ DiagramEditor::DiagramEditor(QWidget *parent)
                 m_diagramArea, SLOT(setNameFilter(const QString &)));
         connect(m_stringsLineEdit, SIGNAL(textChanged(const QString &)),
                 m_diagramArea, SLOT(setStringsFilter(const QString &)));
-        connect(m_diagramArea, SIGNAL(diagramClicked(Chord *)), this,
-                SLOT(setChord(Chord *)));
+        connect(m_diagramArea, SIGNAL(diagramClicked(const QString &)), this,
+                SLOT(setDiagram(const QString &)));
 
         QTextStream stream(&file);
         stream.setCodec("UTF-8");
@@ -137,9 +149,11 @@ DiagramEditor::DiagramEditor(QWidget *parent)
         // parse chords.tex for gtab/utab
         QString line;
         QStringList lines = content.split("\n");
+        QStringList diagrams;
         foreach (line, lines)
             if (line.contains("\\gtab") || line.contains("\\utab"))
-                m_diagramArea->addDiagram(line.simplified());
+                diagrams << line.simplified();
+        m_diagramArea->setDiagrams(diagrams);
     }
 
     QBoxLayout *formLayout = new QVBoxLayout;
@@ -185,6 +199,8 @@ void DiagramEditor::reset()
     m_stringsLineEdit->clear();
     m_fretSpinBox->setValue(0);
     m_importantCheckBox->setChecked(false);
+    m_fingeringComboBox->clear();
+    m_stringsProposed = false;
 
     if (m_diagramArea)
         m_diagramArea->clearFilters();
@@ -203,6 +219,8 @@ void DiagramEditor::setChord(Chord *chord)
     m_fretSpinBox->setValue(chord->fret().toInt());
     m_stringsLineEdit->setText(chord->strings());
     m_importantCheckBox->setChecked(chord->isImportant());
+    m_stringsProposed = false;
+    updateFingerings();
 
     connect(m_nameLineEdit, SIGNAL(textChanged(const QString &)), m_chord,
             SLOT(setName(const QString &)));
@@ -221,6 +239,26 @@ void DiagramEditor::setChord(Chord *chord)
         m_diagramArea->clearFilters();
 }
 
+void DiagramEditor::setDiagram(const QString &diagram)
+{
+    Chord chord(diagram);
+    if (!chord.isValid())
+        return;
+
+    // the form updates the edited chord
+    m_guitar->setChecked(chord.instrument() == Chord::Guitar);
+    m_ukulele->setChecked(chord.instrument() == Chord::Ukulele);
+    m_nameLineEdit->setText(chord.name());
+    m_fretSpinBox->setValue(chord.fret().toInt());
+    m_stringsLineEdit->setText(chord.strings());
+    m_importantCheckBox->setChecked(chord.isImportant());
+    m_stringsProposed = false;
+    updateFingerings();
+
+    if (m_diagramArea)
+        m_diagramArea->clearFilters();
+}
+
 Chord *DiagramEditor::chord() const { return m_chord; }
 
 bool DiagramEditor::checkChord()
@@ -274,4 +312,37 @@ void DiagramEditor::onInstrumentChanged(bool checked)
         m_stringsLineEdit->setMaxLength(Chord::GuitarStringCount);
     else
         m_stringsLineEdit->setMaxLength(Chord::UkuleleStringCount);
+
+    updateFingerings();
+}
+
+void DiagramEditor::updateFingerings()
+{
+    Chord::Instrument instrument =
+        m_ukulele->isChecked() ? Chord::Ukulele : Chord::Guitar;
+    QStringList fingerings =
+        FingeringDatabase::fingerings(m_nameLineEdit->text(), instrument);
+
+    m_fingeringComboBox->clear();
+    m_fingeringComboBox->addItems(fingerings);
+    m_fingeringComboBox->setEnabled(!fingerings.isEmpty());
+
+    // a new chord gets the easiest fingering
+    if (!fingerings.isEmpty() && m_nameLineEdit->isModified() &&
+        (m_stringsLineEdit->text().isEmpty() ||
+         (m_stringsProposed && !m_stringsLineEdit->isModified())))
+        fingeringActivated(0);
+}
+
+void DiagramEditor::fingeringActivated(int index)
+{
+    QString fingering = m_fingeringComboBox->itemText(index);
+    if (fingering.isEmpty())
+        return;
+
+    QString fret = fingering.contains(':') ? fingering.section(':', 0, 0)
+                                            : QString("0");
+    m_fretSpinBox->setValue(fret.toInt());
+    m_stringsLineEdit->setText(fingering.section(':', -1));
+    m_stringsProposed = true;
 }
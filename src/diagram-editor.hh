@@ -28,6 +28,7 @@ class QSpinBox;
 class QRadioButton;
 class QCheckBox;
 class QLabel;
+class QComboBox;
 
 class Chord;
 class DiagramArea;
@@ -42,9 +43,13 @@ class DiagramArea;
   properties of a Chord object and of a list of common chords (a
   DiagramArea object) that may be selected.
 
+  The fingerings of the chord name known by the FingeringDatabase are
+  proposed in a combo box; the strings of a new chord are filled with
+  the easiest fingering while its name is typed.
+
   \image html chord-editor.png
 
-  \sa Chord, DiagramArea
+  \sa Chord, DiagramArea, FingeringDatabase
 */
 class DiagramEditor : public QDialog
 {
@@ -74,10 +79,18 @@ public slots:
   */
     void setChord(Chord *chord);
 
+    /*!
+    Fills the form of the dialog with the properties of the chord
+    \a diagram, such as \\gtab{Am}{X02210}.
+  */
+    void setDiagram(const QString &diagram);
+
 private slots:
     bool checkChord();
     void onInstrumentChanged(bool);
     void reset();
+    void updateFingerings();
+    void fingeringActivated(int index);
 
 private:
     // chord
@@ -87,6 +100,8 @@ private:
     QLineEdit *m_stringsLineEdit;
     QSpinBox *m_fretSpinBox;
     QCheckBox *m_importantCheckBox;
+    QComboBox *m_fingeringComboBox;
+    bool m_stringsProposed;
     // info
     QLabel *m_infoIconLabel;
     QLabel *m_messageLabel;
@@ -0,0 +1,301 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "diagram-renderer.hh"
+
+#include "chord.hh"
+
+#include <QGuiApplication>
+#include <QPainter>
+#include <QPainterPath>
+#include <QtConcurrent>
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+// size of the cache of diagrams (in kilobytes)
+const int DiagramCacheSize = 16 * 1024;
+
+// strings of a chord that can be packed into the shape of its key
+const int MaxPackedStrings = 12;
+
+// packed value of a fret or a string that is not a digit
+const quint64 NoDigit = 15;
+
+enum ShapeFlag {
+    UkuleleFlag = 0x1,
+    ImportantFlag = 0x2,
+    BorderFlag = 0x4,
+    UnpackedFlag = 0x8
+};
+
+const int FretShift = 4;
+const int StringCountShift = 8;
+const int StringsShift = 12;
+
+quint64 packDigit(const QChar &c)
+{
+    int value = c.digitValue();
+    return (value == -1) ? NoDigit : quint64(value);
+}
+
+QString unpackDigit(quint64 value)
+{
+    return (value == NoDigit) ? QString("X") : QString::number(value);
+}
+
+void fillEllipse(QPainter *painter, const QRect &rect, const QBrush &brush)
+{
+    QPainterPath path;
+    path.addEllipse(rect.topLeft().x(), rect.topLeft().y(), rect.width(),
+                    rect.height());
+    painter->fillPath(path, brush);
+}
+}
+
+bool operator==(const DiagramKey &key, const DiagramKey &other)
+{
+    return key.shape == other.shape && key.scale == other.scale &&
+           key.name == other.name;
+}
+
+uint qHash(const DiagramKey &key)
+{
+    return qHash(key.shape) ^ qHash(key.name) ^ uint(key.scale);
+}
+
+DiagramRenderer::DiagramRenderer()
+    : QObject()
+    , m_diagrams(DiagramCacheSize)
+    , m_renderings()
+    , m_renderingKeys()
+    , m_blankDiagrams()
+{
+}
+
+DiagramRenderer::~DiagramRenderer()
+{
+    foreach (QFutureWatcher<QImage> *watcher, m_renderings)
+        watcher->waitForFinished();
+}
+
+QSize DiagramRenderer::size()
+{
+    return QSize(100, 120);
+}
+
+DiagramKey DiagramRenderer::key(const Chord &chord, qreal ratio)
+{
+    DiagramKey key;
+    key.shape = 0;
+    key.name = chord.name();
+    key.scale = qRound(ratio * 100);
+
+    if (chord.instrument() == Chord::Ukulele)
+        key.shape |= UkuleleFlag;
+    if (chord.isImportant())
+        key.shape |= ImportantFlag;
+    if (chord.drawBorder())
+        key.shape |= BorderFlag;
+
+    QString fret = chord.fret();
+    QString strings = chord.strings();
+    if (fret.size() > 1 || (fret.size() == 1 && !fret[0].isDigit()) ||
+        strings.size() > MaxPackedStrings) {
+        key.shape |= UnpackedFlag;
+        key.name = QString("%1\n%2\n%3").arg(chord.name(), fret, strings);
+        return key;
+    }
+
+    key.shape |= (fret.isEmpty() ? NoDigit : packDigit(fret[0]))
+                 << FretShift;
+    key.shape |= quint64(strings.size()) << StringCountShift;
+    for (int i = 0; i < strings.size(); ++i)
+        key.shape |= packDigit(strings[i]) << (StringsShift + 4 * i);
+    return key;
+}
+
+QImage DiagramRenderer::render(const DiagramKey &key)
+{
+    // unpack the chord
+    Chord::Instrument instrument =
+        (key.shape & UkuleleFlag) ? Chord::Ukulele : Chord::Guitar;
+    bool drawBorder = (key.shape & BorderFlag) != 0;
+    QColor color =
+        Chord::color(instrument, (key.shape & ImportantFlag) != 0);
+
+    QString name = key.name;
+    QString fret;
+    QString strings;
+    if (key.shape & UnpackedFlag) {
+        QStringList fields = key.name.split('\n');
+        name = fields.value(0);
+        fret = fields.value(1);
+        strings = fields.value(2);
+    } else {
+        quint64 fretValue = (key.shape >> FretShift) & 0xf;
+        if (fretValue != NoDigit)
+            fret = QString::number(fretValue);
+        int count = (key.shape >> StringCountShift) & 0xf;
+        for (int i = 0; i < count; ++i)
+            strings += unpackDigit((key.shape >> (StringsShift + 4 * i)) & 0xf);
+    }
+
+    qreal ratio = key.scale / 100.0;
+    QImage image(size() * ratio, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(ratio);
+    image.fill(Qt::white);
+
+    QPainter painter;
+    painter.begin(&image);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+
+    int cellWidth = 12, cellHeight = 12;
+    int width = (strings.length() - 1) * cellWidth;
+    int padding = 13;
+
+    // draw chord name
+    painter.setPen(QPen(Qt::white));
+    QRect chordRect(10, padding, 70, 10 + padding);
+    QPainterPath path;
+    path.addRoundedRect(chordRect, 4, 4);
+    painter.fillPath(path, color);
+    painter.setFont(QFont("Helvetica [Cronyx]", 10, QFont::Bold));
+    painter.drawText(chordRect, Qt::AlignCenter,
+                     name.replace("&", QChar(0x266D)));
+
+    // border
+    if (drawBorder) {
+        painter.setPen(QPen(color));
+        painter.setBrush(QBrush());
+        QPainterPath border;
+        QRect borderRect(3, padding - 5, 82, 110);
+        border.addRoundedRect(borderRect, 4, 4);
+        painter.drawPath(border);
+    }
+
+    // draw horizontal lines
+    int max = 4;
+    foreach (QChar c, strings)
+        if (c.digitValue() > max)
+            max = c.digitValue();
+
+    // grid background
+    int hOffset =
+        (instrument == Chord::Guitar) ? 0 : cellWidth; // offset from the left
+    int vOffset = 45;                                  // offset from the top
+    QRect gridRect(4, vOffset, 80, cellHeight * max + padding + 5);
+
+    painter.setPen(QPen(Qt::black));
+    painter.fillRect(gridRect, QBrush(QColor(Qt::white)));
+
+    Q_ASSERT(max < 10);
+    for (int i = 0; i < max + 1; ++i) {
+        painter.drawLine(
+            padding + hOffset, i * cellHeight + padding + vOffset,
+            width + padding + hOffset, i * cellHeight + padding + vOffset);
+    }
+
+    int height = max * cellHeight;
+    // draw a vertical line for each string
+    for (int i = 0; i < strings.length(); ++i) {
+        painter.drawLine(
+            i * cellWidth + padding + hOffset, padding + vOffset,
+            i * cellWidth + padding + hOffset, height + padding + vOffset);
+    }
+
+    // draw played strings
+    for (int i = 0; i < strings.length(); ++i) {
+        QRect stringRect(0, 0, cellWidth - 4, cellHeight - 4);
+        int value = strings[i].digitValue();
+        if (value == -1) {
+            stringRect.moveTo((i * cellWidth) + cellWidth / 2.0 + 3 + hOffset,
+                              3 + vOffset);
+            painter.setFont(QFont("Arial", 9));
+            painter.drawText(stringRect, Qt::AlignCenter, "X");
+        } else {
+            stringRect.moveTo((i * cellWidth) + cellWidth / 2.0 + 3 + hOffset,
+                              value * cellHeight + 3 + vOffset);
+            if (value == 0)
+                painter.drawEllipse(stringRect);
+            else
+                fillEllipse(&painter, stringRect, QBrush(QColor(Qt::black)));
+        }
+    }
+
+    // draw fret
+    QRect fretRect(padding - (cellWidth - 2) + hOffset,
+                   padding + (cellHeight + vOffset) / 2.0, cellWidth - 4,
+                   cellHeight + vOffset);
+    painter.setFont(QFont("Arial", 9));
+    painter.drawText(fretRect, Qt::AlignCenter, fret);
+
+    painter.end();
+    return image;
+}
+
+QPixmap DiagramRenderer::diagram(const Chord &chord)
+{
+    return diagram(chord, qApp->devicePixelRatio());
+}
+
+QPixmap DiagramRenderer::diagram(const Chord &chord, qreal ratio)
+{
+    return diagram(key(chord, ratio));
+}
+
+QPixmap DiagramRenderer::diagram(const DiagramKey &diagramKey)
+{
+    if (QPixmap *pixmap = m_diagrams.object(diagramKey))
+        return *pixmap;
+
+    if (!m_renderings.contains(diagramKey)) {
+        QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+        connect(watcher, SIGNAL(finished()), SLOT(renderingFinished()));
+        m_renderings.insert(diagramKey, watcher);
+        m_renderingKeys.insert(watcher, diagramKey);
+        watcher->setFuture(
+            QtConcurrent::run(&DiagramRenderer::render, diagramKey));
+    }
+
+    // a blank diagram of the same size is displayed in the meantime
+    if (!m_blankDiagrams.contains(diagramKey.scale)) {
+        qreal ratio = diagramKey.scale / 100.0;
+        QPixmap blank(size() * ratio);
+        blank.setDevicePixelRatio(ratio);
+        blank.fill(Qt::white);
+        m_blankDiagrams.insert(diagramKey.scale, blank);
+    }
+    return m_blankDiagrams[diagramKey.scale];
+}
+
+void DiagramRenderer::renderingFinished()
+{
+    QFutureWatcher<QImage> *watcher =
+        static_cast<QFutureWatcher<QImage> *>(sender());
+    DiagramKey diagramKey = m_renderingKeys.take(watcher);
+    m_renderings.remove(diagramKey);
+
+    QPixmap *pixmap = new QPixmap(QPixmap::fromImage(watcher->result()));
+    m_diagrams.insert(diagramKey, pixmap,
+                      pixmap->width() * pixmap->height() * 4 / 1024);
+    watcher->deleteLater();
+
+    emit(diagramRendered(diagramKey));
+}
@@ -0,0 +1,131 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __DIAGRAM_RENDERER_HH__
+#define __DIAGRAM_RENDERER_HH__
+
+#include <QObject>
+#include <QCache>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QString>
+
+#include "singleton.hh"
+
+class Chord;
+
+/*!
+  \struct DiagramKey
+  \brief DiagramKey identifies the diagram of a chord
+
+  The instrument, the importance, the border, the fret and the strings
+  of the chord are packed into \a shape (4 bits per string). The rare
+  chords that do not fit are identified by their full text in \a name.
+*/
+struct DiagramKey
+{
+    quint64 shape; ///< packed shape of the diagram
+    QString name;  ///< name of the chord
+    int scale;     ///< device pixel ratio in percent
+};
+
+bool operator==(const DiagramKey &key, const DiagramKey &other);
+uint qHash(const DiagramKey &key);
+
+/*!
+  \file diagram-renderer.hh
+  \class DiagramRenderer
+  \brief DiagramRenderer draws and caches the diagrams of the chords
+
+  Diagrams are shared by all the chords with the same shape and name:
+  they are kept in a cache of limited size where the least recently
+  used diagrams are discarded first.
+
+  A diagram that is not in the cache is rendered into a QImage by a
+  background thread, at the device pixel ratio of the screen. A blank
+  diagram is returned in the meantime and diagramRendered() is emitted
+  with the key of the diagram once it is available.
+
+  \code
+  QPixmap pixmap = DiagramRenderer::instance()->diagram(chord);
+  \endcode
+*/
+class DiagramRenderer : public QObject, public Singleton<DiagramRenderer>
+{
+    Q_OBJECT
+    friend class Singleton<DiagramRenderer>;
+
+public:
+    /*!
+    Returns the diagram of \a chord for the device pixel ratio \a ratio.
+    If the diagram is being rendered, a blank diagram is returned.
+  */
+    QPixmap diagram(const Chord &chord, qreal ratio);
+
+    /*!
+    Returns the diagram of \a chord for the device pixel ratio of the
+    application.
+  */
+    QPixmap diagram(const Chord &chord);
+
+    /*!
+    Returns the diagram identified by \a key.
+    If the diagram is being rendered, a blank diagram is returned.
+  */
+    QPixmap diagram(const DiagramKey &key);
+
+    /*!
+    Returns the key of the diagram of \a chord for the device pixel
+    ratio \a ratio.
+  */
+    static DiagramKey key(const Chord &chord, qreal ratio);
+
+    /*!
+    Draws the diagram identified by \a key.
+    This function is thread-safe.
+  */
+    static QImage render(const DiagramKey &key);
+
+    /*!
+    Returns the size of a diagram in device independent pixels.
+  */
+    static QSize size();
+
+signals:
+    /*!
+    This signal is emitted when the diagram identified by \a key has
+    been rendered.
+  */
+    void diagramRendered(const DiagramKey &key);
+
+private slots:
+    void renderingFinished();
+
+private:
+    DiagramRenderer();
+    ~DiagramRenderer();
+
+    QCache<DiagramKey, QPixmap> m_diagrams;
+    QHash<DiagramKey, QFutureWatcher<QImage> *> m_renderings;
+    QHash<QFutureWatcher<QImage> *, DiagramKey> m_renderingKeys;
+    QHash<int, QPixmap> m_blankDiagrams;
+};
+
+#endif // __DIAGRAM_RENDERER_HH__
@@ -0,0 +1,127 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "dictionary-service.hh"
+
+#ifdef ENABLE_SPELLCHECK
+
+#include <QFileInfo>
+#include <QSettings>
+#include <QtConcurrent>
+
+#include "spell-checker.hh"
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+// settings key of the words added to a dictionary
+QString userWordsKey(const QString &dictionary)
+{
+    return QString("words-%1").arg(QFileInfo(dictionary).baseName());
+}
+
+SpellChecker *loadDictionary(const QString &dictionary,
+                             const QStringList &words)
+{
+    SpellChecker *checker = new SpellChecker(dictionary);
+    foreach (const QString &word, words)
+        checker->add(word);
+    return checker;
+}
+}
+
+DictionaryService::DictionaryService()
+    : QObject()
+    , m_dictionaries()
+    , m_loadings()
+    , m_wordsAddedWhileLoading()
+{
+}
+
+DictionaryService::~DictionaryService()
+{
+    foreach (QFutureWatcher<SpellChecker *> *watcher, m_loadings.keys()) {
+        watcher->waitForFinished();
+        delete watcher->result();
+    }
+}
+
+QSharedPointer<SpellChecker>
+DictionaryService::dictionary(const QString &dictionary)
+{
+    if (m_dictionaries.contains(dictionary))
+        return m_dictionaries.value(dictionary);
+
+    if (!isLoading(dictionary)) {
+        QFutureWatcher<SpellChecker *> *watcher =
+            new QFutureWatcher<SpellChecker *>(this);
+        connect(watcher, SIGNAL(finished()), SLOT(loadingFinished()));
+        m_loadings.insert(watcher, dictionary);
+        watcher->setFuture(QtConcurrent::run(loadDictionary, dictionary,
+                                             userWords(dictionary)));
+    }
+    return QSharedPointer<SpellChecker>();
+}
+
+bool DictionaryService::isLoading(const QString &dictionary) const
+{
+    return m_loadings.values().contains(dictionary);
+}
+
+void DictionaryService::loadingFinished()
+{
+    QFutureWatcher<SpellChecker *> *watcher =
+        static_cast<QFutureWatcher<SpellChecker *> *>(sender());
+    QString dictionary = m_loadings.take(watcher);
+    QSharedPointer<SpellChecker> checker(watcher->result());
+    foreach (const QString &word, m_wordsAddedWhileLoading.take(dictionary))
+        checker->add(word);
+    m_dictionaries.insert(dictionary, checker);
+    watcher->deleteLater();
+    emit(dictionaryLoaded(dictionary));
+}
+
+void DictionaryService::addWord(const QString &dictionary, const QString &word)
+{
+    QSettings settings;
+    settings.beginGroup("spellcheck");
+    QStringList words = settings.value(userWordsKey(dictionary)).toStringList();
+    if (!words.contains(word)) {
+        words << word;
+        settings.setValue(userWordsKey(dictionary), words);
+    }
+    settings.endGroup();
+
+    QSharedPointer<SpellChecker> checker = m_dictionaries.value(dictionary);
+    if (checker)
+        checker->add(word);
+    else if (isLoading(dictionary))
+        m_wordsAddedWhileLoading[dictionary] << word;
+}
+
+QStringList DictionaryService::userWords(const QString &dictionary)
+{
+    QSettings settings;
+    settings.beginGroup("spellcheck");
+    QStringList words = settings.value(userWordsKey(dictionary)).toStringList();
+    settings.endGroup();
+    return words;
+}
+
+#endif // ENABLE_SPELLCHECK
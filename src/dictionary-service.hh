@@ -0,0 +1,103 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __DICTIONARY_SERVICE_HH__
+#define __DICTIONARY_SERVICE_HH__
+
+#include "config.hh"
+
+#ifdef ENABLE_SPELLCHECK
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QSharedPointer>
+#include <QStringList>
+
+#include "singleton.hh"
+
+class SpellChecker;
+
+/*!
+  \file dictionary-service.hh
+  \class DictionaryService
+  \brief DictionaryService shares the Hunspell dictionaries of the application
+
+  Each dictionary is loaded only once, in the background, and the
+  resulting SpellChecker is shared by all the editors; its lookups are
+  thread-safe. The words added by the user are saved in the settings
+  and added to the dictionary whenever it is loaded.
+
+  \code
+  QSharedPointer<SpellChecker> checker =
+      DictionaryService::instance()->dictionary("/usr/share/hunspell/fr_FR.dic");
+  if (!checker)
+      ; // wait for dictionaryLoaded()
+  \endcode
+*/
+class DictionaryService : public QObject, public Singleton<DictionaryService>
+{
+    Q_OBJECT
+    friend class Singleton<DictionaryService>;
+
+public:
+    /*!
+    Returns the SpellChecker of the \a dictionary (.dic file) if it is
+    already loaded. Otherwise, starts loading it in the background and
+    returns a null pointer; dictionaryLoaded() is emitted once it is
+    available.
+  */
+    QSharedPointer<SpellChecker> dictionary(const QString &dictionary);
+
+    /*!
+    Returns \a true if the \a dictionary is being loaded.
+  */
+    bool isLoading(const QString &dictionary) const;
+
+    /*!
+    Adds \a word to the \a dictionary and saves it so that it is
+    recognized in the following sessions.
+  */
+    void addWord(const QString &dictionary, const QString &word);
+
+    /*!
+    Returns the words added by the user to the \a dictionary.
+  */
+    static QStringList userWords(const QString &dictionary);
+
+signals:
+    /*!
+    This signal is emitted when the \a dictionary has been loaded.
+  */
+    void dictionaryLoaded(const QString &dictionary);
+
+private slots:
+    void loadingFinished();
+
+private:
+    DictionaryService();
+    ~DictionaryService();
+
+    QHash<QString, QSharedPointer<SpellChecker> > m_dictionaries;
+    QHash<QFutureWatcher<SpellChecker *> *, QString> m_loadings;
+    QHash<QString, QStringList> m_wordsAddedWhileLoading;
+};
+
+#endif // ENABLE_SPELLCHECK
+
+#endif // __DICTIONARY_SERVICE_HH__
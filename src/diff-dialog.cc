@@ -0,0 +1,243 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "diff-dialog.hh"
+
+#include "diff-view.hh"
+#include "line-diff.hh"
+#include "song.hh"
+
+#include <QBoxLayout>
+#include <QDialogButtonBox>
+#include <QFile>
+#include <QFileInfo>
+#include <QLabel>
+#include <QPixmap>
+#include <QPushButton>
+#include <QTextStream>
+#include <QThreadStorage>
+#include <QtConcurrent>
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+// pairs of songs compared in advance after the displayed one
+const int PrefetchCount = 3;
+
+// differences kept in memory
+const int CachedDiffCount = 16;
+
+const int CoverSize = 42;
+
+// one LineDiff per thread of the pool, so that its buffers are reused
+QThreadStorage<LineDiff *> lineDiffs;
+
+bool readText(const QString &path, QString &text)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    text = stream.readAll();
+    return true;
+}
+}
+
+DiffDialog::DiffDialog(QWidget *parent)
+    : QDialog(parent)
+    , m_songs()
+    , m_contents()
+    , m_diffs(CachedDiffCount)
+    , m_comparisons()
+    , m_currentIndex(-1)
+    , m_coverLabel(new QLabel(this))
+    , m_titleLabel(new QLabel(this))
+    , m_artistLabel(new QLabel(this))
+    , m_positionLabel(new QLabel(this))
+    , m_diffView(new DiffView(this))
+    , m_previousButton(new QPushButton(tr("Previous"), this))
+    , m_nextButton(new QPushButton(tr("Next"), this))
+{
+    setWindowTitle(tr("Show differences"));
+
+    QFont font = m_titleLabel->font();
+    font.setBold(true);
+    m_titleLabel->setFont(font);
+    m_coverLabel->setFixedSize(CoverSize, CoverSize);
+
+    QDialogButtonBox *buttonBox =
+        new QDialogButtonBox(QDialogButtonBox::Close);
+    buttonBox->addButton(m_previousButton, QDialogButtonBox::ActionRole);
+    buttonBox->addButton(m_nextButton, QDialogButtonBox::ActionRole);
+    connect(buttonBox, SIGNAL(rejected()), SLOT(close()));
+    connect(m_previousButton, SIGNAL(clicked()), SLOT(previous()));
+    connect(m_nextButton, SIGNAL(clicked()), SLOT(next()));
+
+    QBoxLayout *songLayout = new QVBoxLayout;
+    songLayout->addWidget(m_titleLabel);
+    songLayout->addWidget(m_artistLabel);
+
+    QBoxLayout *headerLayout = new QHBoxLayout;
+    headerLayout->addLayout(songLayout, 1);
+    headerLayout->addWidget(m_positionLabel);
+    headerLayout->addWidget(m_coverLabel);
+
+    QBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addLayout(headerLayout);
+    mainLayout->addWidget(m_diffView, 1);
+    mainLayout->addWidget(buttonBox);
+    setLayout(mainLayout);
+
+    resize(600, 500);
+}
+
+DiffDialog::~DiffDialog() {}
+
+void DiffDialog::setSongs(const QList<QPair<QString, QString> > &songs)
+{
+    m_songs = songs;
+    m_diffs.clear();
+    m_currentIndex = -1;
+    setCurrentIndex(0);
+}
+
+void DiffDialog::setContents(const QHash<QString, QByteArray> &contents)
+{
+    m_contents = contents;
+    m_diffs.clear();
+}
+
+int DiffDialog::currentIndex() const { return m_currentIndex; }
+
+void DiffDialog::setCurrentIndex(int index)
+{
+    if (index < 0 || index >= m_songs.size() || index == m_currentIndex)
+        return;
+
+    m_currentIndex = index;
+    for (int i = index; i <= index + PrefetchCount; ++i)
+        compare(i);
+    display();
+}
+
+void DiffDialog::next() { setCurrentIndex(m_currentIndex + 1); }
+
+void DiffDialog::previous() { setCurrentIndex(m_currentIndex - 1); }
+
+void DiffDialog::compare(int index)
+{
+    if (index >= m_songs.size() || m_diffs.contains(index))
+        return;
+
+    foreach (int comparedIndex, m_comparisons)
+        if (comparedIndex == index)
+            return;
+
+    QFutureWatcher<SongDiff> *watcher = new QFutureWatcher<SongDiff>(this);
+    connect(watcher, SIGNAL(finished()), SLOT(comparisonFinished()));
+    m_comparisons.insert(watcher, index);
+    const QString &source = m_songs[index].first;
+    watcher->setFuture(QtConcurrent::run(&DiffDialog::compareSongs, source,
+                                         m_songs[index].second,
+                                         m_contents.value(source)));
+}
+
+void DiffDialog::comparisonFinished()
+{
+    QFutureWatcher<SongDiff> *watcher =
+        static_cast<QFutureWatcher<SongDiff> *>(sender());
+    int index = m_comparisons.take(watcher);
+    m_diffs.insert(index, new SongDiff(watcher->result()));
+    watcher->deleteLater();
+
+    if (index == m_currentIndex)
+        display();
+}
+
+void DiffDialog::display()
+{
+    m_positionLabel->setText(
+        tr("%1 of %2").arg(m_currentIndex + 1).arg(m_songs.size()));
+    m_previousButton->setEnabled(m_currentIndex > 0);
+    m_nextButton->setEnabled(m_currentIndex + 1 < m_songs.size());
+
+    const QString &source = m_songs[m_currentIndex].first;
+    SongDiff *songDiff = m_diffs.object(m_currentIndex);
+    if (!songDiff) {
+        m_titleLabel->setText(QFileInfo(source).fileName());
+        m_artistLabel->setText(tr("Comparing..."));
+        m_coverLabel->clear();
+        m_diffView->clear();
+        return;
+    }
+
+    m_titleLabel->setText(songDiff->title.isEmpty()
+                              ? QFileInfo(source).fileName()
+                              : songDiff->title);
+    if (songDiff->isValid)
+        m_artistLabel->setText(songDiff->artist);
+    else
+        m_artistLabel->setText(tr("The songs cannot be read"));
+
+    if (songDiff->cover.isNull())
+        m_coverLabel->clear();
+    else
+        m_coverLabel->setPixmap(QPixmap::fromImage(songDiff->cover));
+
+    m_diffView->setDiffs(songDiff->diffs);
+}
+
+SongDiff DiffDialog::compareSongs(const QString &source,
+                                  const QString &target,
+                                  const QByteArray &contents)
+{
+    SongDiff songDiff;
+    Song song = contents.isEmpty() ? Song::headerFromFile(source)
+                                   : Song::headerFromData(contents, source);
+    songDiff.title = song.title;
+    songDiff.artist = song.artist;
+
+    QString cover =
+        QString("%1/%2.jpg").arg(song.coverPath).arg(song.coverName);
+    if (!song.coverName.isEmpty() && QFile::exists(cover)) {
+        QImage image(cover);
+        if (!image.isNull())
+            songDiff.cover = image.scaled(CoverSize, CoverSize,
+                                          Qt::KeepAspectRatio,
+                                          Qt::SmoothTransformation);
+    }
+
+    QString sourceText;
+    QString targetText;
+    bool sourceRead = true;
+    if (contents.isEmpty())
+        sourceRead = readText(source, sourceText);
+    else
+        sourceText = QString::fromUtf8(contents).replace("\r\n", "\n");
+    songDiff.isValid = sourceRead && readText(target, targetText);
+    if (!songDiff.isValid)
+        return songDiff;
+
+    if (!lineDiffs.hasLocalData())
+        lineDiffs.setLocalData(new LineDiff);
+    songDiff.diffs = lineDiffs.localData()->diff(sourceText, targetText);
+    return songDiff;
+}
@@ -0,0 +1,136 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __DIFF_DIALOG_HH__
+#define __DIFF_DIALOG_HH__
+
+#include <QDialog>
+#include <QByteArray>
+#include <QCache>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#include "diff_match_patch/diff_match_patch.h"
+
+class QLabel;
+class QPushButton;
+class DiffView;
+
+/*!
+  \struct SongDiff "diff-dialog.hh"
+  \brief SongDiff is the comparison of two versions of a song
+*/
+struct SongDiff {
+    QString title;     /*!< the title of the source song.*/
+    QString artist;    /*!< the artist of the source song.*/
+    QImage cover;      /*!< the cover of the source song.*/
+    QList<Diff> diffs; /*!< the differences from the source to the target.*/
+    bool isValid;      /*!< \a false if a song could not be read.*/
+};
+
+/*!
+  \file diff-dialog.hh
+  \class DiffDialog
+  \brief DiffDialog displays the differences between pairs of songs
+
+  The pairs of songs are displayed one at a time, with buttons to move
+  to the previous and to the next pair.
+
+  The differences of a pair are only computed when it is about to be
+  displayed: they are computed in the background for the current pair
+  and for the next few ones, and the last computed differences are kept
+  in a cache of limited size. The differences are computed line by
+  line, then word by word within the modified lines, by a LineDiff.
+
+  \image html conflict-diff.png
+*/
+class DiffDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    DiffDialog(QWidget *parent = 0);
+
+    /// Destructor.
+    ~DiffDialog();
+
+    /*!
+    Sets the pairs of songs to compare, as paths of the source and of
+    the target .sg files.
+  */
+    void setSongs(const QList<QPair<QString, QString> > &songs);
+
+    /*!
+    Sets \a contents as the contents of the source songs that are not
+    files, such as songs read from an archive.
+  */
+    void setContents(const QHash<QString, QByteArray> &contents);
+
+    /*!
+    Returns the index of the displayed pair of songs.
+  */
+    int currentIndex() const;
+
+    /*!
+    Compares the song \a source to the song \a target. The source is
+    read from \a contents unless it is empty.
+    This function is thread-safe.
+  */
+    static SongDiff compareSongs(const QString &source, const QString &target,
+                                 const QByteArray &contents = QByteArray());
+
+public slots:
+    /*!
+    Displays the pair of songs at position \a index.
+  */
+    void setCurrentIndex(int index);
+
+    /// Displays the next pair of songs.
+    void next();
+
+    /// Displays the previous pair of songs.
+    void previous();
+
+private slots:
+    void comparisonFinished();
+
+private:
+    void compare(int index);
+    void display();
+
+    QList<QPair<QString, QString> > m_songs;
+    QHash<QString, QByteArray> m_contents;
+    QCache<int, SongDiff> m_diffs;
+    QHash<QFutureWatcher<SongDiff> *, int> m_comparisons;
+    int m_currentIndex;
+
+    QLabel *m_coverLabel;
+    QLabel *m_titleLabel;
+    QLabel *m_artistLabel;
+    QLabel *m_positionLabel;
+    DiffView *m_diffView;
+    QPushButton *m_previousButton;
+    QPushButton *m_nextButton;
+};
+
+#endif // __DIFF_DIALOG_HH__
@@ -0,0 +1,183 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "diff-view.hh"
+
+#include <QAbstractListModel>
+#include <QPainter>
+#include <QStyledItemDelegate>
+#include <QVector>
+
+#include "utils/tango-colors.hh"
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+// margin on the left and on the right of the lines
+const int Margin = 4;
+
+// displayed instead of a line break that is inserted or deleted
+const QChar Pilcrow(0x00B6);
+
+struct DiffSegment
+{
+    Operation operation;
+    QString text;
+};
+
+typedef QVector<DiffSegment> DiffLine;
+
+class DiffModel : public QAbstractListModel
+{
+public:
+    DiffModel(QObject *parent) : QAbstractListModel(parent), m_lines() {}
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const
+    {
+        return parent.isValid() ? 0 : m_lines.size();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const
+    {
+        if (!index.isValid() || role != Qt::DisplayRole)
+            return QVariant();
+
+        QString text;
+        foreach (const DiffSegment &segment, m_lines[index.row()])
+            text += segment.text;
+        return text;
+    }
+
+    const DiffLine &line(int row) const { return m_lines[row]; }
+
+    void setDiffs(const QList<Diff> &diffs)
+    {
+        beginResetModel();
+        m_lines.clear();
+
+        DiffLine line;
+        foreach (const Diff &diff, diffs) {
+            QStringList parts = diff.text.split('\n');
+            for (int i = 0; i < parts.size(); ++i) {
+                if (i > 0) {
+                    if (diff.operation != EQUAL)
+                        addSegment(line, diff.operation, Pilcrow);
+                    m_lines << line;
+                    line.clear();
+                }
+                addSegment(line, diff.operation, parts[i]);
+            }
+        }
+        if (!line.isEmpty())
+            m_lines << line;
+
+        endResetModel();
+    }
+
+private:
+    static void addSegment(DiffLine &line, Operation operation,
+                           QString text)
+    {
+        if (text.isEmpty())
+            return;
+
+        text.replace('\t', "    ");
+        DiffSegment segment;
+        segment.operation = operation;
+        segment.text = text;
+        line << segment;
+    }
+
+    QVector<DiffLine> m_lines;
+};
+
+class DiffDelegate : public QStyledItemDelegate
+{
+public:
+    DiffDelegate(DiffModel *model, QObject *parent)
+        : QStyledItemDelegate(parent)
+        , m_model(model)
+        , m_insertColor(_TangoChameleon1.lighter(150))
+        , m_deleteColor(_TangoScarletRed1.lighter(170))
+    {
+    }
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option,
+               const QModelIndex &index) const
+    {
+        QFontMetrics metrics(option.font);
+        int x = option.rect.left() + Margin;
+
+        painter->save();
+        painter->setFont(option.font);
+        foreach (const DiffSegment &segment, m_model->line(index.row())) {
+            int width = metrics.width(segment.text);
+            QRect rect(x, option.rect.top(), width, option.rect.height());
+            if (segment.operation == INSERT)
+                painter->fillRect(rect, m_insertColor);
+            else if (segment.operation == DELETE)
+                painter->fillRect(rect, m_deleteColor);
+            painter->drawText(rect, Qt::AlignLeft | Qt::AlignVCenter,
+                              segment.text);
+            x += width;
+        }
+        painter->restore();
+    }
+
+    QSize sizeHint(const QStyleOptionViewItem &option,
+                   const QModelIndex &index) const
+    {
+        QFontMetrics metrics(option.font);
+        return QSize(2 * Margin + metrics.width(index.data().toString()),
+                     metrics.height() + 2);
+    }
+
+private:
+    DiffModel *m_model;
+    QColor m_insertColor;
+    QColor m_deleteColor;
+};
+}
+
+DiffView::DiffView(QWidget *parent)
+    : QListView(parent)
+{
+    DiffModel *model = new DiffModel(this);
+    setModel(model);
+    setItemDelegate(new DiffDelegate(model, this));
+
+    // lines are laid out by batches while the view is displayed
+    setLayoutMode(QListView::Batched);
+    setEditTriggers(QAbstractItemView::NoEditTriggers);
+    setSelectionMode(QAbstractItemView::NoSelection);
+    setFocusPolicy(Qt::NoFocus);
+}
+
+DiffView::~DiffView() {}
+
+void DiffView::setDiffs(const QList<Diff> &diffs)
+{
+    static_cast<DiffModel *>(model())->setDiffs(diffs);
+    scrollToTop();
+}
+
+void DiffView::clear()
+{
+    static_cast<DiffModel *>(model())->setDiffs(QList<Diff>());
+}
@@ -0,0 +1,64 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __DIFF_VIEW_HH__
+#define __DIFF_VIEW_HH__
+
+#include <QListView>
+#include <QList>
+
+#include "diff_match_patch/diff_match_patch.h"
+
+/*!
+  \file diff-view.hh
+  \class DiffView
+  \brief DiffView displays the differences between two texts
+
+  The differences are split into lines that are displayed by a list
+  view: only the visible lines are laid out and painted, whatever the
+  size of the texts. Inserted text is highlighted in green and deleted
+  text in red; a changed line break is shown by a pilcrow.
+
+  \code
+  DiffView *view = new DiffView;
+  view->setDiffs(dmp.diff_main(source, target));
+  \endcode
+*/
+class DiffView : public QListView
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    DiffView(QWidget *parent = 0);
+
+    /// Destructor.
+    ~DiffView();
+
+    /*!
+    Displays the differences \a diffs.
+  */
+    void setDiffs(const QList<Diff> &diffs);
+
+    /*!
+    Removes the displayed differences.
+  */
+    void clear();
+};
+
+#endif // __DIFF_VIEW_HH__
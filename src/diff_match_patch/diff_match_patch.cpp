@@ -956,8 +956,10 @@ int diff_match_patch::diff_cleanupSemanticScore(const QString &one,
   bool whitespace2 = nonAlphaNumeric2 && char2.isSpace();
   bool lineBreak1 = whitespace1 && char1.category() == QChar::Other_Control;
   bool lineBreak2 = whitespace2 && char2.category() == QChar::Other_Control;
-  bool blankLine1 = lineBreak1 && BLANKLINEEND.indexIn(one) != -1;
-  bool blankLine2 = lineBreak2 && BLANKLINESTART.indexIn(two) != -1;
+  // QRegExp keeps its captures: match with copies so that diffs can be
+  // computed by several threads.
+  bool blankLine1 = lineBreak1 && QRegExp(BLANKLINEEND).indexIn(one) != -1;
+  bool blankLine2 = lineBreak2 && QRegExp(BLANKLINESTART).indexIn(two) != -1;
 
   if (blankLine1 || blankLine2) {
     // Five points for blank lines.
@@ -0,0 +1,336 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "file-copier.hh"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QtConcurrent>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+// copy_file_range() is provided by the glibc since version 2.27
+#if defined(__GLIBC__) &&                                                    \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define HAVE_COPY_FILE_RANGE
+#endif
+#endif
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+// size of the blocks copied between two checks of the cancel flag
+const qint64 ChunkSize = 1024 * 1024;
+
+// size of the buffer used when the kernel cannot copy the files
+const qint64 BufferSize = 64 * 1024;
+
+void createDirectories(const QStringList &directories)
+{
+    QDir root;
+    foreach (const QString &directory, directories)
+        if (!root.mkpath(directory))
+            qWarning() << "FileCopier: unable to create" << directory;
+}
+
+#ifdef Q_OS_LINUX
+// Returns the number of bytes copied by the kernel, or -1 if the files
+// must be copied through a buffer.
+qint64 copyInKernel(int in, int out, qint64 size, const QAtomicInt *canceled)
+{
+#ifdef FICLONE
+    // files sharing their blocks on copy-on-write file systems
+    if (::ioctl(out, FICLONE, in) == 0)
+        return size;
+#else
+    Q_UNUSED(size);
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+    qint64 copied = 0;
+    forever {
+        if (canceled && canceled->load())
+            return copied;
+        ssize_t count = ::copy_file_range(in, 0, out, 0, ChunkSize, 0);
+        if (count == 0)
+            return copied;
+        if (count < 0) {
+            if (copied == 0 && (errno == EXDEV || errno == ENOSYS ||
+                                errno == EINVAL || errno == EOPNOTSUPP))
+                return -1;
+            return copied;
+        }
+        copied += count;
+    }
+#else
+    Q_UNUSED(canceled);
+    return -1;
+#endif
+}
+#endif
+
+bool copyContents(QFile &source, QSaveFile &target, const QAtomicInt *canceled)
+{
+    const qint64 size = source.size();
+#ifdef Q_OS_LINUX
+    qint64 copied =
+        copyInKernel(source.handle(), target.handle(), size, canceled);
+    if (copied != -1)
+        return copied == size;
+#endif
+
+    QByteArray buffer;
+    buffer.resize(BufferSize);
+    qint64 count;
+    while ((count = source.read(buffer.data(), BufferSize)) > 0) {
+        if (canceled && canceled->load())
+            return false;
+        if (target.write(buffer.constData(), count) != count)
+            return false;
+    }
+    return count == 0;
+}
+
+struct CopyFile {
+    typedef CopyResult result_type;
+
+    CopyFile(const QHash<QString, QByteArray> &contents, bool overwrite,
+             const QAtomicInt *canceled)
+        : m_contents(contents)
+        , m_overwrite(overwrite)
+        , m_canceled(canceled)
+    {
+    }
+
+    CopyResult operator()(const QPair<QString, QString> &file) const
+    {
+        // copyFile() returns at once if the copy is canceled
+        QHash<QString, QByteArray>::const_iterator it =
+            m_contents.constFind(file.first);
+        if (it != m_contents.constEnd() && !(m_canceled && m_canceled->load()))
+            return FileCopier::writeFile(file.first, it.value(), file.second,
+                                         m_overwrite);
+        return FileCopier::copyFile(file.first, file.second, m_overwrite,
+                                    m_canceled);
+    }
+
+    QHash<QString, QByteArray> m_contents;
+    bool m_overwrite;
+    const QAtomicInt *m_canceled;
+};
+}
+
+FileCopier::FileCopier(QObject *parent)
+    : QObject(parent)
+    , m_sourceTargets()
+    , m_contents()
+    , m_overwrite(false)
+    , m_isCopying(false)
+    , m_canceled(0)
+    , m_directoriesWatcher(new QFutureWatcher<void>(this))
+    , m_copyWatcher(new QFutureWatcher<CopyResult>(this))
+    , m_timer()
+    , m_copiedBytes(0)
+    , m_copiedCount(0)
+    , m_processedCount(0)
+{
+    connect(m_directoriesWatcher, SIGNAL(finished()),
+            SLOT(directoriesCreated()));
+    connect(m_copyWatcher, SIGNAL(resultsReadyAt(int, int)),
+            SLOT(copyResultsReady(int, int)));
+    connect(m_copyWatcher, SIGNAL(finished()), SLOT(copyFinished()));
+}
+
+FileCopier::~FileCopier()
+{
+    // the workers refer to the cancel flag
+    m_canceled.store(1);
+    m_directoriesWatcher->waitForFinished();
+    m_copyWatcher->cancel();
+    m_copyWatcher->waitForFinished();
+}
+
+void FileCopier::setSourceTargets(const QMap<QString, QString> &files)
+{
+    m_sourceTargets = files;
+}
+
+void FileCopier::setContents(const QHash<QString, QByteArray> &contents)
+{
+    m_contents = contents;
+}
+
+bool FileCopier::overwrite() const { return m_overwrite; }
+
+void FileCopier::setOverwrite(bool value) { m_overwrite = value; }
+
+bool FileCopier::isCopying() const { return m_isCopying; }
+
+bool FileCopier::isCanceled() const { return m_canceled.load(); }
+
+int FileCopier::copiedCount() const { return m_copiedCount; }
+
+CopyResult FileCopier::copyFile(const QString &source, const QString &target,
+                                bool overwrite, const QAtomicInt *canceled)
+{
+    CopyResult result;
+    result.source = source;
+    result.target = target;
+    result.size = 0;
+    result.success = false;
+
+    if (canceled && canceled->load())
+        return result;
+
+    if (!overwrite && QFile::exists(target)) {
+        result.success = true;
+        return result;
+    }
+
+    QFile sourceFile(source);
+    if (!sourceFile.open(QIODevice::ReadOnly))
+        return result;
+
+    // the target is only replaced by commit()
+    QSaveFile targetFile(target);
+    if (!targetFile.open(QIODevice::WriteOnly))
+        return result;
+
+    if (!copyContents(sourceFile, targetFile, canceled)) {
+        targetFile.cancelWriting();
+        targetFile.commit();
+        return result;
+    }
+
+    result.success = targetFile.commit();
+    if (result.success)
+        result.size = sourceFile.size();
+    return result;
+}
+
+CopyResult FileCopier::writeFile(const QString &source,
+                                 const QByteArray &contents,
+                                 const QString &target, bool overwrite)
+{
+    CopyResult result;
+    result.source = source;
+    result.target = target;
+    result.size = 0;
+    result.success = false;
+
+    if (!overwrite && QFile::exists(target)) {
+        result.success = true;
+        return result;
+    }
+
+    QSaveFile targetFile(target);
+    if (!targetFile.open(QIODevice::WriteOnly) ||
+        targetFile.write(contents) != contents.size()) {
+        targetFile.cancelWriting();
+        targetFile.commit();
+        return result;
+    }
+
+    result.success = targetFile.commit();
+    if (result.success)
+        result.size = contents.size();
+    return result;
+}
+
+void FileCopier::copy()
+{
+    if (m_isCopying)
+        return;
+
+    m_isCopying = true;
+    m_canceled.store(0);
+    m_copiedBytes = 0;
+    m_copiedCount = 0;
+    m_processedCount = 0;
+    m_timer.start();
+    emit(progress(0, m_sourceTargets.size(), 0));
+
+    QSet<QString> directories;
+    foreach (const QString &target, m_sourceTargets)
+        directories << QFileInfo(target).absolutePath();
+    directories.remove(QString());
+
+    m_directoriesWatcher->setFuture(
+        QtConcurrent::run(createDirectories, directories.toList()));
+}
+
+void FileCopier::directoriesCreated()
+{
+    if (m_canceled.load()) {
+        copyFinished();
+        return;
+    }
+
+    QList<QPair<QString, QString> > files;
+    QMap<QString, QString>::const_iterator it = m_sourceTargets.constBegin();
+    for (; it != m_sourceTargets.constEnd(); ++it)
+        files << qMakePair(it.key(), it.value());
+
+    m_copyWatcher->setFuture(
+        QtConcurrent::mapped(files,
+                             CopyFile(m_contents, m_overwrite, &m_canceled)));
+}
+
+void FileCopier::copyResultsReady(int begin, int end)
+{
+    m_processedCount += end - begin;
+    for (int i = begin; i < end; ++i) {
+        CopyResult result = m_copyWatcher->resultAt(i);
+        if (result.success) {
+            m_copiedBytes += result.size;
+            ++m_copiedCount;
+        } else if (!m_canceled.load()) {
+            emit(error(result.source, result.target));
+        }
+    }
+
+    qint64 elapsed = qMax(qint64(1), m_timer.elapsed());
+    emit(progress(m_processedCount, m_sourceTargets.size(),
+                  m_copiedBytes * 1000 / elapsed));
+}
+
+void FileCopier::copyFinished()
+{
+    if (!m_isCopying)
+        return;
+
+    m_isCopying = false;
+    emit(finished());
+}
+
+void FileCopier::cancel()
+{
+    if (!m_isCopying)
+        return;
+
+    m_canceled.store(1);
+    m_copyWatcher->cancel();
+}
@@ -0,0 +1,174 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __FILE_COPIER_HH__
+#define __FILE_COPIER_HH__
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QString>
+
+/*!
+  \file file-copier.hh
+  \struct CopyResult "file-copier.hh"
+  \brief CopyResult is the outcome of the copy of a single file
+*/
+struct CopyResult {
+    QString source; /*!< the path of the copied file.*/
+    QString target; /*!< the path of the copy.*/
+    qint64 size;    /*!< the number of bytes that were copied.*/
+    bool success;   /*!< whether the target holds the source contents.*/
+};
+
+/*!
+  \class FileCopier
+  \brief FileCopier copies files in the background
+
+  The missing target directories are created first, once per
+  directory. The files are then copied in parallel on the global
+  thread pool, so that the number of workers is bounded by the number
+  of cores.
+
+  Each file is written to a temporary file that is renamed to the
+  target path once complete: a target is never left half-written,
+  even if the copy fails or is canceled. On Linux, the contents are
+  cloned (FICLONE) or copied within the kernel (copy_file_range) when
+  the file system supports it.
+
+  \code
+  FileCopier *copier = new FileCopier(this);
+  copier->setSourceTargets(files);
+  connect(copier, SIGNAL(finished()), SLOT(copyFinished()));
+  copier->copy();
+  \endcode
+
+  Existing targets are preserved unless overwrite() is \a true.
+
+  Sources given with setContents() are not read from the disk: their
+  contents are written to the targets in the same way.
+*/
+class FileCopier : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    FileCopier(QObject *parent = 0);
+
+    /// Destructor: the pending copy is canceled.
+    ~FileCopier();
+
+    /// Define \a files as the list of source / target files to be copied
+    void setSourceTargets(const QMap<QString, QString> &files);
+
+    /*!
+    Defines \a contents as the contents of the sources that are not
+    files, such as songs read from an archive: they are written to
+    their targets from memory.
+  */
+    void setContents(const QHash<QString, QByteArray> &contents);
+
+    /// Returns \a true if existing targets are replaced
+    bool overwrite() const;
+
+    /// If value is \a true, existing targets are replaced
+    void setOverwrite(bool value);
+
+    /// Returns \a true while files are being copied
+    bool isCopying() const;
+
+    /// Returns \a true if the last copy was canceled
+    bool isCanceled() const;
+
+    /// Returns the number of files copied by the last copy
+    int copiedCount() const;
+
+    /*!
+    Copies \a source to \a target through a temporary file. The copy is
+    abandoned as soon as \a canceled is set.
+    Returns the outcome of the copy.
+  */
+    static CopyResult copyFile(const QString &source, const QString &target,
+                               bool overwrite,
+                               const QAtomicInt *canceled = 0);
+
+    /*!
+    Writes \a contents, the contents of \a source, to \a target
+    through a temporary file.
+    Returns the outcome of the copy.
+  */
+    static CopyResult writeFile(const QString &source,
+                                const QByteArray &contents,
+                                const QString &target, bool overwrite);
+
+public slots:
+    /*!
+    Starts the copy of sources to targets.
+    \sa setSourceTargets
+  */
+    void copy();
+
+    /*!
+    Interrupts the copy: files that are not complete are discarded.
+  */
+    void cancel();
+
+signals:
+    /*!
+    This signal is emitted as files are copied: \a count files out of
+    \a total have been processed at a rate of \a bytesPerSecond.
+  */
+    void progress(int count, int total, qint64 bytesPerSecond);
+
+    /*!
+    This signal is emitted when \a source cannot be copied to \a target.
+  */
+    void error(const QString &source, const QString &target);
+
+    /*!
+    This signal is emitted when the copy is complete or canceled.
+  */
+    void finished();
+
+private slots:
+    void directoriesCreated();
+    void copyResultsReady(int begin, int end);
+    void copyFinished();
+
+private:
+    QMap<QString, QString> m_sourceTargets;
+    QHash<QString, QByteArray> m_contents;
+    bool m_overwrite;
+    bool m_isCopying;
+    QAtomicInt m_canceled;
+
+    QFutureWatcher<void> *m_directoriesWatcher;
+    QFutureWatcher<CopyResult> *m_copyWatcher;
+    QElapsedTimer m_timer;
+    qint64 m_copiedBytes;
+    int m_copiedCount;
+    int m_processedCount;
+};
+
+#endif // __FILE_COPIER_HH__
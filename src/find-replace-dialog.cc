@@ -29,6 +29,8 @@
 #include <QTextDocument>
 #include <QPlainTextEdit>
 
+#include "library-search.hh"
+
 #include <QDebug>
 
 FindReplaceDialog::FindReplaceDialog(QWidget *parent)
@@ -212,33 +214,64 @@ void FindReplaceDialog::replaceAll()
     if (!m_editor)
         return;
 
+    appendToHistory(m_findComboBox, m_findWords);
     appendToHistory(m_replaceComboBox, m_replaceWords);
 
-    bool wrapMode = m_wrapCheckBox->isChecked();
-    if (wrapMode) {
-        // move the cursor at document start and
-        // temporary disable wrap mode to avoid infinite loops
-        m_editor->moveCursor(m_searchBackwardsCheckBox->isChecked()
-                                 ? QTextCursor::End
-                                 : QTextCursor::Start);
-        m_wrapCheckBox->setChecked(false);
+    LibrarySearch::Options options = 0;
+    if (m_caseCheckBox->isChecked())
+        options |= LibrarySearch::CaseSensitive;
+    if (m_wholeWordsCheckBox->isChecked())
+        options |= LibrarySearch::WholeWords;
+
+    // without wrap mode, only the text after (or before) the cursor
+    QString text = m_editor->document()->toPlainText();
+    int from = 0;
+    int to = text.size();
+    if (!m_wrapCheckBox->isChecked()) {
+        if (m_searchBackwardsCheckBox->isChecked())
+            to = cursor().selectionEnd();
+        else
+            from = cursor().selectionStart();
     }
 
-    if (!cursor().hasSelection())
-        find();
+    // all the occurrences are found in a single scan of the text
+    typedef QPair<int, int> Range;
+    QList<Range> ranges;
+    LibrarySearch search(m_findComboBox->currentText(), options);
+    foreach (const Range &range, search.matches(text))
+        if (range.first >= from && range.first + range.second <= to)
+            ranges << range;
+
+    if (ranges.isEmpty()) {
+        setStatusTip(
+            tr("\"%1\" not found").arg(m_findComboBox->currentText()));
+        return;
+    }
 
-    cursor().beginEditBlock();
-    int count = 0;
-    while (cursor().hasSelection()) {
-        cursor().insertText(m_replaceComboBox->currentText());
-        find();
-        ++count;
+    // the replaced text is applied as a single edition: one undo step
+    // and one highlighting of the modified blocks
+    const QString replacement = m_replaceComboBox->currentText();
+    const int start = ranges.first().first;
+    const int end = ranges.last().first + ranges.last().second;
+    QString result;
+    result.reserve(end - start + ranges.size() * replacement.size());
+    int last = start;
+    foreach (const Range &range, ranges) {
+        result += text.midRef(last, range.first - last);
+        result += replacement;
+        last = range.first + range.second;
     }
-    setStatusTip(tr("Replaced %1 occurrence(s)").arg(count));
-    cursor().endEditBlock();
+    result += text.midRef(last, end - last);
+
+    QTextCursor editCursor(m_editor->document());
+    editCursor.setPosition(start);
+    editCursor.setPosition(end, QTextCursor::KeepAnchor);
+    editCursor.beginEditBlock();
+    editCursor.insertText(result);
+    editCursor.endEditBlock();
+    m_editor->setTextCursor(editCursor);
 
-    // restore original wrap mode
-    m_wrapCheckBox->setChecked(wrapMode);
+    setStatusTip(tr("Replaced %1 occurrence(s)").arg(ranges.size()));
 }
 
 int FindReplaceDialog::historySize() const { return m_historySize; }
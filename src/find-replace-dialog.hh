@@ -92,6 +92,8 @@ public slots:
 
     /*!
     Replace all occurrences in the editor.
+    The occurrences are found in a single scan of the text and replaced
+    by a single edition of the document, which is undone at once.
     \sa find, replace
   */
     void replaceAll();
@@ -0,0 +1,298 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "fingering-database.hh"
+
+#include "chord-index.hh"
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegExp>
+#include <QSet>
+#include <QVector>
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+/*
+  A shape is the fingering of a chord quality for a given root, from
+  the lowest string to the highest one; its frets are absolute. The
+  root is the pitch class of the chord (C = 0) played by the shape.
+*/
+struct Shape
+{
+    const char *quality;
+    const char *strings;
+    int root;
+};
+
+const Shape GuitarShapes[] = {
+    {"", "022100", 4},      {"", "X02220", 9},      {"", "X32010", 0},
+    {"", "320003", 7},      {"", "XX0232", 2},      {"m", "022000", 4},
+    {"m", "X02210", 9},     {"m", "XX0231", 2},     {"m", "X3101X", 0},
+    {"7", "020100", 4},     {"7", "X02020", 9},     {"7", "XX0212", 2},
+    {"7", "X32310", 0},     {"7", "320001", 7},     {"m7", "022030", 4},
+    {"m7", "X02010", 9},    {"m7", "XX0211", 2},    {"maj7", "021100", 4},
+    {"maj7", "X02120", 9},  {"maj7", "X32000", 0},  {"maj7", "XX0222", 2},
+    {"sus4", "022200", 4},  {"sus4", "X02230", 9},  {"sus4", "XX0233", 2},
+    {"sus2", "X02200", 9},  {"sus2", "XX0230", 2},  {"dim", "X0121X", 9},
+    {"dim", "XX0131", 2},   {"dim7", "XX0101", 2},  {"dim7", "X01212", 9},
+    {"aug", "X3211X", 0},   {"aug", "XX0332", 2},   {"6", "022120", 4},
+    {"6", "X02222", 9},     {"6", "XX0202", 2},     {"m6", "022020", 4},
+    {"m6", "X02212", 9},    {"m6", "XX0201", 2},    {"9", "X32333", 0},
+    {"9", "020102", 4},     {"add9", "X32030", 0},  {"add9", "024100", 4},
+    {"7sus4", "020200", 4}, {"7sus4", "X02030", 9}, {"m7b5", "X0101X", 9},
+    {"m7b5", "XX0111", 2},  {"5", "022XXX", 4},     {"5", "X022XX", 9},
+};
+
+/*
+  Other spellings of the qualities of the shapes, in UTF-8.
+*/
+struct QualityAlias
+{
+    const char *alias;
+    const char *quality;
+};
+
+const QualityAlias QualityAliases[] = {
+    {"M", ""},        {"maj", ""},      {"min", "m"},     {"-", "m"},
+    {"M7", "maj7"},   {"7M", "maj7"},   {"sus", "sus4"},  {"o", "dim"},
+    {"o7", "dim7"},   {"+", "aug"},     {"m7&5", "m7b5"},
+    // degree sign and slashed o
+    {"\xc2\xb0", "dim"}, {"\xc2\xb0" "7", "dim7"}, {"\xc3\xb8", "m7b5"},
+};
+
+const Shape UkuleleShapes[] = {
+    {"", "0003", 0},      {"", "2010", 5},      {"", "0232", 7},
+    {"", "2100", 9},      {"", "2220", 2},      {"m", "2000", 9},
+    {"m", "2210", 2},     {"m", "0432", 4},     {"m", "0333", 0},
+    {"m", "0231", 7},     {"7", "0001", 0},     {"7", "0212", 7},
+    {"7", "0100", 9},     {"7", "2223", 2},     {"7", "1202", 4},
+    {"m7", "0000", 9},    {"m7", "2213", 2},    {"m7", "0202", 4},
+    {"maj7", "0002", 0},  {"maj7", "2413", 5},  {"maj7", "0222", 7},
+    {"sus4", "0013", 0},  {"sus4", "0230", 2},  {"sus4", "0233", 7},
+    {"sus2", "0233", 0},  {"sus2", "2200", 2},  {"sus2", "0230", 7},
+    {"dim", "5323", 0},   {"dim7", "0101", 1},  {"aug", "1003", 0},
+    {"6", "0000", 0},     {"6", "0202", 7},     {"m6", "2212", 2},
+    {"add9", "0203", 0},  {"7sus4", "0213", 7}, {"m7b5", "2212", 11},
+};
+
+// highest position of a fingering on the neck
+const int MaxPosition = 9;
+
+// fingerings on the first frets are written without their fret
+const int OpenPosition = 4;
+
+const int Muted = -1;
+
+/*
+  A fingering of a chord with its absolute frets and the properties
+  used to rank it among the other fingerings of the chord.
+*/
+struct Fingering
+{
+    QVector<int> frets;
+    int position;
+    int span;
+    int mutedStrings;
+
+    bool operator<(const Fingering &other) const
+    {
+        if (span != other.span)
+            return span < other.span;
+        if (position != other.position)
+            return position < other.position;
+        return mutedStrings < other.mutedStrings;
+    }
+
+    QString toString() const
+    {
+        int maxFret = 0;
+        foreach (int fret, frets)
+            maxFret = qMax(maxFret, fret);
+
+        // beyond the first frets, strings are relative to the position
+        bool open = (maxFret <= OpenPosition);
+        QString strings;
+        foreach (int fret, frets) {
+            if (fret == Muted)
+                strings += 'X';
+            else if (open || fret == 0)
+                strings += QString::number(fret);
+            else
+                strings += QString::number(fret - position + 1);
+        }
+        return open ? strings : QString("%1:%2").arg(position).arg(strings);
+    }
+};
+
+/*
+  Returns the pitch class (C = 0) of the root of the chord \a name and
+  sets \a quality to the rest of the name, or -1 if \a name does not
+  start with a note.
+*/
+int parseRoot(const QString &name, QString &quality)
+{
+    static const int Pitches[] = {9, 11, 0, 2, 4, 5, 7}; // A to G
+    if (name.isEmpty() || name[0] < 'A' || name[0] > 'G')
+        return -1;
+
+    int root = Pitches[name[0].toLatin1() - 'A'];
+    int length = 1;
+    if (name.size() > 1 && name[1] == '#') {
+        root = (root + 1) % 12;
+        length = 2;
+    } else if (name.size() > 1 && name[1] == '&') {
+        root = (root + 11) % 12;
+        length = 2;
+    }
+
+    // the bass note of slash chords (C/G) is not fingered
+    quality = name.mid(length).section('/', 0, 0);
+    return root;
+}
+
+QString normalizedQuality(const QString &quality)
+{
+    const int count = sizeof(QualityAliases) / sizeof(QualityAlias);
+    for (int i = 0; i < count; ++i)
+        if (quality == QString::fromUtf8(QualityAliases[i].alias))
+            return QString::fromUtf8(QualityAliases[i].quality);
+    return quality;
+}
+
+// fingerings already computed, by instrument and chord name
+QHash<QString, QStringList> fingeringCache[2];
+QMutex fingeringCacheMutex;
+
+bool transpose(const Shape &shape, int root, Fingering &fingering)
+{
+    int offset = (root - shape.root + 12) % 12;
+    int length = qstrlen(shape.strings);
+
+    fingering.frets.resize(length);
+    fingering.mutedStrings = 0;
+    int minFret = 0;
+    int maxFret = 0;
+    for (int i = 0; i < length; ++i) {
+        char c = shape.strings[i];
+        if (c == 'X') {
+            fingering.frets[i] = Muted;
+            ++fingering.mutedStrings;
+            continue;
+        }
+
+        // open strings are barred by the index finger
+        int fret = c - '0' + offset;
+        fingering.frets[i] = fret;
+        if (fret > 0) {
+            minFret = (minFret == 0) ? fret : qMin(minFret, fret);
+            maxFret = qMax(maxFret, fret);
+        }
+    }
+
+    fingering.position = qMax(1, minFret);
+    fingering.span = (maxFret == 0) ? 0 : maxFret - minFret;
+    return fingering.position <= MaxPosition &&
+           maxFret - fingering.position < 9;
+}
+}
+
+QStringList FingeringDatabase::fingerings(const QString &name,
+                                          Chord::Instrument instrument)
+{
+    QString chordName = ChordIndex::normalizedName(name);
+    {
+        QMutexLocker locker(&fingeringCacheMutex);
+        QHash<QString, QStringList>::const_iterator it =
+            fingeringCache[instrument].constFind(chordName);
+        if (it != fingeringCache[instrument].constEnd())
+            return it.value();
+    }
+
+    QString quality;
+    int root = parseRoot(chordName, quality);
+    QStringList result;
+    if (root != -1) {
+        quality = normalizedQuality(quality);
+
+        const Shape *shapes = GuitarShapes;
+        int count = sizeof(GuitarShapes) / sizeof(Shape);
+        if (instrument == Chord::Ukulele) {
+            shapes = UkuleleShapes;
+            count = sizeof(UkuleleShapes) / sizeof(Shape);
+        }
+
+        QList<Fingering> candidates;
+        Fingering fingering;
+        for (int i = 0; i < count; ++i)
+            if (quality == shapes[i].quality &&
+                transpose(shapes[i], root, fingering))
+                candidates << fingering;
+        qStableSort(candidates);
+
+        foreach (const Fingering &candidate, candidates) {
+            QString strings = candidate.toString();
+            if (!result.contains(strings))
+                result << strings;
+        }
+    }
+
+    QMutexLocker locker(&fingeringCacheMutex);
+    fingeringCache[instrument].insert(chordName, result);
+    return result;
+}
+
+QString FingeringDatabase::diagram(const QString &name,
+                                   Chord::Instrument instrument)
+{
+    QStringList list = fingerings(name, instrument);
+    if (list.isEmpty())
+        return QString();
+
+    return QString("\\%1{%2}{%3}")
+        .arg(instrument == Chord::Ukulele ? "utab" : "gtab")
+        .arg(name.trimmed())
+        .arg(list.first());
+}
+
+QStringList FingeringDatabase::missingDiagrams(const QStringList &names,
+                                               const QStringList &diagrams,
+                                               Chord::Instrument instrument)
+{
+    QRegExp reName("\\\\[ug]tab[\\*]?\\{([^\\}]+)\\}");
+    QSet<QString> known;
+    foreach (const QString &line, diagrams)
+        if (reName.indexIn(line) != -1)
+            known.insert(ChordIndex::normalizedName(reName.cap(1)));
+
+    QStringList result;
+    foreach (const QString &name, names) {
+        QString chordName = ChordIndex::normalizedName(name);
+        if (known.contains(chordName))
+            continue;
+        known.insert(chordName);
+
+        QString line = diagram(name, instrument);
+        if (!line.isEmpty())
+            result << line;
+    }
+    return result;
+}
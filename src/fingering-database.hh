@@ -0,0 +1,78 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __FINGERING_DATABASE_HH__
+#define __FINGERING_DATABASE_HH__
+
+#include <QString>
+#include <QStringList>
+
+#include "chord.hh"
+
+/*!
+  \file fingering-database.hh
+  \class FingeringDatabase
+  \brief FingeringDatabase provides the fingerings of the chords
+
+  The fingerings are built from a static table of chord shapes for the
+  guitar and the ukulele. Each shape is defined for a given root and is
+  moved along the neck to play the same chord quality on other roots:
+  the open E major shape \a 022100 becomes the barre chord \a 133211
+  for F major and \a 5:133211 for A major.
+
+  The fingerings of a chord are ranked by fret span, then by position on
+  the neck, so that the first one is usually the easiest to play.
+  They are computed once per chord and kept in a cache shared by all
+  the threads: all the functions of this class are thread-safe.
+
+  \code
+  FingeringDatabase::fingerings("Bbm7", Chord::Guitar);
+  // ("X13121", "8:XX1322", "6:133141")
+  FingeringDatabase::diagram("Am", Chord::Guitar);
+  // "\gtab{Am}{X02210}"
+  \endcode
+*/
+class FingeringDatabase
+{
+public:
+    /*!
+    Returns the fingerings of the chord \a name for the \a instrument,
+    in the "fret:strings" syntax of the songs package; the fret is
+    omitted for chords played on the first frets.
+    Returns an empty list if the chord is unknown.
+  */
+    static QStringList fingerings(const QString &name,
+                                  Chord::Instrument instrument);
+
+    /*!
+    Returns the diagram of the easiest fingering of the chord \a name
+    for the \a instrument, such as \\gtab{Am}{X02210}, or an empty
+    string if the chord is unknown.
+  */
+    static QString diagram(const QString &name, Chord::Instrument instrument);
+
+    /*!
+    Returns the diagrams of the chords \a names that do not belong to
+    the \a diagrams of a song, for the \a instrument.
+  */
+    static QStringList missingDiagrams(const QStringList &names,
+                                       const QStringList &diagrams,
+                                       Chord::Instrument instrument);
+};
+
+#endif // __FINGERING_DATABASE_HH__
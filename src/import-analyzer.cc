@@ -0,0 +1,401 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "import-analyzer.hh"
+
+#include "library.hh"
+#include "song.hh"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#ifdef ENABLE_LIBRARY_DOWNLOAD
+#include <archive.h>
+#include <archive_entry.h>
+#endif // ENABLE_LIBRARY_DOWNLOAD
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+// size of the chunks read to hash a file
+const qint64 ChunkSize = 64 * 1024;
+
+const quint64 Prime1 = Q_UINT64_C(11400714785074694791);
+const quint64 Prime2 = Q_UINT64_C(14029467366897019727);
+const quint64 Prime3 = Q_UINT64_C(1609587929392839161);
+const quint64 Prime4 = Q_UINT64_C(9650029242287828579);
+const quint64 Prime5 = Q_UINT64_C(2870177450012600261);
+
+inline quint64 rotate(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline quint64 hashRound(quint64 accumulator, quint64 input)
+{
+    accumulator += input * Prime2;
+    return rotate(accumulator, 31) * Prime1;
+}
+
+inline quint64 mergeRound(quint64 accumulator, quint64 value)
+{
+    accumulator ^= hashRound(0, value);
+    return accumulator * Prime1 + Prime4;
+}
+
+/*
+  Streaming implementation of XXH64 (seed 0): the data is consumed by
+  stripes of 32 bytes, the remaining bytes are kept until the next call
+  to addData() or to result().
+*/
+class Hash64
+{
+public:
+    Hash64() : m_length(0), m_bufferSize(0)
+    {
+        m_accumulators[0] = Prime1 + Prime2;
+        m_accumulators[1] = Prime2;
+        m_accumulators[2] = 0;
+        m_accumulators[3] = 0 - Prime1;
+    }
+
+    void addData(const char *data, qint64 size)
+    {
+        const uchar *p = reinterpret_cast<const uchar *>(data);
+        const uchar *end = p + size;
+        m_length += size;
+
+        if (m_bufferSize + size < StripeSize) {
+            memcpy(m_buffer + m_bufferSize, p, size);
+            m_bufferSize += size;
+            return;
+        }
+
+        if (m_bufferSize > 0) {
+            int missing = StripeSize - m_bufferSize;
+            memcpy(m_buffer + m_bufferSize, p, missing);
+            consume(m_buffer);
+            p += missing;
+            m_bufferSize = 0;
+        }
+
+        for (; end - p >= StripeSize; p += StripeSize)
+            consume(p);
+
+        m_bufferSize = end - p;
+        memcpy(m_buffer, p, m_bufferSize);
+    }
+
+    quint64 result() const
+    {
+        quint64 h;
+        if (m_length >= StripeSize) {
+            h = rotate(m_accumulators[0], 1) + rotate(m_accumulators[1], 7) +
+                rotate(m_accumulators[2], 12) + rotate(m_accumulators[3], 18);
+            for (int i = 0; i < 4; ++i)
+                h = mergeRound(h, m_accumulators[i]);
+        } else {
+            h = Prime5;
+        }
+        h += quint64(m_length);
+
+        const uchar *p = m_buffer;
+        const uchar *end = p + m_bufferSize;
+        for (; end - p >= 8; p += 8) {
+            h ^= hashRound(0, qFromLittleEndian<quint64>(p));
+            h = rotate(h, 27) * Prime1 + Prime4;
+        }
+        if (end - p >= 4) {
+            h ^= quint64(qFromLittleEndian<quint32>(p)) * Prime1;
+            h = rotate(h, 23) * Prime2 + Prime3;
+            p += 4;
+        }
+        for (; p < end; ++p) {
+            h ^= *p * Prime5;
+            h = rotate(h, 11) * Prime1;
+        }
+
+        h ^= h >> 33;
+        h *= Prime2;
+        h ^= h >> 29;
+        h *= Prime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static const int StripeSize = 32;
+
+    void consume(const uchar *stripe)
+    {
+        for (int i = 0; i < 4; ++i)
+            m_accumulators[i] = hashRound(
+                m_accumulators[i], qFromLittleEndian<quint64>(stripe + 8 * i));
+    }
+
+    quint64 m_accumulators[4];
+    qint64 m_length;
+    int m_bufferSize;
+    uchar m_buffer[StripeSize];
+};
+
+struct AnalyzeSong {
+    typedef ImportItem result_type;
+
+    AnalyzeSong(const ImportAnalyzer &analyzer) : m_analyzer(analyzer) {}
+
+    ImportItem operator()(const QString &filename) const
+    {
+        return m_analyzer.analyzeSong(filename);
+    }
+
+    ImportAnalyzer m_analyzer;
+};
+
+#ifdef ENABLE_LIBRARY_DOWNLOAD
+typedef QPair<QString, QByteArray> ArchiveEntry;
+
+struct AnalyzeEntry {
+    typedef ImportItem result_type;
+
+    AnalyzeEntry(const ImportAnalyzer &analyzer,
+                 const QHash<QString, QByteArray> &covers)
+        : m_analyzer(analyzer)
+        , m_covers(covers)
+    {
+    }
+
+    ImportItem operator()(const ArchiveEntry &entry) const
+    {
+        return m_analyzer.analyzeData(entry.first, entry.second, m_covers);
+    }
+
+    ImportAnalyzer m_analyzer;
+    QHash<QString, QByteArray> m_covers;
+};
+
+// Reads the songs and the covers of the archive \a filename in memory.
+bool readArchive(const QString &filename, QList<ArchiveEntry> &songs,
+                 QHash<QString, QByteArray> &covers)
+{
+    struct archive *reader = archive_read_new();
+    archive_read_support_format_all(reader);
+    archive_read_support_filter_all(reader);
+    if (archive_read_open_filename(reader,
+                                   QFile::encodeName(filename).constData(),
+                                   ChunkSize) != ARCHIVE_OK) {
+        qWarning() << "ImportAnalyzer: unable to open" << filename << ":"
+                   << archive_error_string(reader);
+        archive_read_free(reader);
+        return false;
+    }
+
+    bool success = true;
+    struct archive_entry *entry;
+    int result;
+    while ((result = archive_read_next_header(reader, &entry)) != ARCHIVE_EOF) {
+        if (result < ARCHIVE_WARN) {
+            success = false;
+            break;
+        }
+
+        QString name = QFile::decodeName(archive_entry_pathname(entry));
+        bool isSong = name.endsWith(".sg");
+        bool isCover = name.endsWith(".jpg");
+        if (archive_entry_filetype(entry) != AE_IFREG ||
+            (!isSong && !isCover)) {
+            archive_read_data_skip(reader);
+            continue;
+        }
+
+        QByteArray data;
+        if (archive_entry_size_is_set(entry))
+            data.reserve(archive_entry_size(entry));
+        char buffer[ChunkSize];
+        la_ssize_t count;
+        while ((count = archive_read_data(reader, buffer, ChunkSize)) > 0)
+            data.append(buffer, count);
+        if (count < 0) {
+            success = false;
+            break;
+        }
+
+        // entries are named after the archive, as if it were a directory
+        QString path =
+            QDir::cleanPath(QString("%1/%2").arg(filename).arg(name));
+        if (isSong)
+            songs << qMakePair(path, data);
+        else
+            covers.insert(path, data);
+    }
+
+    if (!success)
+        qWarning() << "ImportAnalyzer: unable to read" << filename << ":"
+                   << archive_error_string(reader);
+    archive_read_free(reader);
+    return success;
+}
+#endif // ENABLE_LIBRARY_DOWNLOAD
+}
+
+ImportAnalyzer::ImportAnalyzer(const QString &directory)
+    : m_directory(directory)
+{
+}
+
+QString ImportAnalyzer::directory() const { return m_directory; }
+
+ImportItem ImportAnalyzer::analyzeSong(const QString &filename) const
+{
+    ImportItem item;
+    item.source = filename;
+    item.status = ImportItem::Unreadable;
+
+    QFileInfo source(filename);
+    if (!source.isReadable())
+        return item;
+
+    Song song = Song::headerFromFile(filename);
+    item.target = Library::pathToSong(m_directory, song.artist, song.title);
+
+    QFileInfo target(item.target);
+    if (!target.exists())
+        item.status = ImportItem::NewSong;
+    else if (source.size() != target.size())
+        item.status = ImportItem::Conflict;
+    else if (sameContents(filename, item.target))
+        item.status = ImportItem::Identical;
+    else
+        item.status = ImportItem::Conflict;
+    return item;
+}
+
+QFuture<ImportItem>
+ImportAnalyzer::analyzeSongs(const QStringList &filenames) const
+{
+    return QtConcurrent::mapped(filenames, AnalyzeSong(*this));
+}
+
+#ifdef ENABLE_LIBRARY_DOWNLOAD
+ImportItem
+ImportAnalyzer::analyzeData(const QString &filename, const QByteArray &data,
+                            const QHash<QString, QByteArray> &covers) const
+{
+    ImportItem item;
+    item.source = filename;
+    item.status = ImportItem::Unreadable;
+    item.contents = data;
+
+    Song song = Song::headerFromData(data, filename);
+    item.target = Library::pathToSong(m_directory, song.artist, song.title);
+
+    QFile target(item.target);
+    if (!target.exists()) {
+        item.status = ImportItem::NewSong;
+    } else if (target.size() != data.size() ||
+               !target.open(QIODevice::ReadOnly)) {
+        item.status = ImportItem::Conflict;
+    } else {
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+        item.status = (hash(&buffer) == hash(&target)) ? ImportItem::Identical
+                                                       : ImportItem::Conflict;
+    }
+
+    // the cover is written next to the song
+    QString cover = QString("%1/%2.jpg")
+                        .arg(QFileInfo(filename).path())
+                        .arg(song.coverName);
+    if (!song.coverName.isEmpty() && covers.contains(cover)) {
+        item.coverSource = cover;
+        item.coverTarget = QString("%1/%2.jpg")
+                               .arg(QFileInfo(item.target).path())
+                               .arg(song.coverName);
+        item.cover = covers.value(cover);
+    }
+    return item;
+}
+
+QList<ImportItem> ImportAnalyzer::analyzeArchive(const QString &filename) const
+{
+    QList<ArchiveEntry> songs;
+    QHash<QString, QByteArray> covers;
+
+    // a corrupt archive is not partially imported
+    if (!readArchive(filename, songs, covers)) {
+        ImportItem item;
+        item.source = filename;
+        item.status = ImportItem::Unreadable;
+        return QList<ImportItem>() << item;
+    }
+    return QtConcurrent::blockingMapped<QList<ImportItem> >(
+        songs, AnalyzeEntry(*this, covers));
+}
+
+QList<ImportItem>
+ImportAnalyzer::analyzeFiles(const QStringList &filenames) const
+{
+    QList<ImportItem> items;
+    QStringList songs;
+    foreach (const QString &filename, filenames) {
+        if (isArchive(filename))
+            items << analyzeArchive(filename);
+        else
+            songs << filename;
+    }
+    items << QtConcurrent::blockingMapped<QList<ImportItem> >(
+        songs, AnalyzeSong(*this));
+    return items;
+}
+
+bool ImportAnalyzer::isArchive(const QString &filename)
+{
+    static const char *suffixes[] = {".tar", ".tar.gz", ".tgz", ".tar.bz2",
+                                     ".tbz2", ".tar.xz", ".zip", 0};
+    for (int i = 0; suffixes[i]; ++i)
+        if (filename.endsWith(suffixes[i], Qt::CaseInsensitive))
+            return true;
+    return false;
+}
+#endif // ENABLE_LIBRARY_DOWNLOAD
+
+bool ImportAnalyzer::sameContents(const QString &path, const QString &other)
+{
+    QFile file(path);
+    QFile otherFile(other);
+    if (!file.open(QIODevice::ReadOnly) || !otherFile.open(QIODevice::ReadOnly))
+        return false;
+    if (file.size() != otherFile.size())
+        return false;
+    return hash(&file) == hash(&otherFile);
+}
+
+quint64 ImportAnalyzer::hash(QIODevice *device)
+{
+    Hash64 hash64;
+    QByteArray chunk;
+    while (!(chunk = device->read(ChunkSize)).isEmpty())
+        hash64.addData(chunk.constData(), chunk.size());
+    return hash64.result();
+}
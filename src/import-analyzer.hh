@@ -0,0 +1,149 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __IMPORT_ANALYZER_HH__
+#define __IMPORT_ANALYZER_HH__
+
+#include <QByteArray>
+#include <QFuture>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include "config.hh"
+
+class QIODevice;
+
+/*!
+  \file import-analyzer.hh
+  \struct ImportItem "import-analyzer.hh"
+  \brief ImportItem is the analysis of a song being imported
+*/
+struct ImportItem {
+    /// State of the imported song with respect to the library.
+    enum Status {
+        NewSong,   /*!< the library has no song at the target path.*/
+        Identical, /*!< the target song has the same contents.*/
+        Conflict,  /*!< the target song has different contents.*/
+        Unreadable /*!< the imported song cannot be read.*/
+    };
+
+    QString source; /*!< the path of the imported song.*/
+    QString target; /*!< the path of the song within the library.*/
+    Status status;  /*!< the state of the imported song.*/
+
+    QByteArray contents; /*!< the song, when read from an archive.*/
+    QString coverSource; /*!< the path of the cover within the archive.*/
+    QString coverTarget; /*!< the path of the cover within the library.*/
+    QByteArray cover;    /*!< the cover, when read from an archive.*/
+};
+
+/*!
+  \class ImportAnalyzer
+  \brief ImportAnalyzer finds the songs that conflict with the library
+
+  The target path of an imported song only depends on its title and its
+  artist: only the header of the .sg file is parsed to compute it.
+
+  The imported song and the song of the library are then compared: files
+  of different sizes conflict without being read, otherwise both files
+  are hashed by chunks with a 64-bit non-cryptographic hash (XXH64).
+
+  The songs are analyzed in parallel on the global thread pool and the
+  results are available as soon as each song is analyzed:
+
+  \code
+  ImportAnalyzer analyzer(library->directory().canonicalPath());
+  QFuture<ImportItem> items = analyzer.analyzeSongs(filenames);
+  \endcode
+
+  Songs may also be imported from an archive (.tar.gz, .zip...): the
+  songs and their covers are read in memory, without being extracted,
+  and the songs are analyzed in parallel. Their contents are kept in
+  the ImportItem so that only the accepted songs are written.
+
+  All the functions of this class are reentrant.
+*/
+class ImportAnalyzer
+{
+public:
+    /// Constructor.
+    ImportAnalyzer(const QString &directory = QString());
+
+    /*!
+    Returns the canonical path of the library the songs are imported in.
+  */
+    QString directory() const;
+
+    /*!
+    Returns the analysis of the imported song \a filename.
+  */
+    ImportItem analyzeSong(const QString &filename) const;
+
+    /*!
+    Analyzes the imported songs \a filenames in parallel.
+  */
+    QFuture<ImportItem> analyzeSongs(const QStringList &filenames) const;
+
+#ifdef ENABLE_LIBRARY_DOWNLOAD
+    /*!
+    Returns the analysis of the imported song \a filename whose
+    contents \a data were read from an archive. The cover of the song
+    is looked up among \a covers, the images of the same archive.
+  */
+    ImportItem analyzeData(const QString &filename, const QByteArray &data,
+                           const QHash<QString, QByteArray> &covers =
+                               QHash<QString, QByteArray>()) const;
+
+    /*!
+    Returns the analysis of the songs of the archive \a filename, whose
+    songs are named after the path of the archive, as if it were a
+    directory. This function blocks until every song is analyzed.
+  */
+    QList<ImportItem> analyzeArchive(const QString &filename) const;
+
+    /*!
+    Returns the analysis of \a filenames, that are songs or archives of
+    songs. This function blocks until every song is analyzed.
+  */
+    QList<ImportItem> analyzeFiles(const QStringList &filenames) const;
+
+    /*!
+    Returns \a true if \a filename is an archive that may contain
+    songs.
+  */
+    static bool isArchive(const QString &filename);
+#endif // ENABLE_LIBRARY_DOWNLOAD
+
+    /*!
+    Returns \a true if the files \a path and \a other have the same
+    contents.
+  */
+    static bool sameContents(const QString &path, const QString &other);
+
+    /*!
+    Returns the XXH64 hash of the remaining contents of \a device, which
+    is read by chunks.
+  */
+    static quint64 hash(QIODevice *device);
+
+private:
+    QString m_directory;
+};
+
+#endif // __IMPORT_ANALYZER_HH__
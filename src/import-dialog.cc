@@ -48,13 +48,24 @@
 #include "config.hh"
 
 #ifdef ENABLE_LIBRARY_DOWNLOAD
-#include <archive.h>
-#include <archive_entry.h>
+#include "archive-extractor.hh"
 
+#include <QtConcurrent>
 #include <QNetworkAccessManager>
 #include <QNetworkProxy>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+
+namespace // anonymous namespace
+{
+QList<ImportItem> waitForItems(const QList<QFuture<ImportItem> > &analyses)
+{
+    QList<ImportItem> items;
+    foreach (const QFuture<ImportItem> &analysis, analyses)
+        items << analysis.result();
+    return items;
+}
+}
 #endif // ENABLE_LIBRARY_DOWNLOAD
 
 ImportDialog::ImportDialog(QWidget *parent)
@@ -65,6 +76,10 @@ ImportDialog::ImportDialog(QWidget *parent)
 #ifdef ENABLE_LIBRARY_DOWNLOAD
     , m_manager(0)
     , m_reply(0)
+    , m_extractor(new ArchiveExtractor(this))
+    , m_libraryDirectory()
+    , m_analyses()
+    , m_analysisWatcher(new QFutureWatcher<QList<ImportItem> >(this))
 #endif // ENABLE_LIBRARY_DOWNLOAD
 {
     setWindowTitle(tr("Import songs"));
@@ -75,6 +90,14 @@ ImportDialog::ImportDialog(QWidget *parent)
     connect(buttonBox, SIGNAL(accepted()), SLOT(acceptDialog()));
     connect(buttonBox, SIGNAL(rejected()), SLOT(close()));
 
+#ifdef ENABLE_LIBRARY_DOWNLOAD
+    connect(m_extractor, SIGNAL(songExtracted(const QString &)),
+            SLOT(analyzeSong(const QString &)));
+    connect(m_extractor, SIGNAL(finished(bool)),
+            SLOT(extractionFinished(bool)));
+    connect(m_analysisWatcher, SIGNAL(finished()), SLOT(analysisFinished()));
+#endif // ENABLE_LIBRARY_DOWNLOAD
+
     m_libraryPath->setMinimumWidth(300);
     m_libraryPath->setOptions(QFileDialog::ShowDirsOnly);
     m_libraryPath->setCaption(tr("Library path"));
@@ -313,8 +336,14 @@ void ImportDialog::openItem(QListWidgetItem *item)
 
 void ImportDialog::addFiles()
 {
+#ifdef ENABLE_LIBRARY_DOWNLOAD
+    QString filter = tr("Songs (*.sg *.tar *.tar.gz *.tgz *.tar.bz2 *.tbz2 "
+                        "*.tar.xz *.zip)");
+#else
+    QString filter = tr("Songs (*.sg)");
+#endif // ENABLE_LIBRARY_DOWNLOAD
     QStringList paths = QFileDialog::getOpenFileNames(
-        this, tr("Import songs"), QDir::homePath(), tr("Songs (*.sg)"));
+        this, tr("Import songs"), QDir::homePath(), filter);
     foreach (const QString &path, paths) {
         if (!m_songsToBeImported.contains(path)) {
             QFileInfo fileInfo(path);
@@ -342,6 +371,9 @@ void ImportDialog::removeFiles()
 
 bool ImportDialog::acceptDialog()
 {
+    // songs are analyzed against the library while they are downloaded
+    Library::instance()->setDirectory(m_libraryPath->path());
+
 #ifdef ENABLE_LIBRARY_DOWNLOAD
     if (m_fromNetworkButton->isChecked()) {
         if (m_patacrepButton->isChecked()) {
@@ -362,16 +394,35 @@ bool ImportDialog::acceptDialog()
     }
 #endif // ENABLE_LIBRARY_DOWNLOAD
 
-    if (m_fromLocalButton->isChecked()) {
+    if (m_fromLocalButton->isChecked() && !analyzeArchives()) {
         emit(songsReadyToBeImported(m_songsToBeImported));
     }
 
-    Library::instance()->setDirectory(m_libraryPath->path());
     writeSettings();
     accept();
     return true;
 }
 
+bool ImportDialog::analyzeArchives()
+{
+#ifdef ENABLE_LIBRARY_DOWNLOAD
+    bool hasArchives = false;
+    foreach (const QString &path, m_songsToBeImported)
+        hasArchives = hasArchives || ImportAnalyzer::isArchive(path);
+    if (!hasArchives)
+        return false;
+
+    // songs are read from the archives without being extracted
+    showMessage(tr("Reading the songs to import..."));
+    ImportAnalyzer analyzer(Library::instance()->directory().canonicalPath());
+    m_analysisWatcher->setFuture(QtConcurrent::run(
+        analyzer, &ImportAnalyzer::analyzeFiles, m_songsToBeImported));
+    return true;
+#else
+    return false;
+#endif // ENABLE_LIBRARY_DOWNLOAD
+}
+
 ProgressBar *ImportDialog::progressBar() const
 {
     return parent()->progressBar();
@@ -411,35 +462,26 @@ void ImportDialog::initDownload()
     connect(progressBar(), SIGNAL(canceled()), this, SLOT(cancelDownload()));
 }
 
-bool ImportDialog::saveToDisk(const QString &filename, QIODevice *data)
-{
-    QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly)) {
-        showMessage(tr("Could not open %1 in write mode: %2")
-                        .arg(qPrintable(filename))
-                        .arg(qPrintable(file.errorString())));
-        return false;
-    }
-    file.write(data->readAll());
-    file.close();
-    return true;
-}
-
 void ImportDialog::downloadStart()
 {
     if (m_url.isValid()) {
-        // check if there already is a songbook directory in the specified path
+        // the archive is extracted within the cache directory
         QDir dir(MainWindow::_cachePath);
         QNetworkRequest request;
         request.setUrl(m_url);
         request.setRawHeader("User-Agent", "patagui a1");
         m_reply = m_manager->get(request);
-        connect(m_reply, SIGNAL(finished()), this, SLOT(downloadFinished()));
         connect(m_reply, SIGNAL(sslErrors(QList<QSslError>)), this,
                 SLOT(sslErrors(QList<QSslError>)));
         connect(m_reply, SIGNAL(downloadProgress(qint64, qint64)), this,
                 SLOT(downloadProgress(qint64, qint64)));
         m_downloadTime.start();
+
+        // songs are extracted and analyzed during the download
+        m_libraryDirectory = Library::instance()->directory().canonicalPath();
+        m_analyses.clear();
+        m_extractor->setDirectory(dir);
+        m_extractor->extract(m_reply);
     } else {
         qWarning()
             << tr("ImportDialog::downloadStart the following url is invalid: ")
@@ -447,41 +489,37 @@ void ImportDialog::downloadStart()
     }
 }
 
-void ImportDialog::downloadFinished()
+void ImportDialog::analyzeSong(const QString &path)
 {
-    bool abort = false;
+    ImportAnalyzer analyzer(m_libraryDirectory);
+    m_analyses << QtConcurrent::run(analyzer, &ImportAnalyzer::analyzeSong,
+                                    path);
+}
 
-    if (m_reply->error()) {
-        showMessage(tr("Download of %1 failed: %2")
-                        .arg(m_reply->url().toEncoded().constData())
-                        .arg(qPrintable(m_reply->errorString())));
-        abort = true;
+void ImportDialog::extractionFinished(bool success)
+{
+    progressBar()->hide();
+    disconnect(progressBar(), SIGNAL(canceled()), this, SLOT(cancelDownload()));
+    if (m_reply) {
+        m_reply->deleteLater();
+        m_reply = 0;
     }
 
-    QString filename = findFileName();
-
-    if (!abort) {
-        QDir dir(MainWindow::_cachePath);
-        QDir oldCurrent = QDir::currentPath();
-        QString filepath = dir.filePath(filename);
-        if (saveToDisk(filepath, m_reply)) {
-            QDir::setCurrent(dir.absolutePath());
-            if (decompress(filepath)) {
-                Library::recursiveFindFiles(dir.absolutePath(),
-                                             QStringList() << "*.sg",
-                                             m_songsToBeImported);
-                showMessage(tr("Download completed"));
-                emit(songsReadyToBeImported(m_songsToBeImported));
-            }
-            QDir::setCurrent(oldCurrent.absolutePath());
-        }
-        // remove the downloaded archive after decompressing
-        dir.remove(filepath);
+    if (!success) {
+        showMessage(m_extractor->errorString());
+        m_analyses.clear();
+        return;
     }
 
-    progressBar()->hide();
-    disconnect(progressBar(), SIGNAL(canceled()), this, SLOT(cancelDownload()));
-    m_reply->deleteLater();
+    // most of the songs were analyzed during the download
+    showMessage(tr("Download completed"));
+    m_analysisWatcher->setFuture(QtConcurrent::run(waitForItems, m_analyses));
+    m_analyses.clear();
+}
+
+void ImportDialog::analysisFinished()
+{
+    emit(songsAnalyzed(m_analysisWatcher->result()));
 }
 
 void ImportDialog::sslErrors(const QList<QSslError> &sslErrors)
@@ -496,92 +534,7 @@ void ImportDialog::cancelDownload()
 {
     if (m_reply)
         m_reply->abort();
-    downloadFinished();
-}
-
-// Uses the code sample proposed in the libarchive documentation
-// http://code.google.com/p/libarchive/wiki/Examples#A_Complete_Extractor
-bool ImportDialog::decompress(const QString &filename)
-{
-    struct archive *archive;
-    struct archive *ext;
-    struct archive_entry *entry;
-    int flags;
-    int r;
-
-    /* Select which attributes we want to restore. */
-    flags = ARCHIVE_EXTRACT_TIME;
-    flags |= ARCHIVE_EXTRACT_PERM;
-    flags |= ARCHIVE_EXTRACT_ACL;
-    flags |= ARCHIVE_EXTRACT_FFLAGS;
-
-    archive = archive_read_new();
-    archive_read_support_format_all(archive);
-    archive_read_support_filter_all(archive);
-    ext = archive_write_disk_new();
-    archive_write_disk_set_options(ext, flags);
-    archive_write_disk_set_standard_lookup(ext);
-
-    if ((r = archive_read_open_filename(archive, filename.toStdString().c_str(),
-                                        10240))) {
-        showMessage(tr("Unable to open the archive: %1").arg(filename));
-        return false;
-    }
-
-    do {
-        r = archive_read_next_header(archive, &entry);
-        if (r == ARCHIVE_EOF)
-            break;
-        if (r != ARCHIVE_OK)
-            showMessage(tr("Error: %1").arg(archive_error_string(archive)));
-        if (r < ARCHIVE_WARN)
-            return false;
-
-        r = archive_write_header(ext, entry);
-        if (r != ARCHIVE_OK)
-            showMessage(tr("Error: %1").arg(archive_error_string(ext)));
-        else if (archive_entry_size(entry) > 0) {
-            copy_data(archive, ext);
-            if (r != ARCHIVE_OK)
-                showMessage(tr("Error: %1").arg(archive_error_string(ext)));
-            if (r < ARCHIVE_WARN)
-                return false;
-        }
-
-        r = archive_write_finish_entry(ext);
-        if (r != ARCHIVE_OK) {
-            showMessage(tr("Error: %1").arg(archive_error_string(ext)));
-        }
-        if (r < ARCHIVE_WARN)
-            return false;
-    } while (true);
-
-    archive_read_close(archive);
-    archive_read_free(archive);
-    archive_write_close(ext);
-    archive_write_free(ext);
-    return true;
-}
-
-int ImportDialog::copy_data(struct archive *ar, struct archive *aw)
-{
-    const void *buff;
-    size_t size;
-    int64_t offset;
-
-    do {
-        int r = archive_read_data_block(ar, &buff, &size, &offset);
-        if (r == ARCHIVE_EOF)
-            return (ARCHIVE_OK);
-        if (r != ARCHIVE_OK)
-            return (r);
-
-        r = archive_write_data_block(aw, buff, size, offset);
-        if (r != ARCHIVE_OK) {
-            showMessage(tr("Error: %1").arg(archive_error_string(aw)));
-            return (r);
-        }
-    } while (true);
+    m_extractor->cancel();
 }
 
 QString ImportDialog::findFileName()
@@ -26,8 +26,10 @@
 #include <QDir>
 
 #include "config.hh"
+#include "import-analyzer.hh"
 
 #ifdef ENABLE_LIBRARY_DOWNLOAD
+#include <QFutureWatcher>
 #include <QSslError>
 #include <QTime>
 #endif // ENABLE_LIBRARY_DOWNLOAD
@@ -46,6 +48,7 @@ class QNetworkReply;
 class ProgressBar;
 class FileChooser;
 class MainWindow;
+class ArchiveExtractor;
 
 /*!
   \file import-dialog.hh
@@ -54,6 +57,14 @@ class MainWindow;
 
   Songs may be imported from local (.sg) files or from a remote url.
 
+  A remote archive is extracted by an ArchiveExtractor while it is
+  downloaded, and each song is analyzed by an ImportAnalyzer as soon
+  as it is extracted.
+
+  Local archives of songs (.tar.gz, .zip...) are not extracted: their
+  songs are read in memory by an ImportAnalyzer and only the accepted
+  songs are written in the library.
+
   \image html import-dialog01.png
   \image html import-dialog02.png
 */
@@ -79,27 +90,7 @@ public:
 #ifdef ENABLE_LIBRARY_DOWNLOAD
     void initDownload();
 
-    /// Save some data as a new file.
-    /// @param filename : filename of the new file on disk
-    /// @param data : the data to be saved
-    /// @return true if the operation succeeded, false otherwise
-    bool saveToDisk(const QString &filename, QIODevice *data);
-
-    /// Decompress an archive depending on libarchive library
-    /// (http://github.com/libarchive/libarchive).
-    /// @param filename : filename of the compressed archive
-    /// @param directory : the directory resulting from the decompression
-    /// @return true if the operation succeeded, false otherwise
-    bool decompress(const QString &filename);
-
-    /// (http://github.com/libarchive/libarchive).
-    int copy_data(struct archive *ar, struct archive *aw);
-
 public slots:
-    /// Handles common errors and dialog at the end of the downloading operation
-    /// such as conflicts with filenames or failed download.
-    void downloadFinished();
-
     void sslErrors(const QList<QSslError> &errors);
 
     /// Network initialisation before download.
@@ -108,6 +99,16 @@ public slots:
     void downloadProgress(qint64 bytesRead, qint64 totalBytes);
 
     void cancelDownload();
+
+private slots:
+    /// Starts the analysis of a song as soon as it is extracted.
+    void analyzeSong(const QString &path);
+
+    /// Handles the end of the download and of the extraction of the
+    /// archive, such as a failed download.
+    void extractionFinished(bool success);
+
+    void analysisFinished();
 #endif // ENABLE_LIBRARY_DOWNLOAD
 
 private slots:
@@ -121,8 +122,10 @@ private slots:
 
 signals:
     void songsReadyToBeImported(const QStringList &);
+    void songsAnalyzed(const QList<ImportItem> &);
 
 private:
+    bool analyzeArchives();
     void setLocalSubWidgetsVisible(const bool value);
     void setNetworkSubWidgetsVisible(const bool value);
 
@@ -156,6 +159,11 @@ private:
     QNetworkAccessManager *m_manager;
     QNetworkReply *m_reply;
     QTime m_downloadTime;
+
+    ArchiveExtractor *m_extractor;
+    QString m_libraryDirectory;
+    QList<QFuture<ImportItem> > m_analyses;
+    QFutureWatcher<QList<ImportItem> > *m_analysisWatcher;
 #endif // ENABLE_LIBRARY_DOWNLOAD
 };
 
@@ -0,0 +1,279 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "latex-lexer.hh"
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+// region types packed in the state, 2 bits per region (0 ends the stack)
+const int ArgumentRegion = 1;
+const int OptionRegion = 2;
+const int QuoteRegion = 3;
+// "..." quotes never span several lines
+const int DoubleQuoteRegion = 4;
+const int MaxRegions = 15;
+
+struct Region {
+    int type;
+    int start;
+    int index; // position of its token in the list of tokens
+};
+
+LatexLexer::TokenType regionTokenType(int type)
+{
+    switch (type) {
+    case ArgumentRegion:
+        return LatexLexer::Argument;
+    case OptionRegion:
+        return LatexLexer::Option;
+    default:
+        return LatexLexer::Quote;
+    }
+}
+
+void closeRegion(const Region &region, int end,
+                 QList<LatexLexer::Token> &tokens)
+{
+    LatexLexer::Token token;
+    token.type = regionTokenType(region.type);
+    token.category = -1;
+    token.start = region.start;
+    token.length = end - region.start;
+    tokens.insert(region.index, token);
+}
+
+// closes the innermost region of the given type and the regions it contains
+void closeRegions(QVector<Region> &regions, int type, int end,
+                  QList<LatexLexer::Token> &tokens)
+{
+    int index = regions.size() - 1;
+    while (index >= 0 && regions[index].type != type)
+        --index;
+    if (index == -1)
+        return;
+
+    while (regions.size() > index) {
+        Region region = regions.last();
+        regions.pop_back();
+        if (region.type != DoubleQuoteRegion || regions.size() == index)
+            closeRegion(region, end, tokens);
+    }
+}
+}
+
+KeywordTable::KeywordTable()
+    : m_keywords()
+    , m_values()
+    , m_slots()
+    , m_seed(0)
+    , m_mask(0)
+{
+}
+
+void KeywordTable::insert(const QStringList &keywords, int value)
+{
+    foreach (const QString &keyword, keywords) {
+        if (m_keywords.contains(keyword))
+            continue;
+        m_keywords << keyword;
+        m_values << value;
+    }
+    build();
+}
+
+uint KeywordTable::hash(const QChar *key, int length, uint seed)
+{
+    // FNV-1a
+    uint h = 2166136261u ^ seed;
+    for (int i = 0; i < length; ++i) {
+        h ^= key[i].unicode();
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void KeywordTable::build()
+{
+    // look for a seed without collision, growing the table if needed
+    uint size = 8;
+    while (size < 2 * uint(m_keywords.size()))
+        size *= 2;
+
+    forever {
+        for (uint seed = 0; seed < 256; ++seed) {
+            QVector<int> table(int(size), -1);
+            bool collision = false;
+            for (int i = 0; i < m_keywords.size() && !collision; ++i) {
+                const QString &keyword = m_keywords[i];
+                uint slot =
+                    hash(keyword.constData(), keyword.size(), seed) & (size - 1);
+                if (table[int(slot)] != -1)
+                    collision = true;
+                else
+                    table[int(slot)] = i;
+            }
+            if (!collision) {
+                m_slots = table;
+                m_seed = seed;
+                m_mask = size - 1;
+                return;
+            }
+        }
+        size *= 2;
+    }
+}
+
+int KeywordTable::value(const QChar *key, int length) const
+{
+    if (m_slots.isEmpty())
+        return -1;
+
+    int index = m_slots[int(hash(key, length, m_seed) & m_mask)];
+    if (index == -1)
+        return -1;
+
+    const QString &keyword = m_keywords[index];
+    if (keyword.size() != length ||
+        QString::fromRawData(key, length) != keyword)
+        return -1;
+    return m_values[index];
+}
+
+LatexLexer::LatexLexer()
+    : m_macros()
+{
+}
+
+void LatexLexer::addMacros(const QStringList &names, int category)
+{
+    m_macros.insert(names, category);
+}
+
+int LatexLexer::tokenize(const QString &text, int state,
+                         QList<Token> &tokens) const
+{
+    // regions left open by the previous line
+    QVector<Region> regions;
+    for (int bits = qMax(state, 0); bits != 0; bits >>= 2) {
+        Region region;
+        region.type = bits & 3;
+        region.start = 0;
+        region.index = tokens.size();
+        regions << region;
+    }
+
+    const QChar *data = text.constData();
+    const int length = text.size();
+    int i = 0;
+    while (i < length) {
+        const QChar c = data[i];
+        Token token;
+        token.category = -1;
+        token.start = i;
+
+        if (c == '%') {
+            token.type = Comment;
+            token.length = length - i;
+            tokens << token;
+            break;
+        }
+
+        if (c == '\\') {
+            int end = i + 1;
+            if (end < length && data[end] == '[') {
+                // \[chord]
+                end = text.indexOf(']', end + 1);
+                end = (end == -1) ? length : end + 1;
+                token.type = Chord;
+            } else {
+                while (end < length && data[end].isLetter())
+                    ++end;
+                if (end == i + 1) {
+                    // escaped character such as \% or \{
+                    i = qMin(i + 2, length);
+                    continue;
+                }
+                token.type = Macro;
+                token.category = m_macros.value(data + i + 1, end - i - 1);
+                if (end < length && data[end] == '*')
+                    ++end;
+            }
+            token.length = end - i;
+            tokens << token;
+            i = end;
+            continue;
+        }
+
+        if (c == '{' || c == '[' ||
+            (c == '`' && i + 1 < length && data[i + 1] == '`')) {
+            Region region;
+            region.type = (c == '{') ? ArgumentRegion
+                                     : (c == '[') ? OptionRegion : QuoteRegion;
+            region.start = i;
+            region.index = tokens.size();
+            regions << region;
+            i += (region.type == QuoteRegion) ? 2 : 1;
+            continue;
+        }
+
+        if (c == '}' || c == ']') {
+            closeRegions(regions, (c == '}') ? ArgumentRegion : OptionRegion,
+                         i + 1, tokens);
+            ++i;
+            continue;
+        }
+
+        if (c == '\'' && i + 1 < length && data[i + 1] == '\'') {
+            closeRegions(regions, QuoteRegion, i + 2, tokens);
+            i += 2;
+            continue;
+        }
+
+        if (c == '"') {
+            if (!regions.isEmpty() && regions.last().type == DoubleQuoteRegion) {
+                closeRegions(regions, DoubleQuoteRegion, i + 1, tokens);
+            } else {
+                Region region;
+                region.type = DoubleQuoteRegion;
+                region.start = i;
+                region.index = tokens.size();
+                regions << region;
+            }
+            ++i;
+            continue;
+        }
+
+        ++i;
+    }
+
+    // the open regions continue on the next line, except "..." quotes
+    int nextState = 0;
+    int shift = 0;
+    for (int r = 0; r < regions.size(); ++r) {
+        if (regions[r].type == DoubleQuoteRegion || shift >= 2 * MaxRegions)
+            continue;
+        nextState |= regions[r].type << shift;
+        shift += 2;
+    }
+    for (int r = regions.size() - 1; r >= 0; --r)
+        if (regions[r].type != DoubleQuoteRegion)
+            closeRegion(regions[r], length, tokens);
+    return nextState;
+}
@@ -0,0 +1,127 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __LATEX_LEXER_HH__
+#define __LATEX_LEXER_HH__
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*!
+  \file latex-lexer.hh
+  \class KeywordTable
+  \brief KeywordTable is a perfect hash table of keywords
+
+  The hash function is seeded so that the keywords of the table do not
+  collide: a lookup computes a single hash and compares a single
+  keyword.
+*/
+class KeywordTable
+{
+public:
+    /// Constructor.
+    KeywordTable();
+
+    /*!
+    Adds the \a keywords with the value \a value; the table is rebuilt.
+  */
+    void insert(const QStringList &keywords, int value);
+
+    /*!
+    Returns the value of the keyword of \a length characters starting at
+    \a key; -1 if there is no such keyword.
+  */
+    int value(const QChar *key, int length) const;
+
+private:
+    static uint hash(const QChar *key, int length, uint seed);
+    void build();
+
+    QStringList m_keywords;
+    QList<int> m_values;
+    QVector<int> m_slots;
+    uint m_seed;
+    uint m_mask;
+};
+
+/*!
+  \class LatexLexer
+  \brief LatexLexer splits a line of the songs LaTeX dialect into tokens
+
+  The lexer reads a line once and produces tokens for macros, chords
+  (\\[...]), comments, quotes (``...'' and "..."), options ([...]) and
+  arguments ({...}). Macros are identified through KeywordTable
+  lookups.
+
+  Options, arguments and ``...'' quotes may span several lines: the
+  regions that are still open at the end of a line are packed into the
+  returned state, which is meant to be stored as the block state of a
+  QSyntaxHighlighter and given back for the next line.
+
+  A region token is inserted before the tokens it contains so that
+  applying the formats in order lets inner tokens override it.
+*/
+class LatexLexer
+{
+public:
+    /*!
+    \enum TokenType
+    This enum type describes the tokens produced by the lexer.
+  */
+    enum TokenType {
+        Macro,   /*!< \\macro; its category is given by addMacros(). */
+        Chord,   /*!< \\[chord]. */
+        Comment, /*!< % comment, until the end of the line. */
+        Quote,   /*!< ``quote'' or "quote". */
+        Option,  /*!< [option]. */
+        Argument /*!< {argument}. */
+    };
+
+    /*!
+    \struct Token
+    A token of \a length characters at position \a start of the line.
+  */
+    struct Token {
+        TokenType type;
+        int category; /*!< the category of macros, -1 if none.*/
+        int start;
+        int length;
+    };
+
+    /// Constructor.
+    LatexLexer();
+
+    /*!
+    Registers the macro \a names (without backslash) with \a category.
+  */
+    void addMacros(const QStringList &names, int category);
+
+    /*!
+    Appends the tokens of \a text to \a tokens. \a state is the state
+    returned for the previous line (or a negative value). Returns the
+    state at the end of \a text.
+  */
+    int tokenize(const QString &text, int state, QList<Token> &tokens) const;
+
+private:
+    KeywordTable m_macros;
+};
+
+#endif // __LATEX_LEXER_HH__
@@ -0,0 +1,394 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "library-search-dialog.hh"
+
+#include <QBoxLayout>
+#include <QCheckBox>
+#include <QCloseEvent>
+#include <QDialogButtonBox>
+#include <QFileInfo>
+#include <QFormLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTreeView>
+
+#include "library.hh"
+#include "main-window.hh"
+
+#include <QDebug>
+
+LibrarySearchModel::LibrarySearchModel(QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_songs()
+    , m_checked()
+    , m_matchCount(0)
+{
+}
+
+// the internal id of an occurrence is the row of its song plus one
+QModelIndex LibrarySearchModel::index(int row, int column,
+                                      const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent))
+        return QModelIndex();
+    if (!parent.isValid())
+        return createIndex(row, column, quintptr(0));
+    return createIndex(row, column, quintptr(parent.row() + 1));
+}
+
+QModelIndex LibrarySearchModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.internalId() == 0)
+        return QModelIndex();
+    return createIndex(int(index.internalId() - 1), 0, quintptr(0));
+}
+
+int LibrarySearchModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+        return m_songs.size();
+    if (parent.internalId() == 0 && parent.column() == 0)
+        return m_songs[parent.row()].matches.size();
+    return 0;
+}
+
+int LibrarySearchModel::columnCount(const QModelIndex &) const
+{
+    return 1;
+}
+
+QVariant LibrarySearchModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    if (index.internalId() == 0) {
+        const SongMatches &song = m_songs[index.row()];
+        switch (role) {
+        case Qt::DisplayRole:
+            return tr("%1 (%2)")
+                .arg(QFileInfo(song.path).fileName())
+                .arg(song.matches.size());
+        case Qt::ToolTipRole:
+        case PathRole:
+            return song.path;
+        case Qt::CheckStateRole:
+            return m_checked[index.row()] ? Qt::Checked : Qt::Unchecked;
+        case LineRole:
+            return 1;
+        }
+        return QVariant();
+    }
+
+    const SongMatches &song = m_songs[int(index.internalId() - 1)];
+    const SearchMatch &match = song.matches[index.row()];
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString("%1: %2").arg(match.line).arg(match.text.trimmed());
+    case PathRole:
+        return song.path;
+    case LineRole:
+        return match.line;
+    }
+    return QVariant();
+}
+
+bool LibrarySearchModel::setData(const QModelIndex &index,
+                                 const QVariant &value, int role)
+{
+    if (!index.isValid() || index.internalId() != 0 ||
+        role != Qt::CheckStateRole)
+        return false;
+
+    m_checked[index.row()] = (value.toInt() == Qt::Checked);
+    emit(dataChanged(index, index));
+    return true;
+}
+
+Qt::ItemFlags LibrarySearchModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return 0;
+    if (index.internalId() == 0)
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable |
+               Qt::ItemIsUserCheckable;
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+void LibrarySearchModel::appendSongs(const QList<SongMatches> &results)
+{
+    QList<SongMatches> songs;
+    foreach (const SongMatches &song, results)
+        if (!song.matches.isEmpty())
+            songs << song;
+    if (songs.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), m_songs.size(),
+                    m_songs.size() + songs.size() - 1);
+    foreach (const SongMatches &song, songs) {
+        m_songs << song;
+        m_checked << true;
+        m_matchCount += song.matches.size();
+    }
+    endInsertRows();
+}
+
+void LibrarySearchModel::clear()
+{
+    beginResetModel();
+    m_songs.clear();
+    m_checked.clear();
+    m_matchCount = 0;
+    endResetModel();
+}
+
+QStringList LibrarySearchModel::checkedSongs() const
+{
+    QStringList paths;
+    for (int i = 0; i < m_songs.size(); ++i)
+        if (m_checked[i])
+            paths << m_songs[i].path;
+    return paths;
+}
+
+int LibrarySearchModel::matchCount() const
+{
+    return m_matchCount;
+}
+
+LibrarySearchDialog::LibrarySearchDialog(QWidget *parent)
+    : QDialog(parent)
+    , m_findLineEdit(new QLineEdit(this))
+    , m_replaceLineEdit(new QLineEdit(this))
+    , m_caseCheckBox(new QCheckBox(tr("Match case"), this))
+    , m_wholeWordsCheckBox(new QCheckBox(tr("Match entire word only"), this))
+    , m_regexpCheckBox(new QCheckBox(tr("Regular expression"), this))
+    , m_searchButton(new QPushButton(tr("&Search")))
+    , m_replaceButton(new QPushButton(tr("&Replace")))
+    , m_view(new QTreeView(this))
+    , m_statusLabel(new QLabel(this))
+    , m_model(new LibrarySearchModel(this))
+    , m_search()
+    , m_searchWatcher(new QFutureWatcher<SongMatches>(this))
+    , m_replaceWatcher(new QFutureWatcher<SongReplacement>(this))
+{
+    setModal(false);
+    setWindowTitle(tr("Search in the library"));
+
+    connect(m_findLineEdit, SIGNAL(textChanged(const QString &)),
+            SLOT(updateButtons()));
+    connect(m_findLineEdit, SIGNAL(returnPressed()), SLOT(search()));
+
+    // only the visible results are laid out
+    m_view->setModel(m_model);
+    m_view->setHeaderHidden(true);
+    m_view->setUniformRowHeights(true);
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    connect(m_view, SIGNAL(activated(const QModelIndex &)),
+            SLOT(itemActivated(const QModelIndex &)));
+
+    connect(m_searchWatcher, SIGNAL(resultsReadyAt(int, int)),
+            SLOT(resultsReady(int, int)));
+    connect(m_searchWatcher, SIGNAL(finished()), SLOT(searchFinished()));
+    connect(m_replaceWatcher, SIGNAL(finished()), SLOT(replaceFinished()));
+
+    m_searchButton->setDefault(true);
+    connect(m_searchButton, SIGNAL(clicked()), SLOT(search()));
+    connect(m_replaceButton, SIGNAL(clicked()), SLOT(replace()));
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
+    buttonBox->addButton(m_replaceButton, QDialogButtonBox::ActionRole);
+    buttonBox->addButton(m_searchButton, QDialogButtonBox::ActionRole);
+    connect(buttonBox, SIGNAL(rejected()), SLOT(close()));
+
+    QBoxLayout *optionsLayout = new QHBoxLayout;
+    optionsLayout->addWidget(m_caseCheckBox);
+    optionsLayout->addWidget(m_wholeWordsCheckBox);
+    optionsLayout->addWidget(m_regexpCheckBox);
+    optionsLayout->addStretch();
+
+    QFormLayout *formLayout = new QFormLayout;
+    formLayout->addRow(tr("Find:"), m_findLineEdit);
+    formLayout->addRow(tr("Replace with:"), m_replaceLineEdit);
+    formLayout->addRow(optionsLayout);
+
+    QBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(m_view);
+    mainLayout->addWidget(m_statusLabel);
+    mainLayout->addWidget(buttonBox);
+    setLayout(mainLayout);
+
+    resize(600, 450);
+    updateButtons();
+}
+
+LibrarySearchDialog::~LibrarySearchDialog()
+{
+    m_searchWatcher->cancel();
+    m_searchWatcher->waitForFinished();
+    m_replaceWatcher->waitForFinished();
+}
+
+LibrarySearch::Options LibrarySearchDialog::options() const
+{
+    LibrarySearch::Options options = 0;
+    if (m_caseCheckBox->isChecked())
+        options |= LibrarySearch::CaseSensitive;
+    if (m_wholeWordsCheckBox->isChecked())
+        options |= LibrarySearch::WholeWords;
+    if (m_regexpCheckBox->isChecked())
+        options |= LibrarySearch::RegularExpression;
+    return options;
+}
+
+void LibrarySearchDialog::search()
+{
+    if (m_replaceWatcher->isRunning())
+        return;
+
+    m_searchWatcher->cancel();
+    m_searchWatcher->waitForFinished();
+    m_model->clear();
+
+    m_search = LibrarySearch(m_findLineEdit->text(), options());
+    if (!m_search.isValid()) {
+        m_statusLabel->setText(tr("Invalid expression: %1")
+                                   .arg(m_search.pattern()));
+        return;
+    }
+
+    Library *library = Library::instance();
+    QStringList paths;
+    for (int row = 0; row < library->rowCount(); ++row)
+        paths << library->data(library->index(row, 0), Library::PathRole)
+                     .toString();
+
+    m_statusLabel->setText(tr("Searching %1 songs...").arg(paths.size()));
+    m_searchWatcher->setFuture(m_search.searchSongs(paths));
+    updateButtons();
+}
+
+void LibrarySearchDialog::resultsReady(int begin, int end)
+{
+    QList<SongMatches> results;
+    for (int i = begin; i < end; ++i)
+        results << m_searchWatcher->resultAt(i);
+    m_model->appendSongs(results);
+}
+
+void LibrarySearchDialog::searchFinished()
+{
+    if (!m_searchWatcher->isCanceled())
+        m_statusLabel->setText(tr("%1 occurrence(s) found in %2 song(s)")
+                                   .arg(m_model->matchCount())
+                                   .arg(m_model->rowCount()));
+    updateButtons();
+}
+
+void LibrarySearchDialog::replace()
+{
+    if (m_searchWatcher->isRunning() || m_replaceWatcher->isRunning())
+        return;
+
+    QStringList paths = m_model->checkedSongs();
+
+    // songs with unsaved changes are not rewritten
+    QStringList skipped;
+    if (MainWindow *window = qobject_cast<MainWindow *>(parentWidget()))
+        foreach (const QString &path, window->modifiedSongs())
+            if (paths.removeAll(path) > 0)
+                skipped << path;
+    if (!skipped.isEmpty())
+        QMessageBox::warning(this, windowTitle(),
+                             tr("The following songs have unsaved changes "
+                                "and will not be modified:\n%1")
+                                 .arg(skipped.join("\n")));
+    if (paths.isEmpty())
+        return;
+
+    int ret = QMessageBox::question(
+        this, windowTitle(),
+        tr("Replace \"%1\" with \"%2\" in %3 song(s)?")
+            .arg(m_search.pattern())
+            .arg(m_replaceLineEdit->text())
+            .arg(paths.size()),
+        QMessageBox::Ok | QMessageBox::Cancel, QMessageBox::Ok);
+    if (ret != QMessageBox::Ok)
+        return;
+
+    m_statusLabel->setText(tr("Replacing in %1 songs...").arg(paths.size()));
+    m_replaceWatcher->setFuture(
+        m_search.replaceSongs(paths, m_replaceLineEdit->text()));
+    updateButtons();
+}
+
+void LibrarySearchDialog::replaceFinished()
+{
+    QStringList replaced;
+    QStringList errors;
+    int count = 0;
+    QList<SongReplacement> results = m_replaceWatcher->future().results();
+    foreach (const SongReplacement &result, results) {
+        if (!result.error.isEmpty())
+            errors << QString("%1: %2").arg(result.path).arg(result.error);
+        else if (result.count > 0)
+            replaced << result.path;
+        count += result.count;
+    }
+
+    // only the modified songs are loaded again
+    Library::instance()->reloadSongs(replaced);
+    emit(songsReplaced(replaced));
+
+    m_model->clear();
+    m_statusLabel->setText(tr("Replaced %1 occurrence(s) in %2 song(s)")
+                               .arg(count)
+                               .arg(replaced.size()));
+    if (!errors.isEmpty())
+        QMessageBox::warning(this, windowTitle(),
+                             tr("The following songs could not be "
+                                "modified:\n%1")
+                                 .arg(errors.join("\n")));
+    updateButtons();
+}
+
+void LibrarySearchDialog::itemActivated(const QModelIndex &index)
+{
+    emit(songActivated(index.data(LibrarySearchModel::PathRole).toString(),
+                       index.data(LibrarySearchModel::LineRole).toInt()));
+}
+
+void LibrarySearchDialog::updateButtons()
+{
+    bool running =
+        m_searchWatcher->isRunning() || m_replaceWatcher->isRunning();
+    m_searchButton->setEnabled(!m_findLineEdit->text().isEmpty() &&
+                               !m_replaceWatcher->isRunning());
+    m_replaceButton->setEnabled(!running && m_model->rowCount() > 0);
+}
+
+void LibrarySearchDialog::closeEvent(QCloseEvent *event)
+{
+    m_searchWatcher->cancel();
+    event->accept();
+}
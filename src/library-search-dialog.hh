@@ -0,0 +1,169 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __LIBRARY_SEARCH_DIALOG_HH__
+#define __LIBRARY_SEARCH_DIALOG_HH__
+
+#include <QAbstractItemModel>
+#include <QDialog>
+#include <QFutureWatcher>
+#include <QVector>
+
+#include "library-search.hh"
+
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QModelIndex;
+class QPushButton;
+class QTreeView;
+
+/*!
+  \file library-search-dialog.hh
+  \class LibrarySearchModel
+  \brief LibrarySearchModel presents the results of a LibrarySearch
+
+  The top-level items are the songs that contain the searched text,
+  their children being the occurrences. Songs are checkable to choose
+  which ones are replaced.
+*/
+class LibrarySearchModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    /// Additional roles of the items.
+    enum Roles {
+        PathRole = Qt::UserRole + 1, /*!< the path of the song.*/
+        LineRole = Qt::UserRole + 2  /*!< the line of the occurrence.*/
+    };
+
+    /// Constructor.
+    LibrarySearchModel(QObject *parent = 0);
+
+    virtual QModelIndex index(int row, int column,
+                              const QModelIndex &parent = QModelIndex()) const;
+    virtual QModelIndex parent(const QModelIndex &index) const;
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex &index,
+                          int role = Qt::DisplayRole) const;
+    virtual bool setData(const QModelIndex &index, const QVariant &value,
+                         int role = Qt::EditRole);
+    virtual Qt::ItemFlags flags(const QModelIndex &index) const;
+
+    /*!
+    Appends the songs of \a results that contain occurrences.
+  */
+    void appendSongs(const QList<SongMatches> &results);
+
+    /*!
+    Removes all the songs.
+  */
+    void clear();
+
+    /*!
+    Returns the paths of the checked songs.
+  */
+    QStringList checkedSongs() const;
+
+    /*!
+    Returns the number of occurrences in all the songs.
+  */
+    int matchCount() const;
+
+private:
+    QList<SongMatches> m_songs;
+    QVector<bool> m_checked;
+    int m_matchCount;
+};
+
+/*!
+  \class LibrarySearchDialog
+  \brief LibrarySearchDialog finds and replaces a text in the whole library
+
+  The songs are searched in the background and the results are displayed
+  as they arrive. Replacements are applied to the checked songs, which
+  are then reloaded in the Library. Songs with unsaved changes in an
+  editor of the MainWindow are skipped.
+*/
+class LibrarySearchDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    LibrarySearchDialog(QWidget *parent = 0);
+
+    /// Destructor.
+    ~LibrarySearchDialog();
+
+signals:
+    /*!
+    This signal is emitted when an occurrence at line \a line of the
+    song \a path is activated.
+  */
+    void songActivated(const QString &path, int line);
+
+    /*!
+    This signal is emitted when the songs \a paths have been modified by
+    a replacement.
+  */
+    void songsReplaced(const QStringList &paths);
+
+public slots:
+    /*!
+    Searches the text in all the songs of the library.
+  */
+    void search();
+
+    /*!
+    Replaces the text in the checked songs.
+  */
+    void replace();
+
+protected:
+    virtual void closeEvent(QCloseEvent *event);
+
+private slots:
+    void resultsReady(int begin, int end);
+    void searchFinished();
+    void replaceFinished();
+    void itemActivated(const QModelIndex &index);
+    void updateButtons();
+
+private:
+    LibrarySearch::Options options() const;
+
+    QLineEdit *m_findLineEdit;
+    QLineEdit *m_replaceLineEdit;
+    QCheckBox *m_caseCheckBox;
+    QCheckBox *m_wholeWordsCheckBox;
+    QCheckBox *m_regexpCheckBox;
+    QPushButton *m_searchButton;
+    QPushButton *m_replaceButton;
+    QTreeView *m_view;
+    QLabel *m_statusLabel;
+
+    LibrarySearchModel *m_model;
+    LibrarySearch m_search;
+    QFutureWatcher<SongMatches> *m_searchWatcher;
+    QFutureWatcher<SongReplacement> *m_replaceWatcher;
+};
+
+#endif // __LIBRARY_SEARCH_DIALOG_HH__
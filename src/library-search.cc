@@ -0,0 +1,319 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "library-search.hh"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+// longest line kept in the matches
+const int MaxLineLength = 200;
+
+bool readSong(const QString &path, const QByteArray &required, QString &text)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 size = file.size();
+    if (size == 0) {
+        text.clear();
+        return required.isEmpty();
+    }
+
+    uchar *data = file.map(0, size);
+    QByteArray bytes = data ? QByteArray::fromRawData((const char *)data, size)
+                            : file.readAll();
+
+    // most songs do not contain the text: do not decode them
+    bool found = required.isEmpty() || bytes.indexOf(required) != -1;
+    if (found)
+        text = QString::fromUtf8(bytes.constData(), bytes.size());
+
+    if (data)
+        file.unmap(data);
+    return found;
+}
+
+// replacement text where \1 to \9 are the captured texts of regexp
+QString expandReplacement(const QString &replacement, const QRegExp &regexp)
+{
+    if (!replacement.contains('\\'))
+        return replacement;
+
+    QString result;
+    result.reserve(replacement.size());
+    for (int i = 0; i < replacement.size(); ++i) {
+        QChar c = replacement[i];
+        if (c == '\\' && i + 1 < replacement.size()) {
+            QChar next = replacement[i + 1];
+            if (next.isDigit() && next != '0') {
+                result += regexp.cap(next.digitValue());
+                ++i;
+                continue;
+            }
+            if (next == '\\') {
+                result += next;
+                ++i;
+                continue;
+            }
+        }
+        result += c;
+    }
+    return result;
+}
+
+struct SearchSong {
+    typedef SongMatches result_type;
+
+    SearchSong(const LibrarySearch &search) : m_search(search) {}
+
+    SongMatches operator()(const QString &path) const
+    {
+        return m_search.searchSong(path);
+    }
+
+    LibrarySearch m_search;
+};
+
+struct ReplaceSong {
+    typedef SongReplacement result_type;
+
+    ReplaceSong(const LibrarySearch &search, const QString &replacement)
+        : m_search(search)
+        , m_replacement(replacement)
+    {
+    }
+
+    SongReplacement operator()(const QString &path) const
+    {
+        return m_search.replaceSong(path, m_replacement);
+    }
+
+    LibrarySearch m_search;
+    QString m_replacement;
+};
+}
+
+LibrarySearch::LibrarySearch(const QString &pattern, Options options)
+    : m_pattern(pattern)
+    , m_options(options)
+    , m_matcher(pattern, (options & CaseSensitive) ? Qt::CaseSensitive
+                                                   : Qt::CaseInsensitive)
+    , m_regexp()
+    , m_encodedPattern()
+{
+    if (m_options & RegularExpression) {
+        QString expression = pattern;
+        if (m_options & WholeWords)
+            expression = QString("\\b(?:%1)\\b").arg(pattern);
+        m_regexp = QRegExp(expression, (options & CaseSensitive)
+                                           ? Qt::CaseSensitive
+                                           : Qt::CaseInsensitive,
+                           QRegExp::RegExp2);
+    } else if (m_options & CaseSensitive) {
+        m_encodedPattern = pattern.toUtf8();
+    }
+}
+
+QString LibrarySearch::pattern() const
+{
+    return m_pattern;
+}
+
+LibrarySearch::Options LibrarySearch::options() const
+{
+    return m_options;
+}
+
+bool LibrarySearch::isValid() const
+{
+    if (m_pattern.isEmpty())
+        return false;
+    return !(m_options & RegularExpression) || m_regexp.isValid();
+}
+
+bool LibrarySearch::isWholeWord(const QString &text, int position,
+                                int length) const
+{
+    int end = position + length;
+    if (position > 0 &&
+        (text[position - 1].isLetterOrNumber() || text[position - 1] == '_'))
+        return false;
+    if (end < text.size() &&
+        (text[end].isLetterOrNumber() || text[end] == '_'))
+        return false;
+    return true;
+}
+
+QList<QPair<int, int> > LibrarySearch::matches(const QString &text) const
+{
+    QList<QPair<int, int> > result;
+    if (!isValid())
+        return result;
+
+    if (m_options & RegularExpression) {
+        // QRegExp keeps its captures: each thread uses its own copy
+        QRegExp regexp(m_regexp);
+        int position = 0;
+        while ((position = regexp.indexIn(text, position)) != -1) {
+            int length = regexp.matchedLength();
+            if (length > 0)
+                result << qMakePair(position, length);
+            position += qMax(1, length);
+        }
+        return result;
+    }
+
+    const int length = m_pattern.size();
+    int position = 0;
+    while ((position = m_matcher.indexIn(text, position)) != -1) {
+        if (!(m_options & WholeWords) || isWholeWord(text, position, length)) {
+            result << qMakePair(position, length);
+            position += length;
+        } else {
+            ++position;
+        }
+    }
+    return result;
+}
+
+QString LibrarySearch::replace(const QString &text, const QString &replacement,
+                               int *count) const
+{
+    QString result;
+    int replaced = 0;
+    int last = 0;
+
+    if (m_options & RegularExpression) {
+        QRegExp regexp(m_regexp);
+        int position = 0;
+        while (isValid() && (position = regexp.indexIn(text, position)) != -1) {
+            int length = regexp.matchedLength();
+            if (length > 0) {
+                result += text.midRef(last, position - last);
+                result += expandReplacement(replacement, regexp);
+                last = position + length;
+                ++replaced;
+            }
+            position += qMax(1, length);
+        }
+    } else {
+        QList<QPair<int, int> > ranges = matches(text);
+        result.reserve(text.size() +
+                       ranges.size() * (replacement.size() - m_pattern.size()));
+        for (int i = 0; i < ranges.size(); ++i) {
+            result += text.midRef(last, ranges[i].first - last);
+            result += replacement;
+            last = ranges[i].first + ranges[i].second;
+        }
+        replaced = ranges.size();
+    }
+    result += text.midRef(last);
+
+    if (count)
+        *count = replaced;
+    return result;
+}
+
+SongMatches LibrarySearch::searchSong(const QString &path) const
+{
+    SongMatches songMatches;
+    songMatches.path = path;
+
+    QString text;
+    if (!isValid() || !readSong(path, m_encodedPattern, text))
+        return songMatches;
+
+    // line numbers are counted between consecutive matches
+    int line = 1;
+    int lineStart = 0;
+    int scanned = 0;
+    typedef QPair<int, int> Range;
+    foreach (const Range &range, matches(text)) {
+        for (; scanned < range.first; ++scanned) {
+            if (text[scanned] == '\n') {
+                ++line;
+                lineStart = scanned + 1;
+            }
+        }
+
+        int lineEnd = text.indexOf('\n', lineStart);
+        if (lineEnd == -1)
+            lineEnd = text.size();
+
+        SearchMatch match;
+        match.line = line;
+        match.column = range.first - lineStart;
+        match.length = range.second;
+        match.text = text.mid(lineStart, qMin(lineEnd - lineStart,
+                                              MaxLineLength));
+        songMatches.matches << match;
+    }
+    return songMatches;
+}
+
+SongReplacement LibrarySearch::replaceSong(const QString &path,
+                                           const QString &replacement) const
+{
+    SongReplacement songReplacement;
+    songReplacement.path = path;
+    songReplacement.count = 0;
+
+    QString text;
+    if (!isValid() || !readSong(path, m_encodedPattern, text))
+        return songReplacement;
+
+    int count = 0;
+    QString result = replace(text, replacement, &count);
+    if (count == 0)
+        return songReplacement;
+
+    // the song is replaced only once completely written
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        songReplacement.error = file.errorString();
+        return songReplacement;
+    }
+    file.write(result.toUtf8());
+    if (!file.commit()) {
+        songReplacement.error = file.errorString();
+        return songReplacement;
+    }
+
+    songReplacement.count = count;
+    return songReplacement;
+}
+
+QFuture<SongMatches>
+LibrarySearch::searchSongs(const QStringList &paths) const
+{
+    return QtConcurrent::mapped(paths, SearchSong(*this));
+}
+
+QFuture<SongReplacement>
+LibrarySearch::replaceSongs(const QStringList &paths,
+                            const QString &replacement) const
+{
+    return QtConcurrent::mapped(paths, ReplaceSong(*this, replacement));
+}
@@ -0,0 +1,164 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __LIBRARY_SEARCH_HH__
+#define __LIBRARY_SEARCH_HH__
+
+#include <QByteArray>
+#include <QFuture>
+#include <QList>
+#include <QPair>
+#include <QRegExp>
+#include <QString>
+#include <QStringList>
+#include <QStringMatcher>
+
+/*!
+  \file library-search.hh
+  \struct SearchMatch "library-search.hh"
+  \brief SearchMatch is an occurrence of the searched text in a song
+*/
+struct SearchMatch {
+    int line;     /*!< the line of the occurrence (1-based).*/
+    int column;   /*!< the position of the occurrence in the line.*/
+    int length;   /*!< the length of the occurrence.*/
+    QString text; /*!< the content of the line.*/
+};
+
+/*!
+  \struct SongMatches "library-search.hh"
+  \brief SongMatches are the occurrences of the searched text in a song
+*/
+struct SongMatches {
+    QString path;               /*!< the path of the .sg file.*/
+    QList<SearchMatch> matches; /*!< the occurrences, in order.*/
+};
+
+/*!
+  \struct SongReplacement "library-search.hh"
+  \brief SongReplacement is the result of a replacement in a song
+*/
+struct SongReplacement {
+    QString path;  /*!< the path of the .sg file.*/
+    int count;     /*!< the number of replaced occurrences.*/
+    QString error; /*!< the error message if the file was not written.*/
+};
+
+/*!
+  \class LibrarySearch
+  \brief LibrarySearch finds and replaces a text in the songs of the library
+
+  The .sg files are memory-mapped and searched on the global thread
+  pool. A plain text is found with a QStringMatcher and, when the search
+  is case sensitive, files that do not contain its UTF-8 encoding are
+  skipped without being decoded. Regular expressions use QRegExp; \\1 to
+  \\9 in the replacement text refer to their captured texts.
+
+  Replacements are written to a temporary file which is then renamed
+  over the song (QSaveFile), so that a song is either completely
+  replaced or left untouched.
+
+  \code
+  LibrarySearch search("Jonhny Cash", LibrarySearch::CaseSensitive);
+  QFuture<SongMatches> results = search.searchSongs(paths);
+  \endcode
+
+  All the functions of this class are reentrant.
+*/
+class LibrarySearch
+{
+public:
+    /// Search options.
+    enum Option {
+        CaseSensitive = 0x1,    /*!< the case of the text matters.*/
+        WholeWords = 0x2,       /*!< only entire words are found.*/
+        RegularExpression = 0x4 /*!< the text is a regular expression.*/
+    };
+    Q_DECLARE_FLAGS(Options, Option)
+
+    /// Constructor.
+    LibrarySearch(const QString &pattern = QString(), Options options = 0);
+
+    /*!
+    Returns the searched text.
+  */
+    QString pattern() const;
+
+    /*!
+    Returns the search options.
+  */
+    Options options() const;
+
+    /*!
+    Returns \a false if the pattern is empty or is an invalid regular
+    expression.
+  */
+    bool isValid() const;
+
+    /*!
+    Returns the occurrences of the pattern in the song \a path.
+  */
+    SongMatches searchSong(const QString &path) const;
+
+    /*!
+    Replaces the occurrences of the pattern in the song \a path with
+    \a replacement.
+  */
+    SongReplacement replaceSong(const QString &path,
+                                const QString &replacement) const;
+
+    /*!
+    Searches the songs \a paths in parallel. Songs without occurrence
+    are part of the results, with an empty list of matches.
+  */
+    QFuture<SongMatches> searchSongs(const QStringList &paths) const;
+
+    /*!
+    Replaces the occurrences of the pattern in the songs \a paths in
+    parallel.
+  */
+    QFuture<SongReplacement> replaceSongs(const QStringList &paths,
+                                          const QString &replacement) const;
+
+    /*!
+    Returns the occurrences of the pattern in \a text, as pairs of
+    position and length.
+  */
+    QList<QPair<int, int> > matches(const QString &text) const;
+
+    /*!
+    Returns \a text where the occurrences of the pattern are replaced
+    with \a replacement, built in a single pass; \a count is set to the
+    number of replaced occurrences.
+  */
+    QString replace(const QString &text, const QString &replacement,
+                    int *count = 0) const;
+
+private:
+    bool isWholeWord(const QString &text, int position, int length) const;
+
+    QString m_pattern;
+    Options m_options;
+    QStringMatcher m_matcher;
+    QRegExp m_regexp;
+    QByteArray m_encodedPattern;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(LibrarySearch::Options)
+
+#endif // __LIBRARY_SEARCH_HH__
@@ -30,6 +30,8 @@
 #include <QSettings>
 #include <QMessageBox>
 #include <QMap>
+#include <QSaveFile>
+#include <QSet>
 
 #include <QDebug>
 
@@ -58,6 +60,7 @@ QString stringToFilename(const QString &string, const QString &separator)
 
 Library::Library()
     : QAbstractTableModel()
+    , m_parent(0)
     , m_directory()
     , m_completionModel(new QStringListModel(this))
     , m_artistCompletionModel(new QStringListModel(this))
@@ -65,6 +68,7 @@ Library::Library()
     , m_urlCompletionModel(new QStringListModel(this))
     , m_templates()
     , m_songs()
+    , m_chordIndex()
 {
     connect(this, SIGNAL(directoryChanged(const QDir &)), SLOT(update()));
 }
@@ -106,13 +110,20 @@ void Library::setDirectory(const QString &directory)
 }
 
 void Library::setDirectory(const QDir &directory)
+{
+    if (directory.absolutePath() != m_directory.absolutePath()) {
+        openDirectory(directory);
+        writeSettings();
+    }
+}
+
+void Library::openDirectory(const QDir &directory)
 {
     if (directory.absolutePath() != m_directory.absolutePath()) {
         m_directory = directory;
         QDir templatesDirectory(
             QString("%1/templates").arg(directory.canonicalPath()));
         m_templates = templatesDirectory.entryList(QStringList() << "*.tex");
-        writeSettings();
         emit(directoryChanged(m_directory));
     }
 }
@@ -257,6 +268,7 @@ QVariant Library::data(const QModelIndex &index, int role) const
 void Library::update()
 {
     m_songs.clear();
+    m_chordIndex.clear();
 
     // get the path of each song in the library
     QStringList filter = QStringList() << "*.sg";
@@ -268,10 +280,12 @@ void Library::update()
         paths.append(it.next());
 
     showMessage(tr("Updating the library..."));
-    progressBar()->setCancelable(false);
-    progressBar()->setTextVisible(true);
-    progressBar()->setRange(0, paths.size());
-    progressBar()->show();
+    if (progressBar()) {
+        progressBar()->setCancelable(false);
+        progressBar()->setTextVisible(true);
+        progressBar()->setRange(0, paths.size());
+        progressBar()->show();
+    }
 
     addSongs(paths);
 
@@ -293,10 +307,12 @@ void Library::update()
     m_albumCompletionModel->setStringList(albumList);
     m_urlCompletionModel->setStringList(urlList);
 
-    progressBar()->setCancelable(true);
-    progressBar()->setTextVisible(false);
-    progressBar()->setRange(0, 0);
-    progressBar()->hide();
+    if (progressBar()) {
+        progressBar()->setCancelable(true);
+        progressBar()->setTextVisible(false);
+        progressBar()->setRange(0, 0);
+        progressBar()->hide();
+    }
     showMessage(tr("Library updated."));
     emit(wasModified());
 }
@@ -308,6 +324,7 @@ int Library::columnCount(const QModelIndex &) const { return 7; }
 void Library::addSong(const Song &song, bool resetModel)
 {
     m_songs << song;
+    m_chordIndex.addSong(song);
 
     if (resetModel) {
         beginResetModel();
@@ -324,7 +341,8 @@ void Library::addSongs(const QStringList &paths)
     // run through the library songs files
     QStringListIterator filepath(paths);
     while (filepath.hasNext()) {
-        progressBar()->setValue(++songCount);
+        if (progressBar())
+            progressBar()->setValue(++songCount);
         loadSong(filepath.next(), &song);
         addSong(song);
     }
@@ -332,7 +350,11 @@ void Library::addSongs(const QStringList &paths)
     endResetModel();
 }
 
-void Library::addSong(const QString &path) { m_songs << Song::fromFile(path); }
+void Library::addSong(const QString &path)
+{
+    m_songs << Song::fromFile(path);
+    m_chordIndex.addSong(m_songs.last());
+}
 
 void Library::removeSong(const QString &path)
 {
@@ -343,10 +365,26 @@ void Library::removeSong(const QString &path)
             break;
         }
     }
+    m_chordIndex.removeSong(path);
     emit(wasModified());
     endResetModel();
 }
 
+void Library::reloadSongs(const QStringList &paths)
+{
+    if (paths.isEmpty())
+        return;
+
+    QSet<QString> remaining = QSet<QString>::fromList(paths);
+    for (int i = 0; i < m_songs.size() && !remaining.isEmpty(); ++i) {
+        if (remaining.remove(m_songs[i].path)) {
+            loadSong(m_songs[i].path, &m_songs[i]);
+            m_chordIndex.addSong(m_songs[i]);
+            emit(dataChanged(index(i, 0), index(i, columnCount() - 1)));
+        }
+    }
+}
+
 Song Library::getSong(const QString &path) const
 {
     for (int i = 0; i < m_songs.size(); ++i) {
@@ -374,20 +412,25 @@ void Library::loadSong(const QString &path, Song *song)
 
 void Library::saveSong(Song &song)
 {
-    // write the song file
-    QFile file(song.path);
+    // write the song file: the previous version is only replaced once
+    // the new one is completely written
+    QSaveFile file(song.path);
     if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
         QTextStream stream(&file);
         stream.setCodec("UTF-8");
         stream << Song::toString(song);
-        file.close();
+        stream.flush();
+        if (!file.commit())
+            qWarning() << "Unable to save the song file: " << song.path;
     }
     // update the song in the library
     int index = getSongIndex(song.path);
-    if (index != -1)
+    if (index != -1) {
         m_songs[index] = song;
-    else // new song
+        m_chordIndex.addSong(song);
+    } else { // new song
         addSong(song, true);
+    }
 }
 
 void Library::saveCover(Song &song, const QImage &cover)
@@ -426,16 +469,22 @@ void Library::importSongs(const QStringList &filenames)
     showMessage(tr("Importing %1 songs within the library %2")
                     .arg(filenames.count())
                     .arg(directory().absolutePath()));
-    Song song;
-    QMap<QString, QString> sourceTargetMap;
-    foreach (const QString &filename, filenames) {
-        song = Song::fromFile(filename);
-        sourceTargetMap.insert(filename, pathToSong(song));
+    ConflictDialog dialog(parent());
+    dialog.analyzeSongs(filenames, directory().canonicalPath());
+    if (dialog.exec() == QDialog::Accepted) {
+        update();
+        showMessage(tr("Import songs completed"));
     }
+}
 
+void Library::importSongs(const QList<ImportItem> &items)
+{
+    showMessage(tr("Importing %1 songs within the library %2")
+                    .arg(items.count())
+                    .arg(directory().absolutePath()));
     ConflictDialog dialog(parent());
-    dialog.setSourceTargetFiles(sourceTargetMap);
-    if (dialog.conflictsFound() && dialog.exec() == QDialog::Accepted) {
+    dialog.setItems(items);
+    if (dialog.exec() == QDialog::Accepted) {
         update();
         showMessage(tr("Import songs completed"));
     }
@@ -469,12 +518,18 @@ void Library::deleteSong(const QString &path)
 }
 
 QString Library::pathToSong(const QString &artist, const QString &title) const
+{
+    return pathToSong(directory().canonicalPath(), artist, title);
+}
+
+QString Library::pathToSong(const QString &directory, const QString &artist,
+                            const QString &title)
 {
     QString artistInPath = stringToFilename(artist, "_");
     QString titleInPath = stringToFilename(title, "_");
 
     return QString("%1/songs/%2/%3.sg")
-        .arg(directory().canonicalPath())
+        .arg(directory)
         .arg(artistInPath)
         .arg(titleInPath);
 }
@@ -484,11 +539,17 @@ QString Library::pathToSong(Song &song) const
     return pathToSong(song.artist, song.title);
 }
 
-ProgressBar *Library::progressBar() const { return parent()->progressBar(); }
+const ChordIndex &Library::chordIndex() const { return m_chordIndex; }
+
+ProgressBar *Library::progressBar() const
+{
+    return parent() ? parent()->progressBar() : 0;
+}
 
 void Library::showMessage(const QString &message)
 {
-    parent()->statusBar()->showMessage(message);
+    if (parent())
+        parent()->statusBar()->showMessage(message);
 }
 
 MainWindow *Library::parent() const { return m_parent; }
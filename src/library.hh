@@ -22,6 +22,7 @@
 
 #include "song.hh"
 #include "singleton.hh"
+#include "chord-index.hh"
 
 #include <QAbstractTableModel>
 #include <QString>
@@ -35,6 +36,7 @@ class QStringListModel;
 class QPixmap;
 class ProgressBar;
 class MainWindow;
+struct ImportItem;
 
 /*!
   \file library.hh
@@ -118,6 +120,13 @@ public:
   */
     void setDirectory(const QDir &directory);
 
+    /*!
+    Sets \a directory as the directory for the library without
+    saving it in the settings.
+    \sa setDirectory
+  */
+    void openDirectory(const QDir &directory);
+
     /*!
     Returns the list of available templates (*.tmpl files).
   */
@@ -186,6 +195,14 @@ public:
    */
     QString pathToSong(const QString &artist, const QString &title) const;
 
+    /*!
+    Returns the absolute path of an .sg file from \a artist and \a title
+    names within the library whose canonical path is \a directory.
+    This function is thread-safe.
+  */
+    static QString pathToSong(const QString &directory, const QString &artist,
+                              const QString &title);
+
     /*!
     This is a convenience method that returns the absolute path of
     an .sg file from a Song object.
@@ -215,6 +232,12 @@ public:
 
     void importSongs(const QStringList &filenames);
 
+    /*!
+    Imports the songs of \a items, that were analyzed while they were
+    downloaded.
+  */
+    void importSongs(const QList<ImportItem> &items);
+
     /*!
     Returns \a true if the song \a path is already in the library.
     \sa addSong, removeSong
@@ -227,6 +250,13 @@ public:
   */
     void removeSong(const QString &path);
 
+    /*!
+    Loads again the songs whose files are \a paths, without resetting
+    the model: only the rows of these songs are updated.
+    \sa loadSong
+  */
+    void reloadSongs(const QStringList &paths);
+
     /*! Returns the index of the song \a path
     from the library.
     \sa getSong
@@ -267,6 +297,11 @@ public:
   */
     void deleteSong(const QString &path);
 
+    /*!
+    Returns the index of the chords used by the songs of the library.
+  */
+    const ChordIndex &chordIndex() const;
+
     static QString checkPath(const QString &path);
 
     static void recursiveFindFiles(const QString &path,
@@ -302,6 +337,7 @@ private:
 
     QStringList m_templates;
     QList<Song> m_songs;
+    ChordIndex m_chordIndex;
 };
 
 Q_DECLARE_METATYPE(QLocale::Language)
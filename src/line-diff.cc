@@ -0,0 +1,320 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "line-diff.hh"
+
+#include <cstring>
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+// largest number of edits computed by the Myers algorithm: beyond,
+// the remaining texts are considered as entirely replaced
+const int MaxEditDistance = 1024;
+
+enum TokenClass { Word, Blank, Symbol };
+
+TokenClass tokenClass(const QChar &c)
+{
+    if (c.isLetterOrNumber())
+        return Word;
+    if (c == QLatin1Char(' ') || c == QLatin1Char('\t'))
+        return Blank;
+    return Symbol;
+}
+
+// the lines of text, with their line breaks
+void splitLines(const QString &text, QVector<QStringRef> &lines)
+{
+    lines.resize(0);
+    int start = 0;
+    int end;
+    while ((end = text.indexOf('\n', start)) != -1) {
+        lines << text.midRef(start, end - start + 1);
+        start = end + 1;
+    }
+    if (start < text.size())
+        lines << text.midRef(start);
+}
+
+// the words, the blanks and the symbols of text
+void splitWords(const QStringRef &text, QVector<QStringRef> &words)
+{
+    words.resize(0);
+    int start = 0;
+    while (start < text.size()) {
+        TokenClass type = tokenClass(text.at(start));
+        int end = start + 1;
+        if (type != Symbol)
+            while (end < text.size() && tokenClass(text.at(end)) == type)
+                ++end;
+        words << QStringRef(text.string(), text.position() + start,
+                            end - start);
+        start = end;
+    }
+}
+
+// the tokens from begin to end are contiguous in their text
+QStringRef span(const QVector<QStringRef> &tokens, int begin, int end)
+{
+    if (begin >= end)
+        return QStringRef();
+    const QStringRef &last = tokens[end - 1];
+    int position = tokens[begin].position();
+    return QStringRef(last.string(), position,
+                      last.position() + last.size() - position);
+}
+
+void appendDiff(QList<Diff> &diffs, Operation operation,
+                const QStringRef &text)
+{
+    if (text.isEmpty())
+        return;
+    if (!diffs.isEmpty() && diffs.last().operation == operation)
+        diffs.last().text += text;
+    else
+        diffs << Diff(operation, text.toString());
+}
+}
+
+LineDiff::LineDiff()
+    : m_ids()
+    , m_lines1()
+    , m_lines2()
+    , m_words1()
+    , m_words2()
+    , m_ids1()
+    , m_ids2()
+    , m_front()
+    , m_trace()
+    , m_edits()
+    , m_lineEdits()
+    , m_backtrace()
+{
+}
+
+void LineDiff::intern(const QVector<QStringRef> &tokens, QVector<int> &ids)
+{
+    ids.resize(tokens.size());
+    for (int i = 0; i < tokens.size(); ++i) {
+        QHash<QStringRef, int>::const_iterator it = m_ids.constFind(tokens[i]);
+        if (it == m_ids.constEnd())
+            it = m_ids.insert(tokens[i], m_ids.size());
+        ids[i] = it.value();
+    }
+}
+
+void LineDiff::addEdit(EditType type, int count)
+{
+    if (count <= 0)
+        return;
+    if (!m_edits.isEmpty() && m_edits.last().type == type) {
+        m_edits.last().count += count;
+    } else {
+        Edit edit = {type, count};
+        m_edits << edit;
+    }
+}
+
+bool LineDiff::compare(const QVector<int> &ids1, const QVector<int> &ids2)
+{
+    m_edits.resize(0);
+
+    // common prefix and suffix do not need the Myers algorithm
+    const int *a = ids1.constData();
+    const int *b = ids2.constData();
+    int n = ids1.size();
+    int m = ids2.size();
+    int prefix = 0;
+    while (prefix < n && prefix < m && a[prefix] == b[prefix])
+        ++prefix;
+    int suffix = 0;
+    while (suffix < n - prefix && suffix < m - prefix &&
+           a[n - 1 - suffix] == b[m - 1 - suffix])
+        ++suffix;
+    a += prefix;
+    b += prefix;
+    n -= prefix + suffix;
+    m -= prefix + suffix;
+
+    addEdit(Keep, prefix);
+    if (n == 0 || m == 0) {
+        addEdit(Remove, n);
+        addEdit(Add, m);
+        addEdit(Keep, suffix);
+        return true;
+    }
+
+    // forward pass: the furthest reaching path of each diagonal k is
+    // kept in front[k + offset] and saved into the trace after each step
+    const int limit = qMin(n + m, MaxEditDistance);
+    const int offset = limit + 1;
+    m_front.fill(0, 2 * limit + 3);
+    m_trace.resize(0);
+    int *front = m_front.data() + offset;
+    int distance = -1;
+    for (int d = 0; d <= limit && distance == -1; ++d) {
+        for (int k = -d; k <= d; k += 2) {
+            int x;
+            if (k == -d || (k != d && front[k - 1] < front[k + 1]))
+                x = front[k + 1];
+            else
+                x = front[k - 1] + 1;
+            int y = x - k;
+            while (x < n && y < m && a[x] == b[y]) {
+                ++x;
+                ++y;
+            }
+            front[k] = x;
+            if (x >= n && y >= m) {
+                distance = d;
+                break;
+            }
+        }
+        // the snapshot of step d starts at d * d in the trace
+        m_trace.resize(m_trace.size() + 2 * d + 1);
+        std::memcpy(m_trace.data() + d * d, front - d,
+                    (2 * d + 1) * sizeof(int));
+    }
+
+    if (distance == -1) {
+        addEdit(Remove, n);
+        addEdit(Add, m);
+        addEdit(Keep, suffix);
+        return false;
+    }
+
+    // backward pass: follow the snapshots from the end to the start and
+    // record the edits in reverse order
+    QVector<Edit> &edits = m_backtrace;
+    edits.resize(0);
+    int x = n;
+    int y = m;
+    for (int d = distance; d > 0; --d) {
+        const int *previous = m_trace.constData() + (d - 1) * (d - 1) + d - 1;
+        int k = x - y;
+        bool down = (k == -d ||
+                     (k != d && previous[k - 1] < previous[k + 1]));
+        int previousK = down ? k + 1 : k - 1;
+        int previousX = previous[previousK];
+        int previousY = previousX - previousK;
+        int snakeX = down ? previousX : previousX + 1;
+        if (x > snakeX) {
+            Edit keep = {Keep, x - snakeX};
+            edits << keep;
+        }
+        Edit edit = {down ? Add : Remove, 1};
+        edits << edit;
+        x = previousX;
+        y = previousY;
+    }
+    if (x > 0) {
+        Edit keep = {Keep, x};
+        edits << keep;
+    }
+
+    for (int i = edits.size() - 1; i >= 0; --i)
+        addEdit(edits[i].type, edits[i].count);
+    addEdit(Keep, suffix);
+    return true;
+}
+
+void LineDiff::refine(const QStringRef &removed, const QStringRef &added,
+                      QList<Diff> &diffs)
+{
+    if (removed.isEmpty() || added.isEmpty()) {
+        appendDiff(diffs, DELETE, removed);
+        appendDiff(diffs, INSERT, added);
+        return;
+    }
+
+    splitWords(removed, m_words1);
+    splitWords(added, m_words2);
+    m_ids.clear();
+    intern(m_words1, m_ids1);
+    intern(m_words2, m_ids2);
+    compare(m_ids1, m_ids2);
+
+    int i = 0;
+    int j = 0;
+    foreach (const Edit &edit, m_edits) {
+        switch (edit.type) {
+        case Keep:
+            appendDiff(diffs, EQUAL, span(m_words1, i, i + edit.count));
+            i += edit.count;
+            j += edit.count;
+            break;
+        case Remove:
+            appendDiff(diffs, DELETE, span(m_words1, i, i + edit.count));
+            i += edit.count;
+            break;
+        case Add:
+            appendDiff(diffs, INSERT, span(m_words2, j, j + edit.count));
+            j += edit.count;
+            break;
+        }
+    }
+}
+
+QList<Diff> LineDiff::diff(const QString &text1, const QString &text2)
+{
+    QList<Diff> diffs;
+    if (text1 == text2) {
+        appendDiff(diffs, EQUAL, QStringRef(&text1));
+        return diffs;
+    }
+
+    splitLines(text1, m_lines1);
+    splitLines(text2, m_lines2);
+    m_ids.clear();
+    intern(m_lines1, m_ids1);
+    intern(m_lines2, m_ids2);
+    compare(m_ids1, m_ids2);
+
+    // refine() compares words with the same buffers; each hunk is one
+    // substring of the texts, except where refined word by word
+    m_lineEdits.swap(m_edits);
+    diffs.reserve(2 * m_lineEdits.size() + 1);
+    int i = 0;
+    int j = 0;
+    int removedStart = 0;
+    int addedStart = 0;
+    foreach (const Edit &edit, m_lineEdits) {
+        switch (edit.type) {
+        case Keep:
+            refine(span(m_lines1, removedStart, i),
+                   span(m_lines2, addedStart, j), diffs);
+            appendDiff(diffs, EQUAL, span(m_lines1, i, i + edit.count));
+            i += edit.count;
+            j += edit.count;
+            removedStart = i;
+            addedStart = j;
+            break;
+        case Remove:
+            i += edit.count;
+            break;
+        case Add:
+            j += edit.count;
+            break;
+        }
+    }
+    refine(span(m_lines1, removedStart, i), span(m_lines2, addedStart, j),
+           diffs);
+    return diffs;
+}
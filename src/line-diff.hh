@@ -0,0 +1,95 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __LINE_DIFF_HH__
+#define __LINE_DIFF_HH__
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringRef>
+#include <QVector>
+
+#include "diff_match_patch/diff_match_patch.h"
+
+/*!
+  \file line-diff.hh
+  \class LineDiff
+  \brief LineDiff computes the differences between two versions of a song
+
+  Two versions of a song usually differ by a few lines. The lines of
+  both texts are first interned as integers and compared with the
+  Myers algorithm; only the lines that changed are then compared word
+  by word, so that the differences point at the modified words or
+  chords.
+
+  The differences are returned as a list of diff_match_patch::Diff so
+  that they can be displayed by a DiffView or turned into patches by
+  diff_match_patch::patch_make().
+
+  Lines and words are references into the compared texts, so that only
+  the text of each difference is allocated. The buffers of the algorithm
+  are kept between calls: a LineDiff is meant to be reused for
+  successive comparisons. A LineDiff is reentrant but not thread-safe.
+
+  \code
+  LineDiff lineDiff;
+  QList<Diff> diffs = lineDiff.diff(source, target);
+  \endcode
+*/
+class LineDiff
+{
+public:
+    /// Constructor.
+    LineDiff();
+
+    /*!
+    Returns the differences from \a text1 to \a text2.
+  */
+    QList<Diff> diff(const QString &text1, const QString &text2);
+
+private:
+    enum EditType { Keep, Remove, Add };
+
+    struct Edit
+    {
+        EditType type;
+        int count;
+    };
+
+    void intern(const QVector<QStringRef> &tokens, QVector<int> &ids);
+    bool compare(const QVector<int> &ids1, const QVector<int> &ids2);
+    void addEdit(EditType type, int count);
+    void refine(const QStringRef &removed, const QStringRef &added,
+                QList<Diff> &diffs);
+
+    QHash<QStringRef, int> m_ids;
+    QVector<QStringRef> m_lines1;
+    QVector<QStringRef> m_lines2;
+    QVector<QStringRef> m_words1;
+    QVector<QStringRef> m_words2;
+    QVector<int> m_ids1;
+    QVector<int> m_ids2;
+    QVector<int> m_front;
+    QVector<int> m_trace;
+    QVector<Edit> m_edits;
+    QVector<Edit> m_lineEdits;
+    QVector<Edit> m_backtrace;
+};
+
+#endif // __LINE_DIFF_HH__
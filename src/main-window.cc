@@ -34,9 +34,11 @@
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QInputDialog>
 #include <QPlainTextEdit>
 #include <QSettings>
 #include <QStatusBar>
+#include <QTimer>
 #include <QToolBar>
 #include <QtConcurrent>
 #include <QFuture>
@@ -46,8 +48,10 @@
 #include "library-view.hh"
 #include "songbook.hh"
 #include "song-editor.hh"
+#include "song-validator.hh"
 #include "song-highlighter.hh"
-#include "logs-highlighter.hh"
+#include "build-log.hh"
+#include "build-log-view.hh"
 #include "filter-lineedit.hh"
 #include "song-sort-filter-proxy-model.hh"
 #include "tab-widget.hh"
@@ -56,6 +60,9 @@
 #include "preferences.hh"
 #include "progress-bar.hh"
 #include "import-dialog.hh"
+#include "library-search-dialog.hh"
+#include "chord-transposer.hh"
+#include "recovery-journal.hh"
 #include "patacrep.hh"
 
 #include <QDebug>
@@ -63,6 +70,9 @@
 
 namespace // anonymous namespace
 {
+// number of song editors whose widgets are kept while they are hidden
+const int LoadedEditorCount = 4;
+
 bool checkPdfLaTeX()
 {
     QString message;
@@ -210,20 +220,25 @@ MainWindow::MainWindow(QWidget *parent)
     , m_updateAvailable(0)
     , m_infoSelection(new QLabel(this))
     , m_log(new QDockWidget(tr("LaTeX compilation logs")))
+    , m_buildLog(new BuildLogModel(this))
     , m_isToolBarDisplayed(true)
     , m_isStatusBarDisplayed(true)
     , m_currentToolBar(0)
     , patacrep(new Patacrep(this))
     , m_songHighlighter(0)
+    , m_transposeWatcher(0)
 {
     setWindowTitle("Patagui");
     setWindowIcon(QIcon(":/icons/songbook/256x256/patagui.png"));
     Library::instance()->setParent(this);
+    RecoveryJournal::instance()->setParent(this);
 
     connect(library(), SIGNAL(directoryChanged(const QDir &)),
             SLOT(noDataNotification(const QDir &)));
     connect(library(), SIGNAL(noDirectory()),
             SLOT(noSongbookDirectoryNotification()));
+    connect(library(), SIGNAL(directoryChanged(const QDir &)), patacrep,
+            SLOT(invalidateSongbook()));
 
     connect(m_songbook, SIGNAL(wasModified(bool)),
             SLOT(setWindowModified(bool)));
@@ -245,9 +260,10 @@ MainWindow::MainWindow(QWidget *parent)
     connect(library(), SIGNAL(wasModified()), m_view, SLOT(update()));
 
     // compilation log
-    QPlainTextEdit *logs = new QPlainTextEdit;
-    logs->setReadOnly(true);
-    Q_UNUSED(new LogsHighlighter(logs->document()));
+    BuildLogView *logs = new BuildLogView;
+    logs->setModel(m_buildLog);
+    connect(logs, SIGNAL(fileActivated(const QString &, int)),
+            SLOT(showLogLocation(const QString &, int)));
     m_log->setWidget(logs);
     addDockWidget(Qt::BottomDockWidgetArea, m_log);
 
@@ -279,8 +295,11 @@ MainWindow::MainWindow(QWidget *parent)
             SLOT(clearMessage()));
     connect(patacrep, SIGNAL(message(const QString &, int)), statusBar(),
             SLOT(showMessage(const QString &, int)));
-    connect(patacrep, SIGNAL(message(const QString &, int)), log()->widget(),
-            SLOT(appendPlainText(const QString &)));
+    connect(patacrep, SIGNAL(message(const QString &, int)), m_buildLog,
+            SLOT(appendMessage(const QString &)));
+    connect(patacrep, SIGNAL(output(const QString &)), m_buildLog,
+            SLOT(appendOutput(const QString &)));
+    connect(patacrep, SIGNAL(finished()), m_buildLog, SLOT(flush()));
     connect(patacrep, SIGNAL(finished()), progressBar(), SLOT(hide()));
     //    connect(patacrep, SIGNAL(error(QProcess::ProcessError)),
     //            this, SLOT(buildError(QProcess::ProcessError)));
@@ -291,6 +310,9 @@ MainWindow::MainWindow(QWidget *parent)
     QDir().mkpath(_cachePath);
 
     readSettings(true);
+
+    // restore the songs that were not saved during the previous session
+    QTimer::singleShot(0, this, SLOT(recoverSongs()));
 }
 
 MainWindow::~MainWindow()
@@ -375,6 +397,22 @@ void MainWindow::createActions()
     connect(m_importSongsAct, SIGNAL(triggered()), this,
             SLOT(importSongsDialog()));
 
+    m_librarySearchAct = new QAction(tr("&Search and Replace..."), this);
+    m_librarySearchAct->setIcon(QIcon::fromTheme(
+        "edit-find-replace",
+        QIcon(":/icons/tango/32x32/actions/edit-find-replace.png")));
+    m_librarySearchAct->setShortcut(
+        QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_F));
+    m_librarySearchAct->setStatusTip(
+        tr("Find and replace a text in all the songs of the library"));
+    connect(m_librarySearchAct, SIGNAL(triggered()), this,
+            SLOT(librarySearchDialog()));
+
+    m_transposeAct = new QAction(tr("&Transpose Songs..."), this);
+    m_transposeAct->setStatusTip(
+        tr("Rewrite the chords of the selected songs in another key"));
+    connect(m_transposeAct, SIGNAL(triggered()), this, SLOT(transposeSongs()));
+
     m_preferencesAct = new QAction(tr("&Preferences"), this);
     m_preferencesAct->setIcon(
         QIcon::fromTheme("document-properties",
@@ -526,6 +564,13 @@ bool MainWindow::isStatusBarDisplayed()
 
 void MainWindow::closeEvent(QCloseEvent *event)
 {
+    // keep the last modifications of the songs that are still open
+    for (int i = 0; i < m_mainWidget->count(); ++i)
+        if (SongEditor *editor =
+                qobject_cast<SongEditor *>(m_mainWidget->widget(i)))
+            editor->recordChanges();
+    RecoveryJournal::instance()->flush();
+
     writeSettings();
     event->accept();
 }
@@ -552,6 +597,9 @@ void MainWindow::createMenus()
     libraryMenu->addAction(m_importSongsAct);
     libraryMenu->addAction(m_setupDatadirAct);
     libraryMenu->addSeparator();
+    libraryMenu->addAction(m_librarySearchAct);
+    libraryMenu->addAction(m_transposeAct);
+    libraryMenu->addSeparator();
     libraryMenu->addAction(m_selectAllAct);
     libraryMenu->addAction(m_unselectAllAct);
     libraryMenu->addAction(m_invertSelectionAct);
@@ -747,12 +795,49 @@ const QString MainWindow::libraryPath()
     return library()->directory().canonicalPath();
 }
 
+bool MainWindow::validateSongbook()
+{
+    QStringList paths;
+    QDir songsDirectory(QString("%1/songs").arg(libraryPath()));
+    foreach (const QString &song, songbook()->songs())
+        paths << songsDirectory.absoluteFilePath(song);
+
+    QList<SongIssue> issues = SongValidator::validateSongs(paths);
+    if (issues.isEmpty())
+        return true;
+
+    QList<LogRecord> records;
+    foreach (const SongIssue &issue, issues) {
+        LogRecord record;
+        record.type = LogRecord::Error;
+        record.message = QString("%1: %2")
+                             .arg(songsDirectory.relativeFilePath(issue.path))
+                             .arg(issue.message);
+        record.file = issue.path;
+        record.line = issue.line;
+        records << record;
+    }
+    m_buildLog->appendRecords(records);
+    m_log->setVisible(true);
+    statusBar()->showMessage(
+        tr("The songbook was not built: %n issue(s) found in the songs", "",
+           issues.size()));
+    return false;
+}
+
 void MainWindow::make()
 {
     if (!future.isRunning()) {
+        // broken songs are reported without waiting for LaTeX
+        if (!validateSongbook())
+            return;
+
         patacrep->setWorkingDirectory(libraryPath());
         patacrep->setSongbook(songbook());
-        patacrep->addDatadir(songbook()->library()->directory().absolutePath());
+        patacrep->setDatadirs(QStringList() << songbook()
+                                                   ->library()
+                                                   ->directory()
+                                                   .absolutePath());
         // To change properly, make access to datadir in songbook class
 
         future = QtConcurrent::run(patacrep, &Patacrep::buildSongbook);
@@ -822,13 +907,10 @@ void MainWindow::songEditor(const QModelIndex &index)
 void MainWindow::songEditor(const QString &path)
 {
     // if an editor already corresponds to path, focus on it
-    for (int i = 0; i < m_mainWidget->count(); ++i)
-        if (SongEditor *editor =
-                qobject_cast<SongEditor *>(m_mainWidget->widget(i)))
-            if (editor->song().path == path) {
-                m_mainWidget->setCurrentIndex(i);
-                return;
-            }
+    if (SongEditor *editor = m_songEditors.value(path)) {
+        m_mainWidget->setCurrentWidget(editor);
+        return;
+    }
 
     // create a new editor
     SongEditor *editor = new SongEditor(this);
@@ -841,25 +923,221 @@ void MainWindow::songEditor(const QString &path)
         editor->setSong(library()->getSong(path));
     }
 
+    addSongEditor(editor);
+}
+
+void MainWindow::addSongEditor(SongEditor *editor)
+{
+    m_songEditors.insert(editor->song().path, editor);
+    connect(editor, SIGNAL(saved(const QString &)),
+            SLOT(songEditorSaved(const QString &)));
+    connect(editor, SIGNAL(destroyed(QObject *)),
+            SLOT(songEditorDestroyed(QObject *)));
+
     // create the corresponding tab
     connect(editor, SIGNAL(labelChanged(const QString &)), m_mainWidget,
             SLOT(changeTabText(const QString &)));
     m_mainWidget->addTab(editor);
 }
 
+QStringList MainWindow::modifiedSongs() const
+{
+    QStringList paths;
+    QHash<QString, SongEditor *>::const_iterator it;
+    for (it = m_songEditors.constBegin(); it != m_songEditors.constEnd(); ++it)
+        if (!it.key().isEmpty() && it.value()->isModified())
+            paths << it.key();
+    return paths;
+}
+
+void MainWindow::unregisterSongEditor(QObject *editor)
+{
+    QHash<QString, SongEditor *>::iterator it = m_songEditors.begin();
+    while (it != m_songEditors.end()) {
+        if (static_cast<QObject *>(it.value()) == editor)
+            it = m_songEditors.erase(it);
+        else
+            ++it;
+    }
+}
+
+void MainWindow::songEditorSaved(const QString &path)
+{
+    // the path of a new song is known once it is saved
+    SongEditor *editor = qobject_cast<SongEditor *>(sender());
+    unregisterSongEditor(editor);
+    m_songEditors.insert(path, editor);
+}
+
+void MainWindow::songEditorDestroyed(QObject *object)
+{
+    unregisterSongEditor(object);
+    m_loadedEditors.removeAll(static_cast<SongEditor *>(object));
+}
+
+void MainWindow::songEditorDisplayed(SongEditor *editor)
+{
+    // only the widgets of the last displayed editors are kept
+    m_loadedEditors.removeAll(editor);
+    m_loadedEditors.prepend(editor);
+    while (m_loadedEditors.size() > LoadedEditorCount)
+        m_loadedEditors.takeLast()->unloadWidgets();
+}
+
 void MainWindow::newSong()
 {
     songEditor(QString());
 }
 
+void MainWindow::recoverSongs()
+{
+    QList<RecoveredSong> songs = RecoveryJournal::instance()->recover();
+    if (songs.isEmpty())
+        return;
+
+    QStringList names;
+    foreach (const RecoveredSong &recoveredSong, songs)
+        names << (recoveredSong.path.isEmpty() ? tr("New song")
+                                               : recoveredSong.path);
+
+    QMessageBox::StandardButton answer = QMessageBox::question(
+        this, tr("Recover unsaved songs"),
+        tr("The following songs were modified but not saved when "
+           "Patagui was closed:\n%1\n"
+           "Do you want to restore their modifications?")
+            .arg(names.join("\n")),
+        QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+    if (answer == QMessageBox::Yes) {
+        foreach (const RecoveredSong &recoveredSong, songs) {
+            SongEditor *editor = new SongEditor(this);
+            editor->setSong(
+                Song::fromString(recoveredSong.text, recoveredSong.path));
+            editor->setNewSong(recoveredSong.path.isEmpty());
+            editor->setModified(true);
+            editor->recordChanges();
+            addSongEditor(editor);
+        }
+    }
+
+    // the restored songs are now recorded in the journal of this session
+    RecoveryJournal::instance()->removeRecoveredJournals();
+}
+
 void MainWindow::importSongsDialog()
 {
     ImportDialog *dialog = new ImportDialog(this);
     connect(dialog, SIGNAL(songsReadyToBeImported(const QStringList &)), this,
             SLOT(importSongs(const QStringList &)));
+    connect(dialog, SIGNAL(songsAnalyzed(const QList<ImportItem> &)), this,
+            SLOT(importSongs(const QList<ImportItem> &)));
     dialog->exec();
 }
 
+void MainWindow::librarySearchDialog()
+{
+    LibrarySearchDialog *dialog = new LibrarySearchDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    connect(dialog, SIGNAL(songActivated(const QString &, int)),
+            SLOT(showLogLocation(const QString &, int)));
+    connect(dialog, SIGNAL(songsReplaced(const QStringList &)),
+            SLOT(reloadSongEditors(const QStringList &)));
+    dialog->show();
+}
+
+void MainWindow::transposeSongs()
+{
+    if (m_transposeWatcher && m_transposeWatcher->isRunning())
+        return;
+
+    QStringList paths;
+    foreach (const QModelIndex &index, selectionModel()->selectedRows())
+        paths << view()->model()->data(index, Library::PathRole).toString();
+    if (paths.isEmpty()) {
+        statusBar()->showMessage(tr("Please select the songs to transpose."));
+        return;
+    }
+
+    // songs with unsaved changes are not rewritten
+    QStringList skipped;
+    foreach (const QString &path, modifiedSongs())
+        if (paths.removeAll(path) > 0)
+            skipped << path;
+    if (!skipped.isEmpty())
+        QMessageBox::warning(this, tr("Transpose Songs"),
+                             tr("The following songs have unsaved changes "
+                                "and will not be transposed:\n%1")
+                                 .arg(skipped.join("\n")));
+    if (paths.isEmpty())
+        return;
+
+    bool ok = false;
+    int semitones = QInputDialog::getInt(
+        this, tr("Transpose Songs"),
+        tr("Transpose the chords of %1 song(s) by (semitones):")
+            .arg(paths.size()),
+        0, -11, 11, 1, &ok);
+    if (!ok || semitones == 0)
+        return;
+
+    if (!m_transposeWatcher) {
+        m_transposeWatcher = new QFutureWatcher<Transposition>(this);
+        connect(m_transposeWatcher, SIGNAL(finished()),
+                SLOT(songsTransposed()));
+    }
+    statusBar()->showMessage(tr("Transposing %1 song(s)...").arg(paths.size()));
+    m_transposeWatcher->setFuture(
+        ChordTransposer(semitones).transposeSongs(paths));
+}
+
+void MainWindow::songsTransposed()
+{
+    QStringList transposed;
+    QStringList errors;
+    int removedDiagrams = 0;
+    QList<Transposition> results = m_transposeWatcher->future().results();
+    foreach (const Transposition &result, results) {
+        if (!result.error.isEmpty())
+            errors << QString("%1: %2").arg(result.path).arg(result.error);
+        else if (result.chords > 0 || result.diagrams > 0 ||
+                 result.removedDiagrams > 0)
+            transposed << result.path;
+        removedDiagrams += result.removedDiagrams;
+    }
+
+    library()->reloadSongs(transposed);
+    reloadSongEditors(transposed);
+
+    QString message = tr("%1 song(s) transposed").arg(transposed.size());
+    if (removedDiagrams > 0)
+        message += tr(", %1 chord diagram(s) removed (unknown fingering)")
+                       .arg(removedDiagrams);
+    statusBar()->showMessage(message);
+
+    if (!errors.isEmpty())
+        QMessageBox::warning(this, tr("Transpose Songs"),
+                             tr("The following songs could not be "
+                                "transposed:\n%1")
+                                 .arg(errors.join("\n")));
+}
+
+void MainWindow::reloadSongEditors(const QStringList &paths)
+{
+    // songs with unsaved changes are skipped before being rewritten, but
+    // an editor may have been modified while the songs were rewritten
+    foreach (const QString &path, paths) {
+        SongEditor *editor = m_songEditors.value(path);
+        if (!editor)
+            continue;
+
+        if (editor->isModified())
+            statusBar()->showMessage(
+                tr("The song %1 was modified on disk while being edited")
+                    .arg(editor->song().path));
+        else
+            editor->setSong(library()->getSong(editor->song().path));
+    }
+}
+
 void MainWindow::setupDatadirDialog()
 {
     QString datadir = QFileDialog::getExistingDirectory(
@@ -890,6 +1168,11 @@ void MainWindow::importSongs(const QStringList &songs)
     library()->importSongs(songs);
 }
 
+void MainWindow::importSongs(const QList<ImportItem> &items)
+{
+    library()->importSongs(items);
+}
+
 void MainWindow::deleteSong()
 {
     if (!selectionModel()->hasSelection()) {
@@ -940,6 +1223,9 @@ void MainWindow::changeTab(int index)
             m_songHighlighter = new SongHighlighter;
         }
         editor->setHighlighter(m_songHighlighter);
+
+        if (SongEditor *songEditor = qobject_cast<SongEditor *>(editor))
+            songEditorDisplayed(songEditor);
     } else {
         editor = m_voidEditor;
         switchToolBar(m_libraryToolBar);
@@ -953,6 +1239,29 @@ QDockWidget *MainWindow::log() const
     return m_log;
 }
 
+void MainWindow::showLogLocation(const QString &file, int line)
+{
+    // LaTeX reports files relatively to the library directory
+    QString path = file;
+    if (QFileInfo(file).isRelative()) {
+        path = QDir(libraryPath()).absoluteFilePath(file);
+        if (!QFile(path).exists())
+            path = QDir(QString("%1/songs").arg(libraryPath()))
+                       .absoluteFilePath(file);
+    }
+    path = QDir::cleanPath(path);
+
+    if (!QFile(path).exists()) {
+        statusBar()->showMessage(tr("Unable to find the file: %1").arg(file));
+        return;
+    }
+
+    songEditor(path);
+    if (SongEditor *editor =
+            qobject_cast<SongEditor *>(m_mainWidget->currentWidget()))
+        editor->goToLine(line);
+}
+
 void MainWindow::updateNotification(const QString &path)
 {
     if (!m_updateAvailable) {
@@ -24,13 +24,18 @@
 
 #include <QModelIndex>
 #include <QDir>
+#include <QHash>
 #include <QFuture>
+#include <QFutureWatcher>
+
+#include "import-analyzer.hh"
 
 class Songbook;
 class Library;
 class LibraryView;
 class TabWidget;
 class Editor;
+class SongEditor;
 class Label;
 class TabWidget;
 class FilterLineEdit;
@@ -38,6 +43,8 @@ class Notification;
 class ProgressBar;
 class Patacrep;
 class SongHighlighter;
+class BuildLogModel;
+struct Transposition;
 
 class QPlainTextEdit;
 class QItemSelectionModel;
@@ -91,6 +98,13 @@ public:
   */
     Library *library() const;
 
+    /*!
+    Returns the paths of the songs whose editors have unsaved changes.
+    Such songs must not be rewritten on disk, since saving the editor
+    would revert the change.
+  */
+    QStringList modifiedSongs() const;
+
     /*!
     Returns the current songbook.
   */
@@ -150,8 +164,16 @@ private slots:
 
     // library
     void newSong();
+    void recoverSongs();
     void importSongs(const QStringList &songs);
+    void importSongs(const QList<ImportItem> &items);
     void importSongsDialog();
+    void librarySearchDialog();
+    void transposeSongs();
+    void songsTransposed();
+    void reloadSongEditors(const QStringList &paths);
+    void songEditorSaved(const QString &path);
+    void songEditorDestroyed(QObject *object);
     void middleClicked(const QModelIndex &index = QModelIndex());
     void songEditor(const QModelIndex &index = QModelIndex());
     void deleteSong();
@@ -179,6 +201,9 @@ private slots:
 
     void cancelProcess();
 
+    /// Opens the song \a file at \a line from the compilation logs.
+    void showLogLocation(const QString &file, int line);
+
 private:
     void readSettings(bool firstLaunch = false);
     void writeSettings();
@@ -187,9 +212,15 @@ private:
     void createMenus();
     void createToolBar();
 
+    void addSongEditor(SongEditor *editor);
+    void unregisterSongEditor(QObject *editor);
+    void songEditorDisplayed(SongEditor *editor);
+
     bool isToolBarDisplayed();
     bool isStatusBarDisplayed();
 
+    bool validateSongbook();
+
     QItemSelectionModel *selectionModel();
 
     // Models and views
@@ -210,6 +241,7 @@ private:
     QLabel *m_infoSelection;
     FilterLineEdit *m_filterLineEdit;
     QDockWidget *m_log;
+    BuildLogModel *m_buildLog;
 
     // Settings
     QString m_workingPath;
@@ -241,6 +273,8 @@ private:
     // Library action
     QAction *m_newSongAct;
     QAction *m_importSongsAct;
+    QAction *m_librarySearchAct;
+    QAction *m_transposeAct;
     QAction *m_setupDatadirAct;
     QAction *m_selectAllAct;
     QAction *m_unselectAllAct;
@@ -251,9 +285,18 @@ private:
     Editor *m_voidEditor;
     SongHighlighter *m_songHighlighter;
 
+    // open song editors by path of their song
+    QHash<QString, SongEditor *> m_songEditors;
+
+    // most recently displayed song editors, whose widgets are loaded
+    QList<SongEditor *> m_loadedEditors;
+
     // Building Process
     QFuture<void> future;
 
+    // Batch transposition of songs
+    QFutureWatcher<Transposition> *m_transposeWatcher;
+
 public:
     const static QString _cachePath;
 };
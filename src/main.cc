@@ -43,22 +43,42 @@
 #include "config.hh"
 #include "main-window.hh"
 #include "library.hh"
+#include "batch-builder.hh"
 
 #ifdef USE_SPARKLE
 #include "../macos_specific/sparkle/src/CocoaInitializer.h"
 #include "../macos_specific/sparkle/src/SparkleAutoUpdater.h"
 #endif
 
+namespace // anonymous namespace
+{
+void setApplicationInformation()
+{
+    QCoreApplication::setOrganizationName("Patacrep");
+    QCoreApplication::setOrganizationDomain("patacrep.com");
+    QCoreApplication::setApplicationName(PATAGUI_APPLICATION_NAME);
+    QCoreApplication::setApplicationVersion(PATAGUI_VERSION);
+}
+}
+
 /// Main routine of the application
 int main(int argc, char *argv[])
 {
+    // Headless builds neither construct widgets nor require a display
+    if (BatchBuilder::isBatchMode(argc, argv)) {
+        QCoreApplication application(argc, argv);
+        setApplicationInformation();
+        QTextCodec::setCodecForLocale(QTextCodec::codecForName("UTF-8"));
+
+        BatchBuilder builder;
+        if (!builder.parseArguments(QCoreApplication::arguments()))
+            return 2;
+        return builder.exec();
+    }
+
     // MacOSX needs to instanciate the application first to get the path
     QApplication application(argc, argv);
-
-    QApplication::setOrganizationName("Patacrep");
-    QApplication::setOrganizationDomain("patacrep.com");
-    QApplication::setApplicationName(PATAGUI_APPLICATION_NAME);
-    QApplication::setApplicationVersion(PATAGUI_VERSION);
+    setApplicationInformation();
 
     // Load the application ressources (icons, ...)
     Q_INIT_RESOURCE(songbook);
@@ -129,7 +149,8 @@ int main(int argc, char *argv[])
             << "-h, --help"
             << "    "
             << "--version"
-            << " " << QApplication::applicationVersion() << endl;
+            << " " << QApplication::applicationVersion() << endl
+            << BatchBuilder::usage();
         return 0;
     } else if (versionFlag) {
         QTextStream out(stdout);
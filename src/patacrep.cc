@@ -2,7 +2,11 @@
 
 #include <QDebug>
 
-Patacrep::Patacrep(QObject *parent) : QObject(parent)
+Patacrep::Patacrep(QObject *parent)
+    : QObject(parent)
+    , songbook(0)
+    , songbookOutdated(false)
+    , lastBuildSucceeded(false)
 {
     // Setup Python interpreter
     PythonQt::init(PythonQt::RedirectStdOut);
@@ -16,6 +20,7 @@ Patacrep::Patacrep(QObject *parent) : QObject(parent)
     connect(this, SIGNAL(message(QString, int)), SLOT(debugOutput(QString)));
     // Import Python file containing all necessary functions and imports
     pythonModule.evalFile(":/python_scripts/songbook.py");
+    pythonModule.addObject("CPPprocess", this);
     buildingSongbook = false;
 }
 
@@ -23,24 +28,18 @@ Patacrep::~Patacrep() {}
 
 void Patacrep::stdOut(QString string)
 {
-    // Hack to simplify output
-    if (!string.simplified().isEmpty()) {
-        emit message("PyOut: " + string.simplified(), 0);
-    }
+    // Raw output, split into lines by the log parser
+    emit(output(string));
 }
 
 void Patacrep::stdErr(QString string)
 {
-    // Hack to simplify output
-    if (!string.simplified().isEmpty()) {
-        emit message("PyErr: " + string.simplified(), 0);
-        // qWarning() << string.simplified().toUtf8().constData();
-    }
+    emit(output(string));
 }
 
 void Patacrep::setWorkingDirectory(const QString &dir)
 {
-    pythonModule.evalScript("os.chdir('" + dir + "')");
+    pythonModule.call("setWorkingDirectory", QVariantList() << dir);
 }
 
 bool Patacrep::testPython()
@@ -65,6 +64,12 @@ void Patacrep::setSongbook(Songbook *value)
     songbook = value;
 }
 
+void Patacrep::setSongbookFile(const QString &filename)
+{
+    songbook = 0;
+    songbookFile = filename;
+}
+
 QStringList Patacrep::getDatadirs() const
 {
     return datadirs;
@@ -73,15 +78,29 @@ QStringList Patacrep::getDatadirs() const
 void Patacrep::buildSongbook()
 {
     buildingSongbook = true;
+    lastBuildSucceeded = false;
     emit(aboutToStart());
-    if (!songbook->filename().isEmpty()) {
-        // Expose Songbook to python
-        pythonModule.addObject("songbook", songbook);
-        pythonModule.addObject("CPPprocess", this);
-        pythonModule.evalScript("setupSongbook(songbook.filename,'" +
-                                datadirs.first() + "')");
-        pythonModule.evalScript("build(['clean', 'tex', 'pdf', 'sbx', 'pdf', 'clean'])");
-//        pythonModule.removeVariable("songbook");
+    QString filename = songbook ? songbook->filename() : songbookFile;
+    if (!filename.isEmpty() && !datadirs.isEmpty()) {
+        // the songbook builder of the previous build is reused as long
+        // as the songbook, its datadir and its templates are unchanged
+        if (songbookOutdated) {
+            songbookOutdated = false;
+            pythonModule.call("invalidateSongbook");
+        }
+        pythonModule.call("setupSongbook", QVariantList() << filename
+                                                          << datadirs.first());
+        QStringList steps;
+        steps << "clean"
+              << "tex"
+              << "pdf"
+              << "sbx"
+              << "pdf"
+              << "clean";
+        // the result is invalid when the build raised an exception
+        lastBuildSucceeded =
+            pythonModule.call("build", QVariantList() << QVariant(steps))
+                .toBool();
         emit(message("Finished Execution", 0));
         emit(finished());
     } else {
@@ -90,6 +109,11 @@ void Patacrep::buildSongbook()
     }
 }
 
+bool Patacrep::buildSucceeded() const
+{
+    return lastBuildSucceeded;
+}
+
 void Patacrep::debugOutput(QString string)
 {
     qDebug() << string;
@@ -102,7 +126,7 @@ bool Patacrep::getBuildState() const
 
 void Patacrep::setDatadirs(const QStringList &datadirs)
 {
-    Patacrep::datadirs.append(datadirs);
+    Patacrep::datadirs = datadirs;
 }
 
 void Patacrep::addDatadir(const QString &datadir)
@@ -110,6 +134,11 @@ void Patacrep::addDatadir(const QString &datadir)
     datadirs.append(datadir);
 }
 
+void Patacrep::invalidateSongbook()
+{
+    songbookOutdated = true;
+}
+
 void Patacrep::stopBuilding()
 {
     buildingSongbook = false;
@@ -43,10 +43,23 @@ public:
      */
     void setSongbook(Songbook *value);
 
+    /*!
+     * \brief setSongbookFile
+     * \param filename the .sb file to build when no Songbook is set
+     */
+    void setSongbookFile(const QString &filename);
+
+    /*!
+     * \brief buildSucceeded
+     * \return true if all the steps of the last build succeeded
+     */
+    bool buildSucceeded() const;
+
 signals:
     void aboutToStart();
     void finished();
     void message(const QString &message, int timeout);
+    void output(const QString &text);
 
 public slots:
 
@@ -58,6 +71,11 @@ public slots:
 
     void stopBuilding();
 
+    /*! Forces the songbook to be loaded again by the next build, for
+     *  instance when the library changes
+     */
+    void invalidateSongbook();
+
     void buildSongbook();
 
     void stdOut(QString string);
@@ -69,8 +87,11 @@ public slots:
 private:
     PythonQtObjectPtr pythonModule;
     Songbook *songbook;
+    QString songbookFile;
     QStringList datadirs;
     bool buildingSongbook;
+    bool songbookOutdated;
+    bool lastBuildSucceeded;
 };
 
 #endif // PATACREP_H
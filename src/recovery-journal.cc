@@ -0,0 +1,321 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "recovery-journal.hh"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QLockFile>
+#include <QMap>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+#include <limits>
+
+#include "diff_match_patch/diff_match_patch.h"
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+// the journal is compacted into snapshots beyond this size (in bytes)
+const qint64 MaxJournalSize = 512 * 1024;
+
+const quint32 JournalMagic = 0x50474a31; // "PGJ1"
+
+// the lock of a running instance is never stale, whatever its age
+const int LockStaleTime = std::numeric_limits<int>::max();
+
+void writeRecord(QDataStream &stream, quint8 type, int entry,
+                 const QString &path, const QString &text)
+{
+    stream << type << qint32(entry) << path << text;
+}
+}
+
+RecoveryJournal::RecoveryJournal()
+    : QObject()
+    , m_filename()
+    , m_lockFile(0)
+    , m_recoveredSongs()
+    , m_recoveredJournals()
+    , m_recoveredLocks()
+    , m_lastEntry(0)
+    , m_recordedEntries()
+    , m_mutex()
+    , m_pendingRecords()
+    , m_isWriting(false)
+    , m_writer()
+    , m_paths()
+    , m_texts()
+    , m_lineDiff()
+{
+    QDir directory(
+        QStandardPaths::writableLocation(QStandardPaths::DataLocation));
+    directory.mkpath(".");
+
+    // the journals left by the sessions that did not end are kept until
+    // their songs are restored or dropped, the journal of a running
+    // instance is locked
+    QStringList journals = directory.entryList(
+        QStringList() << "recovery*.journal", QDir::Files, QDir::Name);
+    foreach (const QString &journal, journals) {
+        QString filename = directory.absoluteFilePath(journal);
+        QLockFile *lockFile = new QLockFile(filename + ".lock");
+        lockFile->setStaleLockTime(LockStaleTime);
+        if (!lockFile->tryLock(0)) {
+            delete lockFile;
+            continue;
+        }
+
+        QList<RecoveredSong> songs = replay(filename);
+        if (songs.isEmpty()) {
+            QFile::remove(filename);
+            delete lockFile;
+            continue;
+        }
+        m_recoveredSongs << songs;
+        m_recoveredJournals << filename;
+        m_recoveredLocks << lockFile;
+    }
+
+    // each instance writes its own journal
+    m_filename = directory.absoluteFilePath(
+        QString("recovery-%1-%2.journal")
+            .arg(QCoreApplication::applicationPid())
+            .arg(QDateTime::currentMSecsSinceEpoch()));
+    m_lockFile = new QLockFile(m_filename + ".lock");
+    m_lockFile->setStaleLockTime(LockStaleTime);
+    if (!m_lockFile->tryLock(0))
+        qWarning() << "RecoveryJournal: unable to lock" << m_filename;
+}
+
+RecoveryJournal::~RecoveryJournal()
+{
+    flush();
+
+    // nothing to recover: every entry was saved or discarded
+    if (m_texts.isEmpty())
+        QFile::remove(m_filename);
+    delete m_lockFile;
+    qDeleteAll(m_recoveredLocks);
+}
+
+QList<RecoveredSong> RecoveryJournal::replay(const QString &filename) const
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return QList<RecoveredSong>();
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic;
+    stream >> magic;
+    if (magic != JournalMagic)
+        return QList<RecoveredSong>();
+
+    diff_match_patch dmp;
+    QMap<int, RecoveredSong> songs;
+    while (!stream.atEnd()) {
+        quint8 type;
+        qint32 entry;
+        QString path;
+        QString text;
+        stream >> type >> entry >> path >> text;
+
+        // the last record is truncated if the application crashed
+        // while writing it
+        if (stream.status() != QDataStream::Ok)
+            break;
+
+        switch (type) {
+        case SnapshotRecord:
+            songs[entry].path = path;
+            songs[entry].text = text;
+            break;
+        case PatchRecord:
+            if (songs.contains(entry)) {
+                QList<Patch> patches = dmp.patch_fromText(text);
+                songs[entry].path = path;
+                songs[entry].text =
+                    dmp.patch_apply(patches, songs[entry].text).first;
+            }
+            break;
+        case DiscardRecord:
+            songs.remove(entry);
+            break;
+        }
+    }
+    return songs.values();
+}
+
+QList<RecoveredSong> RecoveryJournal::recover()
+{
+    QList<RecoveredSong> songs = m_recoveredSongs;
+    m_recoveredSongs.clear();
+    return songs;
+}
+
+void RecoveryJournal::removeRecoveredJournals()
+{
+    // the restored songs must be written in the journal of this session
+    flush();
+
+    foreach (const QString &filename, m_recoveredJournals)
+        QFile::remove(filename);
+    m_recoveredJournals.clear();
+    qDeleteAll(m_recoveredLocks);
+    m_recoveredLocks.clear();
+}
+
+int RecoveryJournal::createEntry()
+{
+    return ++m_lastEntry;
+}
+
+void RecoveryJournal::record(int entry, const QString &path,
+                             const QString &text)
+{
+    m_recordedEntries.insert(entry);
+
+    // the writer turns the snapshot into a patch whenever possible
+    Record record = {SnapshotRecord, entry, path, text};
+    enqueue(record);
+}
+
+void RecoveryJournal::discard(int entry)
+{
+    if (!m_recordedEntries.remove(entry))
+        return;
+
+    Record record = {DiscardRecord, entry, QString(), QString()};
+    enqueue(record);
+}
+
+void RecoveryJournal::enqueue(const Record &record)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pendingRecords << record;
+    if (!m_isWriting) {
+        m_isWriting = true;
+        m_writer = QtConcurrent::run(this, &RecoveryJournal::writeRecords);
+    }
+}
+
+void RecoveryJournal::flush()
+{
+    forever {
+        {
+            QMutexLocker locker(&m_mutex);
+            if (!m_isWriting)
+                return;
+        }
+        m_writer.waitForFinished();
+    }
+}
+
+void RecoveryJournal::writeRecords()
+{
+    diff_match_patch dmp;
+
+    forever {
+        QList<Record> records;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_pendingRecords.isEmpty()) {
+                m_isWriting = false;
+                return;
+            }
+            records.swap(m_pendingRecords);
+        }
+
+        QFile file(m_filename);
+        bool isNew = !file.exists();
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            qWarning() << "RecoveryJournal: unable to write" << m_filename;
+            continue;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        if (isNew)
+            stream << JournalMagic;
+
+        foreach (const Record &record, records) {
+            if (record.type == DiscardRecord) {
+                if (m_texts.remove(record.entry))
+                    writeRecord(stream, DiscardRecord, record.entry, QString(),
+                                QString());
+                m_paths.remove(record.entry);
+                continue;
+            }
+
+            const QString &text = record.text;
+            if (m_texts.contains(record.entry)) {
+                const QString &last = m_texts[record.entry];
+                if (last == text && m_paths[record.entry] == record.path)
+                    continue;
+
+                // only keep a patch that exactly rebuilds the text
+                QList<Patch> patches =
+                    dmp.patch_make(last, m_lineDiff.diff(last, text));
+                QString patch = dmp.patch_toText(patches);
+                if (patch.size() < text.size() &&
+                    dmp.patch_apply(patches, last).first == text) {
+                    writeRecord(stream, PatchRecord, record.entry, record.path,
+                                patch);
+                    m_paths[record.entry] = record.path;
+                    m_texts[record.entry] = text;
+                    continue;
+                }
+            }
+            writeRecord(stream, SnapshotRecord, record.entry, record.path,
+                        text);
+            m_paths[record.entry] = record.path;
+            m_texts[record.entry] = text;
+        }
+        file.close();
+
+        if (file.size() > MaxJournalSize && !compact())
+            qWarning() << "RecoveryJournal: unable to compact" << m_filename;
+    }
+}
+
+bool RecoveryJournal::compact()
+{
+    QSaveFile file(m_filename);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << JournalMagic;
+
+    QHash<int, QString>::const_iterator it;
+    for (it = m_texts.constBegin(); it != m_texts.constEnd(); ++it)
+        writeRecord(stream, SnapshotRecord, it.key(), m_paths[it.key()],
+                    it.value());
+
+    // the previous journal is only replaced once the snapshots are written
+    return file.commit();
+}
@@ -0,0 +1,146 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __RECOVERY_JOURNAL_HH__
+#define __RECOVERY_JOURNAL_HH__
+
+#include <QObject>
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include "line-diff.hh"
+#include "singleton.hh"
+
+class QLockFile;
+
+/*!
+  \struct RecoveredSong
+  \brief RecoveredSong is an unsaved song found in the recovery journal
+*/
+struct RecoveredSong
+{
+    QString path; ///< path of the .sg file, empty for a new song
+    QString text; ///< unsaved contents of the .sg file
+};
+
+/*!
+  \file recovery-journal.hh
+  \class RecoveryJournal
+  \brief RecoveryJournal keeps the unsaved modifications of the songs
+
+  Each SongEditor owns an entry of the journal and periodically records
+  the contents of its song while it is modified. Records are appended to
+  a journal file by a background thread: the first record of an entry
+  is a snapshot of the song and the following ones only contain the
+  diff_match_patch patch from the previous contents. The entry is
+  discarded once the song is saved or its modifications are dropped.
+
+  Each instance of the application writes its own journal, locked by a
+  QLockFile. When the application starts, the journals that are not
+  locked any more (left by sessions that crashed or did not end) are
+  replayed and the songs that were not saved are returned by recover(),
+  so that they can be restored in new editors. These journals are only
+  removed by removeRecoveredJournals(), once the songs are restored or
+  dropped.
+
+  The journal file is compacted into snapshots when it grows too big.
+*/
+class RecoveryJournal : public QObject, public Singleton<RecoveryJournal>
+{
+    Q_OBJECT
+    friend class Singleton<RecoveryJournal>;
+
+public:
+    /*!
+    Returns the songs that were not saved when the previous session of
+    the application ended. The list is only returned once.
+  */
+    QList<RecoveredSong> recover();
+
+    /*!
+    Removes the journals of the previous sessions. Called once the songs
+    returned by recover() are restored (and recorded again) or dropped.
+  */
+    void removeRecoveredJournals();
+
+    /*!
+    Returns a new entry of the journal.
+  */
+    int createEntry();
+
+    /*!
+    Records \a text as the contents of the song \a path for \a entry.
+  */
+    void record(int entry, const QString &path, const QString &text);
+
+    /*!
+    Removes \a entry from the journal.
+  */
+    void discard(int entry);
+
+    /*!
+    Waits until the pending records are written to the journal file.
+  */
+    void flush();
+
+private:
+    RecoveryJournal();
+    ~RecoveryJournal();
+
+    enum RecordType { SnapshotRecord, PatchRecord, DiscardRecord };
+
+    struct Record
+    {
+        RecordType type;
+        int entry;
+        QString path;
+        QString text;
+    };
+
+    void enqueue(const Record &record);
+    void writeRecords();
+    bool compact();
+    QList<RecoveredSong> replay(const QString &filename) const;
+
+    QString m_filename;
+    QLockFile *m_lockFile;
+    QList<RecoveredSong> m_recoveredSongs;
+    QStringList m_recoveredJournals;
+    QList<QLockFile *> m_recoveredLocks;
+    int m_lastEntry;
+    QSet<int> m_recordedEntries;
+
+    // pending records, shared with the writer
+    QMutex m_mutex;
+    QList<Record> m_pendingRecords;
+    bool m_isWriting;
+    QFuture<void> m_writer;
+
+    // last recorded contents of the entries and their diff, only used by
+    // the writer
+    QHash<int, QString> m_paths;
+    QHash<int, QString> m_texts;
+    LineDiff m_lineDiff;
+};
+
+#endif // __RECOVERY_JOURNAL_HH__
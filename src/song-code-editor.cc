@@ -23,12 +23,12 @@
 #include "utils/tango-colors.hh"
 
 #ifdef ENABLE_SPELLCHECK
-#include "hunspell/hunspell.hxx"
+#include "spell-checker.hh"
+#include "dictionary-service.hh"
 #endif // ENABLE_SPELLCHECK
 
 #include <QtGlobal>
 #include <QSettings>
-#include <QTextCodec>
 #include <QTextBlock>
 #include <QDebug>
 
@@ -43,6 +43,57 @@
 #include <QAction>
 #include <QMenu>
 
+namespace // anonymous namespace
+{
+// blocks processed around the visible ones in large-document mode
+const int VisibleBlockMargin = 50;
+
+// environment of a text block
+class EnvironmentData : public QTextBlockUserData
+{
+public:
+    EnvironmentData()
+        : environment(SongCodeEditor::None)
+        , openEnvironment(SongCodeEditor::None)
+    {
+    }
+
+    int environment;     // environment the block belongs to
+    int openEnvironment; // environment that is still open after the block
+};
+
+EnvironmentData *environmentData(const QTextBlock &block)
+{
+    return static_cast<EnvironmentData *>(block.userData());
+}
+
+// environment of a line given the environment open before it
+void parseEnvironment(const QString &line, int open, int &environment,
+                      int &nextOpen)
+{
+    environment = open;
+    if (line.contains("repeatedchords")) {
+        nextOpen = open;
+        return;
+    }
+
+    if (line.contains("\\begin")) {
+        if (line.contains("verse"))
+            environment = SongCodeEditor::Verse;
+        else if (line.contains("chorus"))
+            environment = SongCodeEditor::Chorus;
+        else if (line.contains("bridge"))
+            environment = SongCodeEditor::Bridge;
+        else if (line.contains("scripture"))
+            environment = SongCodeEditor::Scripture;
+    }
+
+    bool closed = (environment != SongCodeEditor::None &&
+                   line.contains("\\end"));
+    nextOpen = closed ? int(SongCodeEditor::None) : environment;
+}
+}
+
 const QColor SongCodeEditor::_verseColor(_TangoChameleon1.lighter(180));
 const QColor SongCodeEditor::_chorusColor(_TangoOrange1.lighter(160));
 const QColor SongCodeEditor::_bridgeColor(_TangoSkyBlue1.lighter(170));
@@ -89,14 +140,21 @@ SongCodeEditor::SongCodeEditor(QWidget *parent)
     , m_completer(0)
     , m_highlighter(0)
     , m_quickSearch(new SearchWidget(this))
-    , m_environmentsHighlighted(true)
+    , m_environmentsHighlighted(false)
+    , m_environmentSelections()
+    , m_firstProcessedBlock(-1)
+    , m_lastProcessedBlock(-1)
     , m_isSpellCheckAvailable(false)
 #ifdef ENABLE_SPELLCHECK
     , m_maxSuggestedWords(0)
 #endif
 {
     connect(this, SIGNAL(cursorPositionChanged()),
-            SLOT(highlightEnvironments()));
+            SLOT(updateExtraSelections()));
+    connect(document(), SIGNAL(contentsChange(int, int, int)),
+            SLOT(updateEnvironments(int, int, int)));
+    connect(this, SIGNAL(visibleBlocksChanged(int, int)),
+            SLOT(updateVisibleBlocks(int, int)));
     m_completer = new QCompleter(_completerWordList, this);
     m_completer->setWidget(this);
     m_completer->setCompletionMode(QCompleter::PopupCompletion);
@@ -161,6 +219,12 @@ void SongCodeEditor::setHighlighter(SongHighlighter *highlighter)
     m_highlighter = highlighter;
     m_highlighter->setDocument(document());
 
+    // the highlighter may be shared with editors in another mode
+    m_highlighter->setHighlightedBlocks(m_firstProcessedBlock,
+                                        m_lastProcessedBlock);
+    if (largeDocumentMode())
+        m_highlighter->deferHighlighting();
+
     // removing the highlighter from previous document
     // should not change its state
     if (previousDocument)
@@ -311,40 +375,116 @@ void SongCodeEditor::toggleQuickSearch()
         setFocus();
 }
 
-void SongCodeEditor::highlightEnvironments()
+void SongCodeEditor::updateEnvironments(int position, int charsRemoved,
+                                        int charsAdded)
 {
+    Q_UNUSED(charsRemoved);
     if (!environmentsHighlighted())
         return;
 
-    bool environment = false;
-    QTextCursor cursor(document());
-    QStringList lines = toPlainText().split("\n");
-    QList<QTextEdit::ExtraSelection> extraSelections;
-    foreach (QString line, lines) {
-        if (line.contains("\\begin") && !line.contains("repeatedchords"))
-            environment = true;
-
-        if (environment && line.contains("\\end")) {
-            cursor.movePosition(QTextCursor::NextBlock,
-                                QTextCursor::KeepAnchor);
-
-            if (line.contains("verse"))
-                extraSelections.append(environmentSelection(Verse, cursor));
-            else if (line.contains("chorus"))
-                extraSelections.append(environmentSelection(Chorus, cursor));
-            else if (line.contains("bridge"))
-                extraSelections.append(environmentSelection(Bridge, cursor));
-            else if (line.contains("scripture"))
-                extraSelections.append(environmentSelection(Scripture, cursor));
-
-            cursor.movePosition(QTextCursor::PreviousBlock,
-                                QTextCursor::KeepAnchor);
-            environment = false;
+    QTextBlock block = document()->findBlock(position);
+    int lastChanged =
+        document()
+            ->findBlock(qMin(position + charsAdded,
+                             document()->characterCount() - 1))
+            .blockNumber();
+
+    int open = None;
+    if (block.previous().isValid() && environmentData(block.previous()))
+        open = environmentData(block.previous())->openEnvironment;
+
+    // parse the modified blocks, then the following blocks until their
+    // environment is the same as before
+    bool changed = false;
+    while (block.isValid()) {
+        int environment;
+        int nextOpen;
+        parseEnvironment(block.text(), open, environment, nextOpen);
+
+        EnvironmentData *data = environmentData(block);
+        if (data && data->environment == environment &&
+            data->openEnvironment == nextOpen &&
+            block.blockNumber() > lastChanged)
+            break;
+
+        if (!data) {
+            data = new EnvironmentData;
+            block.setUserData(data);
+            changed = changed || environment != None;
         }
-        cursor.movePosition(QTextCursor::NextBlock,
-                            environment ? QTextCursor::KeepAnchor
-                                        : QTextCursor::MoveAnchor);
+        changed = changed || data->environment != environment ||
+                  data->openEnvironment != nextOpen;
+        data->environment = environment;
+        data->openEnvironment = nextOpen;
+
+        open = nextOpen;
+        block = block.next();
     }
+
+    if (changed)
+        updateEnvironmentSelections();
+}
+
+void SongCodeEditor::updateVisibleBlocks(int first, int last)
+{
+    if (first == -1) {
+        m_firstProcessedBlock = -1;
+        m_lastProcessedBlock = -1;
+    } else {
+        m_firstProcessedBlock = qMax(0, first - VisibleBlockMargin);
+        m_lastProcessedBlock = last + VisibleBlockMargin;
+    }
+
+    if (highlighter() && highlighter()->document() == document())
+        highlighter()->setHighlightedBlocks(m_firstProcessedBlock,
+                                            m_lastProcessedBlock);
+    if (environmentsHighlighted())
+        updateEnvironmentSelections();
+}
+
+void SongCodeEditor::updateEnvironmentSelections()
+{
+    m_environmentSelections.clear();
+
+    // in large-document mode, only the spans around the visible blocks
+    QTextBlock block = document()->firstBlock();
+    int last = blockCount();
+    if (m_firstProcessedBlock != -1) {
+        block = document()->findBlockByNumber(m_firstProcessedBlock);
+        last = m_lastProcessedBlock;
+    }
+
+    while (block.isValid() && block.blockNumber() <= last) {
+        EnvironmentData *data = environmentData(block);
+        if (!data || data->environment == None) {
+            block = block.next();
+            continue;
+        }
+
+        // a span ends with the block that closes its environment
+        QTextBlock first = block;
+        while (data->openEnvironment != None && block.next().isValid() &&
+               block.blockNumber() < last && environmentData(block.next())) {
+            block = block.next();
+            data = environmentData(block);
+        }
+
+        QTextCursor cursor(first);
+        cursor.setPosition(block.position() + block.length() - 1,
+                           QTextCursor::KeepAnchor);
+        m_environmentSelections.append(environmentSelection(
+            SongEnvironment(environmentData(first)->environment), cursor));
+        block = block.next();
+    }
+
+    updateExtraSelections();
+}
+
+void SongCodeEditor::updateExtraSelections()
+{
+    // selection cursors follow the editions: spans are only rebuilt
+    // when an environment changes
+    QList<QTextEdit::ExtraSelection> extraSelections = m_environmentSelections;
     extraSelections.append(currentLineSelection());
     setExtraSelections(extraSelections);
 }
@@ -506,23 +646,7 @@ QStringList SongCodeEditor::getWordPropositions(const QString &word)
     if (!checker())
         return QStringList();
 
-    QStringList wordList;
-    QByteArray encodedString;
-    QString spell_encoding = QString(checker()->get_dic_encoding());
-    QTextCodec *codec = QTextCodec::codecForName(spell_encoding.toLatin1());
-    encodedString = codec->fromUnicode(word);
-
-    if (checker()->spell(encodedString.data()))
-        return wordList;
-
-    char **wlst;
-    int ns = checker()->suggest(&wlst, encodedString.data());
-    if (ns > 0) {
-        for (int i = 0; i < ns; i++)
-            wordList.append(codec->toUnicode(wlst[i]));
-        checker()->free_list(&wlst, ns);
-    }
-    return wordList;
+    return checker()->suggest(word);
 }
 #endif // ENABLE_SPELLCHECK
 
@@ -568,30 +692,22 @@ void SongCodeEditor::contextMenuEvent(QContextMenuEvent *event)
 }
 
 #ifdef ENABLE_SPELLCHECK
+// the highlighter adds the word to the dictionary for this session
 void SongCodeEditor::ignoreWord()
 {
-    QString str = currentWord();
-    QByteArray encodedString;
-    QString spell_encoding = QString(checker()->get_dic_encoding());
-    QTextCodec *codec = QTextCodec::codecForName(spell_encoding.toLatin1());
-    encodedString = codec->fromUnicode(str);
-    checker()->add(encodedString.data());
-    emit wordAdded(str);
+    emit wordAdded(currentWord());
 }
 
 void SongCodeEditor::addWord()
 {
     QString str = currentWord();
-    QByteArray encodedString;
-    QString spell_encoding = QString(checker()->get_dic_encoding());
-    QTextCodec *codec = QTextCodec::codecForName(spell_encoding.toLatin1());
-    encodedString = codec->fromUnicode(str);
-    checker()->add(encodedString.data());
+    if (checker())
+        DictionaryService::instance()->addWord(checker()->dictionary(), str);
     m_addedWords.append(str);
     emit wordAdded(str);
 }
 
-Hunspell *SongCodeEditor::checker() const
+SpellChecker *SongCodeEditor::checker() const
 {
     if (!highlighter())
         return 0;
@@ -670,5 +786,15 @@ bool SongCodeEditor::environmentsHighlighted() const
 
 void SongCodeEditor::setEnvironmentsHighlighted(bool value)
 {
+    if (m_environmentsHighlighted == value)
+        return;
+
     m_environmentsHighlighted = value;
+    if (value) {
+        updateEnvironments(0, 0, document()->characterCount());
+        updateEnvironmentSelections();
+    } else {
+        m_environmentSelections.clear();
+        updateExtraSelections();
+    }
 }
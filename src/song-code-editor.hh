@@ -27,7 +27,7 @@
 class QKeyEvent;
 class QCompleter;
 class SongHighlighter;
-class Hunspell;
+class SpellChecker;
 class SearchWidget;
 /*!
   \file song-code-editor.hh
@@ -36,6 +36,9 @@ class SearchWidget;
 
   \image html song-code-editor.png
 
+  The environment of each line is kept in the user data of its text
+  block and only the blocks affected by an edition are parsed again, so
+  that moving the cursor does not parse the song.
  */
 class SongCodeEditor : public CodeEditor
 {
@@ -181,7 +184,9 @@ signals:
     void wordAdded(const QString &word);
 
 private slots:
-    void highlightEnvironments();
+    void updateEnvironments(int position, int charsRemoved, int charsAdded);
+    void updateExtraSelections();
+    void updateVisibleBlocks(int first, int last);
     void insertCompletion(const QString &completion);
     void insertVerse();
     void insertChorus();
@@ -195,7 +200,7 @@ public:
     Returns the Hunspell spell-checker associated with this song.
     \sa isSpellCheckAvailable, isSpellCheckActive
   */
-    Hunspell *checker() const;
+    SpellChecker *checker() const;
 
 public slots:
     /*!
@@ -222,12 +227,18 @@ private:
 
     QTextEdit::ExtraSelection environmentSelection(const SongEnvironment &env,
                                                    const QTextCursor &cursor);
+    void updateEnvironmentSelections();
 
     QCompleter *m_completer;
     SongHighlighter *m_highlighter;
     SearchWidget *m_quickSearch;
 
     bool m_environmentsHighlighted;
+    QList<QTextEdit::ExtraSelection> m_environmentSelections;
+
+    // blocks processed in large-document mode (-1 for the whole document)
+    int m_firstProcessedBlock;
+    int m_lastProcessedBlock;
     bool m_isSpellCheckAvailable;
 
 #ifdef ENABLE_SPELLCHECK
@@ -23,9 +23,15 @@
 #include "song-highlighter.hh"
 #include "song-code-editor.hh"
 #include "library.hh"
+#include "recovery-journal.hh"
+#include "chord-index.hh"
+#include "fingering-database.hh"
 #include "utils/lineedit.hh"
 
 #include <QFile>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QTextStream>
 #include <QToolBar>
 #include <QAction>
 #include <QActionGroup>
@@ -33,9 +39,16 @@
 #include <QSettings>
 #include <QBoxLayout>
 #include <QMessageBox>
+#include <QTimer>
 
 #include <QDebug>
 
+namespace // anonymous namespace
+{
+// delay between two records of the modifications in the journal (ms)
+const int JournalDelay = 2000;
+}
+
 Editor::Editor(QWidget *parent)
     : QWidget(parent), m_actions(new QActionGroup(this))
 {
@@ -148,6 +161,13 @@ Editor::Editor(QWidget *parent)
     m_bridgeAct->setStatusTip(tr("Insert a new bridge"));
     m_actions->addAction(m_bridgeAct);
     toolBar()->addAction(m_bridgeAct);
+
+    m_diagramsAct = new QAction(tr("Diagrams"), this);
+    m_diagramsAct->setToolTip(tr("Add the missing chord diagrams"));
+    m_diagramsAct->setStatusTip(
+        tr("Add a diagram for each chord of the song that has none"));
+    m_actions->addAction(m_diagramsAct);
+    toolBar()->addAction(m_diagramsAct);
 }
 
 Editor::~Editor()
@@ -181,12 +201,16 @@ SongEditor::SongEditor(QWidget *parent)
     , m_song()
     , m_newSong(true)
     , m_newCover(false)
+    , m_journalEntry(RecoveryJournal::instance()->createEntry())
+    , m_journalTimer(new QTimer(this))
 {
     m_songHeaderEditor = new CSongHeaderEditor(this);
     m_songHeaderEditor->setSong(m_song);
 
     connect(m_songHeaderEditor, SIGNAL(contentsChanged()),
             SLOT(documentWasModified()));
+    connect(m_songHeaderEditor, SIGNAL(contentsChanged()),
+            SLOT(contentsChanged()));
     connect(m_songHeaderEditor, SIGNAL(newCover(bool)),
             SLOT(setNewCover(bool)));
 #ifdef ENABLE_SPELLCHECK
@@ -197,10 +221,12 @@ SongEditor::SongEditor(QWidget *parent)
     m_codeEditor = new SongCodeEditor(this);
     connect(m_codeEditor->document(), SIGNAL(modificationChanged(bool)),
             SLOT(setModified(bool)));
+    connect(m_codeEditor->document(), SIGNAL(contentsChanged()),
+            SLOT(contentsChanged()));
 
-    m_findReplaceDialog = new FindReplaceDialog(this);
-    m_findReplaceDialog->setTextEditor(codeEditor());
-    m_findReplaceDialog->readSettings();
+    m_journalTimer->setSingleShot(true);
+    m_journalTimer->setInterval(JournalDelay);
+    connect(m_journalTimer, SIGNAL(timeout()), SLOT(recordChanges()));
 
     // connects
     connect(m_saveAct, SIGNAL(triggered()), SLOT(save()));
@@ -219,6 +245,7 @@ SongEditor::SongEditor(QWidget *parent)
     connect(m_spellCheckingAct, SIGNAL(toggled(bool)),
             SLOT(toggleSpellCheckActive(bool)));
     connect(m_replaceAct, SIGNAL(triggered()), SLOT(findReplaceDialog()));
+    connect(m_diagramsAct, SIGNAL(triggered()), SLOT(addMissingDiagrams()));
 
     QBoxLayout *mainLayout = new QVBoxLayout();
     mainLayout->setContentsMargins(0, 0, 0, 0);
@@ -264,6 +291,8 @@ void SongEditor::closeEvent(QCloseEvent *event)
             event->ignore();
         }
         if (answer == QMessageBox::Discard) {
+            m_journalTimer->stop();
+            RecoveryJournal::instance()->discard(m_journalEntry);
             event->accept();
         }
     }
@@ -278,7 +307,7 @@ void SongEditor::save()
         return;
 
     // get the song contents
-    parseText();
+    parseText(m_song);
 
     // save the song and add it to the library list
     library()->createArtistDirectory(m_song);
@@ -293,6 +322,7 @@ void SongEditor::save()
     setWindowTitle(m_song.title);
     emit(labelChanged(windowTitle()));
     setStatusTip(tr("Song saved in: %1").arg(song().path));
+    emit(saved(song().path));
 }
 
 bool SongEditor::checkSongMandatoryFields()
@@ -316,10 +346,10 @@ bool SongEditor::checkSongMandatoryFields()
     return true;
 }
 
-void SongEditor::parseText()
+void SongEditor::parseText(Song &song) const
 {
-    m_song.lyrics.clear();
-    m_song.scripture.clear();
+    song.lyrics.clear();
+    song.scripture.clear();
 
     bool in_scripture = false;
 
@@ -332,12 +362,12 @@ void SongEditor::parseText()
             // ensures all lines in a scripture environment end with a % symbol
             if (!line.endsWith("%"))
                 line = line.append("%");
-            m_song.scripture << line;
+            song.scripture << line;
         } else {
             // add a level of indentation
             if (!line.isEmpty())
                 line = line.prepend("  ");
-            m_song.lyrics << line;
+            song.lyrics << line;
         }
 
         if (line.contains("\\endscripture"))
@@ -345,17 +375,17 @@ void SongEditor::parseText()
     }
 
     // remove blank line at the end of input
-    while (!m_song.lyrics.empty() && m_song.lyrics.last().trimmed().isEmpty()) {
-        m_song.lyrics.removeLast();
+    while (!song.lyrics.empty() && song.lyrics.last().trimmed().isEmpty()) {
+        song.lyrics.removeLast();
     }
 
-    while (!m_song.scripture.isEmpty() &&
-           m_song.scripture.last().trimmed().isEmpty()) {
-        m_song.scripture.removeLast();
+    while (!song.scripture.isEmpty() &&
+           song.scripture.last().trimmed().isEmpty()) {
+        song.scripture.removeLast();
     }
 
     // finally insert newline after endsong macro
-    m_song.lyrics << QString();
+    song.lyrics << QString();
 }
 
 void SongEditor::saveNewSong()
@@ -380,6 +410,21 @@ void SongEditor::saveNewSong()
 
 void SongEditor::documentWasModified() { setModified(true); }
 
+void SongEditor::contentsChanged()
+{
+    // the contents are recorded at most once per JournalDelay
+    if (isModified() && !m_journalTimer->isActive())
+        m_journalTimer->start();
+}
+
+void SongEditor::recordChanges()
+{
+    m_journalTimer->stop();
+    if (isModified())
+        RecoveryJournal::instance()->record(m_journalEntry, m_song.path,
+                                            Song::toString(editedSong()));
+}
+
 Library *SongEditor::library() const { return Library::instance(); }
 
 bool SongEditor::isModified() const
@@ -392,6 +437,12 @@ void SongEditor::setModified(bool modified)
     if (codeEditor()->document()->isModified() != modified)
         codeEditor()->document()->setModified(modified);
 
+    // the saved file is up to date: drop the recorded modifications
+    if (!modified) {
+        m_journalTimer->stop();
+        RecoveryJournal::instance()->discard(m_journalEntry);
+    }
+
     // update the window title
     if (modified && !windowTitle().contains(" *")) {
         setWindowTitle(windowTitle() + " *");
@@ -404,6 +455,27 @@ void SongEditor::setModified(bool modified)
 
 Song &SongEditor::song() { return m_song; }
 
+void SongEditor::addMissingDiagrams()
+{
+    Song song = editedSong();
+
+    // the diagrams are added for the instrument the song already uses
+    Chord::Instrument instrument = song.utabs.size() > song.gtabs.size()
+                                       ? Chord::Ukulele
+                                       : Chord::Guitar;
+    QStringList diagrams = FingeringDatabase::missingDiagrams(
+        ChordIndex::songChords(song), song.gtabs + song.utabs, instrument);
+    m_songHeaderEditor->addDiagrams(diagrams);
+}
+
+Song SongEditor::editedSong() const
+{
+    Song song = m_songHeaderEditor->song();
+    song.path = m_song.path;
+    parseText(song);
+    return song;
+}
+
 void SongEditor::setSong(const Song &song)
 {
     m_song = song;
@@ -441,6 +513,35 @@ void SongEditor::setNewCover(bool newCover) { m_newCover = newCover; }
 
 SongCodeEditor *SongEditor::codeEditor() const { return m_codeEditor; }
 
+void SongEditor::goToLine(int line)
+{
+    // the code editor only contains the lyrics: find the line of the
+    // .sg file where they start
+    int offset = 0;
+    QFile file(m_song.path);
+    if (!m_song.lyrics.isEmpty() &&
+        file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream stream(&file);
+        stream.setCodec("UTF-8");
+        QString firstLyric = m_song.lyrics.first().trimmed();
+        for (int number = 0; !stream.atEnd(); ++number) {
+            if (stream.readLine().trimmed() == firstLyric) {
+                offset = number;
+                break;
+            }
+        }
+        file.close();
+    }
+
+    int blockNumber =
+        qBound(0, line - 1 - offset, codeEditor()->blockCount() - 1);
+    QTextCursor cursor(
+        codeEditor()->document()->findBlockByNumber(blockNumber));
+    codeEditor()->setTextCursor(cursor);
+    codeEditor()->centerCursor();
+    codeEditor()->setFocus();
+}
+
 bool SongEditor::isSpellCheckAvailable() const
 {
     return codeEditor()->isSpellCheckAvailable();
@@ -518,6 +619,30 @@ QToolBar *SongEditor::toolBar() const
 
 void SongEditor::findReplaceDialog()
 {
-    if (m_findReplaceDialog)
-        m_findReplaceDialog->show();
+    // the dialog is only created when it is first needed
+    if (!m_findReplaceDialog) {
+        m_findReplaceDialog = new FindReplaceDialog(this);
+        m_findReplaceDialog->setTextEditor(codeEditor());
+    }
+    m_findReplaceDialog->show();
+}
+
+void SongEditor::unloadWidgets()
+{
+    if (isVisible())
+        return;
+
+    if (m_findReplaceDialog && !m_findReplaceDialog->isVisible()) {
+        delete m_findReplaceDialog;
+        m_findReplaceDialog = 0;
+    }
+    m_songHeaderEditor->unloadDiagrams();
+
+    // the text and the undo stack remain in the document: only the
+    // layout of the blocks is released, it is computed again when they
+    // are displayed
+    QTextBlock block = codeEditor()->document()->begin();
+    for (; block.isValid(); block = block.next())
+        if (QTextLayout *layout = block.layout())
+            layout->clearLayout();
 }
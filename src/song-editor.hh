@@ -34,6 +34,7 @@ class CSongHeaderEditor;
 class SongHighlighter;
 class FindReplaceDialog;
 class Hunspell;
+class QTimer;
 
 /*!
   \file song-editor.hh
@@ -109,6 +110,9 @@ protected:
     /// Underline mispelled words
     QAction *m_spellCheckingAct;
 
+    /// Add the diagrams of the chords that have none
+    QAction *m_diagramsAct;
+
 protected:
     QActionGroup *m_actions;
     QToolBar *m_toolBar;
@@ -123,6 +127,10 @@ protected:
    \li a CSongHeaderEditor that manages the song metadata
    \li a SongCodeEditor that manages the body of the song
 
+  While the song is modified, its contents are recorded in the
+  RecoveryJournal every few seconds so that they can be restored if the
+  application is not closed properly.
+
   \image html song-editor.png
 
 */
@@ -146,8 +154,19 @@ public:
     Song &song();
     void setSong(const Song &song);
 
+    /*!
+    Returns the song with the current contents of the editor,
+    without saving it.
+  */
+    Song editedSong() const;
+
     SongCodeEditor *codeEditor() const;
 
+    /*!
+    Moves the cursor of the code editor to the line \a line of the .sg file.
+  */
+    void goToLine(int line);
+
     bool isModified() const;
     bool isNewSong() const;
 
@@ -157,6 +176,13 @@ public:
     virtual QToolBar *toolBar() const;
     virtual QActionGroup *actionGroup() const;
 
+    /*!
+    Releases the widgets and the text layout of the editor while it is
+    hidden. The contents of the song and the undo stack are kept, and the
+    widgets are created again when they are needed.
+  */
+    void unloadWidgets();
+
     virtual bool isSpellCheckAvailable() const;
     virtual void setSpellCheckAvailable(const bool);
 
@@ -173,6 +199,11 @@ public slots:
 
     void toggleSpellCheckActive(bool);
 
+    /*!
+    Records the unsaved contents of the song in the RecoveryJournal.
+  */
+    void recordChanges();
+
 signals:
     void labelChanged(const QString &label);
     void saved(const QString &path);
@@ -184,10 +215,12 @@ private slots:
     // write modifications of the textEdit into sg file.
     void save();
     void documentWasModified();
+    void contentsChanged();
     void findReplaceDialog();
+    void addMissingDiagrams();
 
 private:
-    void parseText();
+    void parseText(Song &song) const;
     bool checkSongMandatoryFields();
     void saveNewSong();
 
@@ -198,6 +231,9 @@ private:
     Song m_song;
     bool m_newSong;
     bool m_newCover;
+
+    int m_journalEntry;
+    QTimer *m_journalTimer;
 };
 
 #endif // __SONG_EDITOR_HH__
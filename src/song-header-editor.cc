@@ -46,6 +46,7 @@
 #include <QDragEnterEvent>
 #include <QDragMoveEvent>
 #include <QDragLeaveEvent>
+#include <QShowEvent>
 #include <QContextMenuEvent>
 #include <QMenu>
 #include <QAction>
@@ -64,6 +65,8 @@ CSongHeaderEditor::CSongHeaderEditor(QWidget *parent)
     , m_capoSpinBox(new QSpinBox(this))
     , m_transposeSpinBox(new QSpinBox(this))
     , m_coverLabel(new CoverDropArea(this))
+    , m_diagramsScrollArea(0)
+    , m_diagramArea(0)
     , m_viewMode(FullViewMode)
 {
 
@@ -155,16 +158,10 @@ CSongHeaderEditor::CSongHeaderEditor(QWidget *parent)
     songInformationLayout->addLayout(additionalInformationLayout);
     songInformationLayout->addStretch();
 
-    m_diagramArea = new DiagramArea(this);
-    m_diagramArea->setRowCount(1);
-    m_diagramArea->setReadOnly(false);
-    connect(m_diagramArea, SIGNAL(contentsChanged()),
-            SLOT(onDiagramsChanged()));
-
-    QScrollArea* diagramsScrollArea = new QScrollArea;
-    diagramsScrollArea->setWidget(m_diagramArea);
-    diagramsScrollArea->setBackgroundRole(QPalette::Dark);
-    diagramsScrollArea->setWidgetResizable(true);
+    // the diagram area is only created when the header is displayed
+    m_diagramsScrollArea = new QScrollArea;
+    m_diagramsScrollArea->setBackgroundRole(QPalette::Dark);
+    m_diagramsScrollArea->setWidgetResizable(true);
 
     QBoxLayout *toMiniViewLayout = new QVBoxLayout;
     QPushButton *toMiniViewButton = new QPushButton;
@@ -180,7 +177,7 @@ CSongHeaderEditor::CSongHeaderEditor(QWidget *parent)
     fullViewLayout->setContentsMargins(4, 0, 4, 0);
     fullViewLayout->addWidget(m_coverLabel);
     fullViewLayout->addLayout(songInformationLayout);
-    fullViewLayout->addWidget(diagramsScrollArea, 1);
+    fullViewLayout->addWidget(m_diagramsScrollArea, 1);
     fullViewLayout->addLayout(toMiniViewLayout);
     fullView->setLayout(fullViewLayout);
 
@@ -249,11 +246,67 @@ void CSongHeaderEditor::toggleView()
     else if (m_viewMode == MiniViewMode)
     {
         m_viewMode = FullViewMode;
+        diagramArea();
         m_stackedLayout->setCurrentIndex(1);
         setMaximumHeight(150);
     }
 }
 
+void CSongHeaderEditor::showEvent(QShowEvent *event)
+{
+    if (m_viewMode == FullViewMode)
+        diagramArea();
+    QWidget::showEvent(event);
+}
+
+DiagramArea * CSongHeaderEditor::diagramArea()
+{
+    if (m_diagramArea)
+        return m_diagramArea;
+
+    m_diagramArea = new DiagramArea;
+    m_diagramArea->setRowCount(1);
+    m_diagramArea->setReadOnly(false);
+    fillDiagramArea();
+    connect(m_diagramArea, SIGNAL(contentsChanged()),
+            SLOT(onDiagramsChanged()));
+    m_diagramsScrollArea->setWidget(m_diagramArea);
+    return m_diagramArea;
+}
+
+void CSongHeaderEditor::fillDiagramArea()
+{
+    m_diagramArea->setDiagrams(song().gtabs + song().utabs);
+}
+
+void CSongHeaderEditor::addDiagrams(const QStringList &diagrams)
+{
+    if (diagrams.isEmpty())
+        return;
+
+    foreach (const QString &diagram, diagrams)
+    {
+        if (diagram.startsWith("\\utab"))
+            song().utabs << diagram;
+        else
+            song().gtabs << diagram;
+    }
+
+    if (m_diagramArea)
+        fillDiagramArea();
+    emit(contentsChanged());
+}
+
+void CSongHeaderEditor::unloadDiagrams()
+{
+    if (!m_diagramArea || isVisible())
+        return;
+
+    // the diagrams are kept in the song
+    delete m_diagramsScrollArea->takeWidget();
+    m_diagramArea = 0;
+}
+
 Song & CSongHeaderEditor::song()
 {
     return m_song;
@@ -334,17 +387,8 @@ void CSongHeaderEditor::update()
     m_transposeSpinBox->setValue(song().transpose);
     m_coverLabel->update();
 
-    QString gtab;
-    foreach (gtab, song().gtabs)
-    {
-        m_diagramArea->addDiagram(gtab);
-    }
-
-    QString utab;
-    foreach (utab, song().utabs)
-    {
-        m_diagramArea->addDiagram(utab);
-    }
+    if (m_diagramArea)
+        fillDiagramArea();
 }
 
 void CSongHeaderEditor::onIndexChanged(const QString &text)
@@ -414,12 +458,12 @@ void CSongHeaderEditor::onDiagramsChanged()
 {
     song().gtabs = QStringList();
     song().utabs = QStringList();
-    foreach (Chord *chord, m_diagramArea->chords())
+    foreach (const QString &diagram, m_diagramArea->diagrams())
     {
-        if (chord->instrument() == Chord::Guitar)
-            song().gtabs << chord->toString();
-        else if (chord->instrument() == Chord::Ukulele)
-            song().utabs << chord->toString();
+        if (diagram.startsWith("\\utab"))
+            song().utabs << diagram;
+        else
+            song().gtabs << diagram;
     }
     emit(contentsChanged());
 }
@@ -35,6 +35,7 @@ class QSpinBox;
 class QComboBox;
 class QBoxLayout;
 class QStackedLayout;
+class QScrollArea;
 
 /*!
   \file song-header-editor.hh
@@ -100,6 +101,25 @@ public:
   */
     QSize sizeHint() const;
 
+    /*!
+    Deletes the chord diagrams area while the header is hidden. It is
+    created again from the diagrams of the song when the header is
+    displayed.
+  */
+    void unloadDiagrams();
+
+    /*!
+    Adds the chord \a diagrams, such as \\gtab{Am}{X02210}, to the
+    song.
+  */
+    void addDiagrams(const QStringList &diagrams);
+
+protected:
+    /*!
+    Creates the chord diagrams area the first time the header is shown.
+  */
+    virtual void showEvent(QShowEvent *event);
+
 private slots:
     void onIndexChanged(const QString &text);
     void onTextEdited(const QString &text);
@@ -113,6 +133,16 @@ private:
   */
     void update();
 
+    /*!
+    Returns the chord diagrams area, creating it if necessary.
+  */
+    DiagramArea * diagramArea();
+
+    /*!
+    Adds the diagrams of the song to the chord diagrams area.
+  */
+    void fillDiagramArea();
+
 public slots:
 
     /*!
@@ -154,6 +184,7 @@ private:
     QSpinBox *m_transposeSpinBox;
     CoverDropArea *m_coverLabel;
 
+    QScrollArea *m_diagramsScrollArea;
     DiagramArea *m_diagramArea;
 
     ViewMode m_viewMode;
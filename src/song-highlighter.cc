@@ -18,66 +18,104 @@
 //******************************************************************************
 
 #include <QFileInfo>
-#include <QTextCodec>
+#include <QTextBlock>
+#include <QTimer>
+#include <QtConcurrent>
 
 #include "config.hh"
 #include "song-highlighter.hh"
 #include "song.hh"
-#ifdef ENABLE_SPELLCHECK
-#include "hunspell/hunspell.hxx"
-#endif // ENABLE_SPELLCHECK
+#include "spell-checker.hh"
+#include "dictionary-service.hh"
 
 #include "utils/tango-colors.hh"
 
 #include <QDebug>
 
-const QRegExp SongHighlighter::reLaTeXOption("\\[[^\\]]+\\]");
-const QRegExp SongHighlighter::reLaTeXArgument("\\{[^}]+\\}");
-
-const QRegExp SongHighlighter::reChordsPattern("\\\\\\[[^\\]]+\\]");
-const QRegExp SongHighlighter::reCommentsPattern("%[^\n]*");
-
-const QStringList SongHighlighter::_keywordPatterns(QStringList()
-                                                    << "\\\\gtab"
-                                                    << "\\\\utab"
-                                                    << "\\\\rep"
-                                                    << "\\\\lilypond"
-                                                    << "\\\\image"
-                                                    << "\\\\songcolumns"
-                                                    << "\\\\cover"
-                                                    << "\\\\capo"
-                                                    << "\\\\nolyrics"
-                                                    << "\\\\musicnote"
-                                                    << "\\\\textnote"
-                                                    << "\\\\dots"
-                                                    << "\\\\single"
-                                                    << "\\\\echo"
-                                                    << "\\\\transpose"
-                                                    << "\\\\transposition"
-                                                    << "\\\\emph"
-                                                    << "\\\\selectlanguage");
-
-const QStringList SongHighlighter::_keyword2Patterns(QStringList()
-                                                     << "\\\\Intro"
-                                                     << "\\\\Rhythm"
-                                                     << "\\\\Outro"
-                                                     << "\\\\Bridge"
-                                                     << "\\\\Verse"
-                                                     << "\\\\Chorus"
-                                                     << "\\\\Pattern"
-                                                     << "\\\\Solo"
-                                                     << "\\\\Adlib"
-                                                     << "\\\\else"
-                                                     << "\\\\ifchorded"
-                                                     << "\\\\iflyrics"
-                                                     << "\\\\ifnorepeatchords"
-                                                     << "\\\\fi");
+namespace // anonymous namespace
+{
+// marks the blocks whose highlighting is deferred, above the lexer state
+const int DeferredState = 1 << 30;
+
+// number of deferred blocks highlighted at each idle time
+const int IdleBlockCount = 100;
+
+bool isDeferred(const QTextBlock &block)
+{
+    return block.userState() != -1 && (block.userState() & DeferredState);
+}
+
+#ifdef ENABLE_SPELLCHECK
+// number of words whose spelling is kept
+const int SpellingCacheSize = 50000;
+
+// number of words checked by a single background task
+const int MaxCheckedWords = 500;
+
+QString spellingKey(const QString &dictionary, const QString &word)
+{
+    return QString("%1\n%2").arg(dictionary).arg(word);
+}
+
+QHash<QString, bool> checkWords(QSharedPointer<SpellChecker> checker,
+                                const QStringList &words)
+{
+    QHash<QString, bool> spelling;
+    foreach (const QString &word, words)
+        spelling.insert(spellingKey(checker->dictionary(), word),
+                        checker->spell(word));
+    return spelling;
+}
+#endif // ENABLE_SPELLCHECK
+}
+
+const QStringList SongHighlighter::_keywords(QStringList()
+                                             << "gtab"
+                                             << "utab"
+                                             << "rep"
+                                             << "lilypond"
+                                             << "image"
+                                             << "songcolumns"
+                                             << "cover"
+                                             << "capo"
+                                             << "nolyrics"
+                                             << "musicnote"
+                                             << "textnote"
+                                             << "dots"
+                                             << "single"
+                                             << "echo"
+                                             << "transpose"
+                                             << "transposition"
+                                             << "emph"
+                                             << "selectlanguage");
+
+const QStringList SongHighlighter::_keywords2(QStringList()
+                                              << "Intro"
+                                              << "Rhythm"
+                                              << "Outro"
+                                              << "Bridge"
+                                              << "Verse"
+                                              << "Chorus"
+                                              << "Pattern"
+                                              << "Solo"
+                                              << "Adlib"
+                                              << "else"
+                                              << "ifchorded"
+                                              << "iflyrics"
+                                              << "ifnorepeatchords"
+                                              << "fi");
 
 const QStringList SongHighlighter::_delimiters(QStringList()
-                                               << "\\\\begin"
-                                               << "\\\\end"
-                                               << "\\\\beginscripture"
-                                               << "\\\\endscripture");
+                                               << "begin"
+                                               << "end"
+                                               << "beginsong"
+                                               << "endsong"
+                                               << "beginverse"
+                                               << "endverse"
+                                               << "beginchorus"
+                                               << "endchorus"
+                                               << "beginscripture"
+                                               << "endscripture");
 
 const QColor SongHighlighter::_keywords1Color(_TangoOrange3); // orange
 const QColor SongHighlighter::_keywords2Color(_TangoScarletRed3); // red
@@ -88,100 +126,209 @@ const QColor SongHighlighter::_chordsColor(_TangoSkyBlue3); // blue
 
 SongHighlighter::SongHighlighter(QTextDocument *parent)
     : QSyntaxHighlighter(parent)
-    , m_checker(0)
+    , m_lexer()
+    , m_firstHighlightedBlock(-1)
+    , m_lastHighlightedBlock(-1)
+    , m_isDeferringAll(false)
+    , m_nextDeferredBlock(-1)
+    , m_idleBlock(-1)
+    , m_idleTimer(new QTimer(this))
+#ifdef ENABLE_SPELLCHECK
+    , m_checker()
+    , m_dictionary()
     , m_isSpellCheckActive(false)
-    , m_codec(0)
+    , m_spellingCache(SpellingCacheSize)
+    , m_pendingWords()
+    , m_spellingWatcher(new QFutureWatcher<QHash<QString, bool> >(this))
+    , m_isCheckScheduled(false)
+#endif // ENABLE_SPELLCHECK
 {
-    HighlightingRule rule;
-
     // LaTeX options (overrided by chords)
     optionFormat.setFontItalic(true);
-    rule.pattern = reLaTeXOption;
-    rule.format = optionFormat;
-    highlightingRules.append(rule);
 
     // LaTeX args (bold)
     argumentFormat.setFontWeight(QFont::Bold);
-    rule.pattern = reLaTeXArgument;
-    rule.format = argumentFormat;
-    highlightingRules.append(rule);
 
     // Keywords1 (orange)
     keywordFormat.setForeground(_keywords1Color);
     keywordFormat.setFontWeight(QFont::Bold);
-    foreach (const QString &pattern, _keywordPatterns) {
-        rule.pattern = QRegExp(pattern);
-        rule.format = keywordFormat;
-        highlightingRules.append(rule);
-    }
+    m_lexer.addMacros(_keywords, KeywordCategory);
 
     // Keywords2 (red)
     keyword2Format.setForeground(_keywords2Color);
     keyword2Format.setFontWeight(QFont::Bold);
-    foreach (const QString &pattern, _keyword2Patterns) {
-        rule.pattern = QRegExp(pattern);
-        rule.format = keyword2Format;
-        highlightingRules.append(rule);
-    }
+    m_lexer.addMacros(_keywords2, Keyword2Category);
 
     // Environments (bold, green)
     environmentFormat.setFontWeight(QFont::Bold);
     environmentFormat.setForeground(_environmentsColor);
-    foreach (QString str, _delimiters) {
-        rule.pattern = QRegExp(str);
-        rule.format = environmentFormat;
-        highlightingRules.append(rule);
-    }
+    m_lexer.addMacros(_delimiters, EnvironmentCategory);
 
     // Comments (grey)
     singleLineCommentFormat.setForeground(_commentsColor);
-    rule.pattern = reCommentsPattern;
-    rule.format = singleLineCommentFormat;
-    highlightingRules.append(rule);
 
     // Quotations (violet)
     quotationFormat.setForeground(_quotesColor);
-    rule.pattern = QRegExp("\".*\"");
-    rule.format = quotationFormat;
-    highlightingRules.append(rule);
-
-    rule.pattern = QRegExp("``.*''");
-    rule.format = quotationFormat;
-    highlightingRules.append(rule);
 
     // Chords (blue)
     chordFormat.setForeground(_chordsColor);
     chordFormat.setFontWeight(QFont::Bold);
-    rule.pattern = reChordsPattern;
-    rule.format = chordFormat;
-    highlightingRules.append(rule);
+
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(0);
+    connect(m_idleTimer, SIGNAL(timeout()), SLOT(highlightDeferredBlocks()));
 
 #ifdef ENABLE_SPELLCHECK
     // Settings for online spellchecking
     m_spellCheckFormat.setUnderlineColor(QColor(Qt::red));
     m_spellCheckFormat.setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
+    connect(m_spellingWatcher, SIGNAL(finished()), SLOT(wordsChecked()));
 #endif // ENABLE_SPELLCHECK
 }
 
 SongHighlighter::~SongHighlighter()
 {
 #ifdef ENABLE_SPELLCHECK
-    delete m_checker;
+    m_spellingWatcher->waitForFinished();
 #endif // ENABLE_SPELLCHECK
 }
 
-void SongHighlighter::highlightBlock(const QString &text)
+const QTextCharFormat *
+SongHighlighter::tokenFormat(const LatexLexer::Token &token) const
 {
-    foreach (const HighlightingRule &rule, highlightingRules) {
-        QRegExp expression(rule.pattern);
-        int index = expression.indexIn(text);
-        while (index >= 0) {
-            int length = expression.matchedLength();
-            setFormat(index, length, rule.format);
-            index = expression.indexIn(text, index + length);
+    switch (token.type) {
+    case LatexLexer::Macro:
+        switch (token.category) {
+        case KeywordCategory:
+            return &keywordFormat;
+        case Keyword2Category:
+            return &keyword2Format;
+        case EnvironmentCategory:
+            return &environmentFormat;
+        default:
+            return 0;
         }
+    case LatexLexer::Chord:
+        return &chordFormat;
+    case LatexLexer::Comment:
+        return &singleLineCommentFormat;
+    case LatexLexer::Quote:
+        return &quotationFormat;
+    case LatexLexer::Option:
+        return &optionFormat;
+    case LatexLexer::Argument:
+        return &argumentFormat;
+    default:
+        return 0;
+    }
+}
+
+void SongHighlighter::setHighlightedBlocks(int first, int last)
+{
+    m_firstHighlightedBlock = first;
+    m_lastHighlightedBlock = last;
+    if (!document())
+        return;
+
+    // blocks entering the range are highlighted right away
+    if (first != -1) {
+        QTextBlock block = document()->findBlockByNumber(first);
+        while (block.isValid() && block.blockNumber() <= last) {
+            if (isDeferred(block))
+                rehighlightBlock(block);
+            block = block.next();
+        }
+    }
+
+    if (m_nextDeferredBlock != -1)
+        m_idleTimer->start();
+}
+
+void SongHighlighter::deferHighlighting()
+{
+    // cleared by the next idle time, once the pending rehighlight is done
+    m_isDeferringAll = true;
+    m_idleTimer->start();
+}
+
+bool SongHighlighter::deferBlock()
+{
+    if (m_firstHighlightedBlock == -1)
+        return false;
+
+    const int number = currentBlock().blockNumber();
+    if (number == m_idleBlock ||
+        (number >= m_firstHighlightedBlock && number <= m_lastHighlightedBlock))
+        return false;
+
+    // highlighted blocks are kept up to date, so that a change of state
+    // is not propagated as deferred blocks through the whole document
+    const int state = currentBlockState();
+    if (!m_isDeferringAll && state != -1 && !(state & DeferredState))
+        return false;
+
+    setCurrentBlockState((qMax(previousBlockState(), 0) & ~DeferredState) |
+                         DeferredState);
+    if (m_nextDeferredBlock == -1 || number < m_nextDeferredBlock)
+        m_nextDeferredBlock = number;
+    if (!m_idleTimer->isActive())
+        m_idleTimer->start();
+    return true;
+}
+
+void SongHighlighter::highlightDeferredBlocks()
+{
+    m_isDeferringAll = false;
+    if (!document() || m_nextDeferredBlock == -1)
+        return;
+
+    QTextBlock block = document()->findBlockByNumber(m_nextDeferredBlock);
+    int count = 0;
+    while (block.isValid() && count < IdleBlockCount) {
+        if (isDeferred(block)) {
+            m_idleBlock = block.blockNumber();
+            rehighlightBlock(block);
+            ++count;
+        }
+        block = block.next();
+    }
+    m_idleBlock = -1;
+
+    if (block.isValid()) {
+        m_nextDeferredBlock = block.blockNumber();
+        m_idleTimer->start();
+    } else {
+        m_nextDeferredBlock = -1;
+    }
+}
+
+void SongHighlighter::rehighlightDocument()
+{
+    if (m_firstHighlightedBlock == -1) {
+        rehighlight();
+        return;
+    }
+
+    // only the highlighted range is processed right away
+    m_isDeferringAll = true;
+    rehighlight();
+    m_isDeferringAll = false;
+}
+
+void SongHighlighter::highlightBlock(const QString &text)
+{
+    if (deferBlock())
+        return;
+
+    // single pass over the block; multi-line options, arguments and
+    // quotes are carried by the block state
+    QList<LatexLexer::Token> tokens;
+    int state = qMax(previousBlockState(), 0) & ~DeferredState;
+    setCurrentBlockState(m_lexer.tokenize(text, state, tokens));
+    foreach (const LatexLexer::Token &token, tokens) {
+        if (const QTextCharFormat *format = tokenFormat(token))
+            setFormat(token.start, token.length, *format);
     }
-    setCurrentBlockState(0);
 
 #ifdef ENABLE_SPELLCHECK
     spellCheck(text);
@@ -191,80 +338,159 @@ void SongHighlighter::highlightBlock(const QString &text)
 #ifdef ENABLE_SPELLCHECK
 void SongHighlighter::spellCheck(const QString &text)
 {
-    if (!m_isSpellCheckActive)
+    if (!m_isSpellCheckActive || !m_checker)
         return;
 
-    QString str = text.simplified();
-    if (str.isEmpty())
-        return;
-
-    QStringList list =
-        str.split(QRegExp("([^\\w,^\\\\]|(?=\\\\))+"), QString::SkipEmptyParts);
-
-    foreach (str, list)
-        if (str.length() > 1 && !str.startsWith('\\') && !checkWord(str)) {
-            int number = text.count(QRegExp("\\b" + str + "\\b"));
-            int line = -1;
-            // underline all incorrect occurrences of misspelled word
-            for (int j = 0; j < number; ++j) {
-                line = text.indexOf(QRegExp("\\b" + str + "\\b"), line + 1);
-                if (line >= 0)
-                    setFormat(line, str.length(), m_spellCheckFormat);
+    // only cached results are applied, unknown words are checked later
+    const QString dictionary = m_checker->dictionary();
+    const int length = text.length();
+    int i = 0;
+    while (i < length) {
+        QChar c = text[i];
+        if (c == '%' && (i == 0 || text[i - 1] != '\\'))
+            break;
+
+        if (c == '\\') {
+            // skip macros and chords
+            int end = i + 1;
+            if (end < length && text[end] == '[') {
+                end = text.indexOf(']', end);
+                end = (end == -1) ? length : end + 1;
+            } else {
+                while (end < length && text[end].isLetter())
+                    ++end;
             }
+            i = qMax(end, i + 1);
+            continue;
+        }
+
+        if (!c.isLetter()) {
+            ++i;
+            continue;
         }
+
+        int end = i + 1;
+        while (end < length && text[end].isLetterOrNumber())
+            ++end;
+        if (end - i > 1) {
+            QString word = text.mid(i, end - i);
+            bool *spelling =
+                m_spellingCache.object(spellingKey(dictionary, word));
+            if (!spelling)
+                m_pendingWords.insert(word);
+            else if (!*spelling)
+                setFormat(i, end - i, m_spellCheckFormat);
+        }
+        i = end;
+    }
+
+    if (!m_pendingWords.isEmpty() && !m_isCheckScheduled) {
+        m_isCheckScheduled = true;
+        QTimer::singleShot(0, this, SLOT(checkPendingWords()));
+    }
 }
 
-bool SongHighlighter::checkWord(const QString &word)
+void SongHighlighter::checkPendingWords()
 {
-    if (!m_codec)
-        return false;
+    m_isCheckScheduled = false;
+    if (!m_checker || m_spellingWatcher->isRunning())
+        return;
 
-    QByteArray encodedString;
-    encodedString = m_codec->fromUnicode(word);
-    return m_checker->spell(encodedString.data());
+    // words queued while the previous task was running may be known now
+    const QString dictionary = m_checker->dictionary();
+    QStringList words;
+    QSet<QString>::iterator it = m_pendingWords.begin();
+    while (it != m_pendingWords.end() && words.size() < MaxCheckedWords) {
+        if (!m_spellingCache.contains(spellingKey(dictionary, *it)))
+            words << *it;
+        it = m_pendingWords.erase(it);
+    }
+    if (words.isEmpty())
+        return;
+
+    m_spellingWatcher->setFuture(
+        QtConcurrent::run(checkWords, m_checker, words));
 }
 
-void SongHighlighter::setDictionary(const QString &filename)
+void SongHighlighter::wordsChecked()
 {
-    if (m_checker) {
-        delete m_checker;
-        m_checker = 0;
+    QHash<QString, bool> spelling = m_spellingWatcher->result();
+
+    bool misspelled = false;
+    QString prefix = m_checker ? spellingKey(m_checker->dictionary(), "")
+                               : QString();
+    QHash<QString, bool>::const_iterator it;
+    for (it = spelling.constBegin(); it != spelling.constEnd(); ++it) {
+        m_spellingCache.insert(it.key(), new bool(it.value()));
+        if (!it.value() && it.key().startsWith(prefix))
+            misspelled = true;
     }
 
-    QFileInfo fi(filename);
-    if (filename.isEmpty() || !fi.exists() || !fi.isReadable()) {
+    if (!m_pendingWords.isEmpty())
+        checkPendingWords();
+
+    // correct words do not change the highlighting
+    if (misspelled)
+        rehighlightDocument();
+}
+
+void SongHighlighter::setDictionary(const QString &filename)
+{
+    if (m_dictionary == filename)
+        return;
+
+    m_dictionary = filename;
+    m_pendingWords.clear();
+
+    DictionaryService *service = DictionaryService::instance();
+    m_checker = service->dictionary(filename);
+    if (!m_checker) {
+        // checked again once the dictionary is loaded
+        connect(service, SIGNAL(dictionaryLoaded(const QString &)), this,
+                SLOT(dictionaryLoaded(const QString &)), Qt::UniqueConnection);
+    } else if (!m_checker->isValid()) {
         qWarning()
             << tr("SongHighlighter::setDictionary cannot open dictionary : ")
             << filename;
-        delete m_checker;
-        m_checker = 0;
-    } else {
-        QString basename =
-            QString("%1/%2").arg(fi.absolutePath()).arg(fi.baseName());
-        m_checker = new Hunspell(QString("%1.aff").arg(basename).toLatin1(),
-                                 QString("%1.dic").arg(basename).toLatin1());
-        QString encoded = QString(m_checker->get_dic_encoding());
-        m_codec = QTextCodec::codecForName(encoded.toLatin1());
+        m_checker.clear();
     }
 
-    rehighlight();
+    rehighlightDocument();
+}
+
+void SongHighlighter::dictionaryLoaded(const QString &dictionary)
+{
+    if (dictionary != m_dictionary || m_checker)
+        return;
+
+    m_checker = DictionaryService::instance()->dictionary(dictionary);
+    if (m_checker && !m_checker->isValid()) {
+        qWarning()
+            << tr("SongHighlighter::setDictionary cannot open dictionary : ")
+            << dictionary;
+        m_checker.clear();
+    }
+
+    if (m_checker && m_isSpellCheckActive)
+        rehighlightDocument();
 }
 
 void SongHighlighter::addWord(const QString &word)
 {
-    QByteArray encodedString;
-    QString encoded = QString(m_checker->get_dic_encoding());
-    QTextCodec *codec = QTextCodec::codecForName(encoded.toLatin1());
-    encodedString = codec->fromUnicode(word);
-    m_checker->add(encodedString.data());
-    rehighlight();
+    if (!m_checker)
+        return;
+
+    m_checker->add(word);
+    m_spellingCache.insert(spellingKey(m_checker->dictionary(), word),
+                           new bool(true));
+    rehighlightDocument();
 }
 
 void SongHighlighter::setSpellCheckActive(const bool value)
 {
     if (m_isSpellCheckActive != value) {
         m_isSpellCheckActive = value;
-        rehighlight();
+        rehighlightDocument();
     }
 }
 
@@ -273,5 +499,5 @@ bool SongHighlighter::isSpellCheckActive() const
     return m_isSpellCheckActive;
 }
 
-Hunspell *SongHighlighter::checker() const { return m_checker; }
+SpellChecker *SongHighlighter::checker() const { return m_checker.data(); }
 #endif // ENABLE_SPELLCHECK
@@ -21,11 +21,18 @@
 
 #include "config.hh"
 #include <QSyntaxHighlighter>
+#include <QCache>
+#include <QFutureWatcher>
 #include <QHash>
+#include <QSet>
+#include <QSharedPointer>
 #include <QTextCharFormat>
 
+#include "latex-lexer.hh"
+
 class QTextDocument;
-class Hunspell;
+class QTimer;
+class SpellChecker;
 
 /**
  * \file song-highlighter.hh
@@ -35,8 +42,17 @@ class Hunspell;
  * Highlights include LaTeX keywords and specific commands provided by the
  * Songs LaTeX package (http://songs.sourceforge.net).
  *
+ * Each block is read once by a LatexLexer; keywords are found through a
+ * perfect hash lookup rather than one regular expression per keyword.
+ *
  * This class is also used by the hunspell spellchecker to underline
- * unrecognized words.
+ * unrecognized words. Words are checked in the background and the
+ * results are kept in a least recently used cache: highlighting a block
+ * only applies cached results and queues the unknown words.
+ *
+ * For large documents, highlighting may be restricted to a range of
+ * blocks (usually the visible ones): the other blocks are marked as
+ * deferred and highlighted a few at a time when the event loop is idle.
  *
  */
 class SongHighlighter : public QSyntaxHighlighter
@@ -49,14 +65,29 @@ public:
     /// Destructor
     ~SongHighlighter();
 
+    /// Restrict the highlighting to the blocks between first and last.
+    /// The other blocks are highlighted later, when idle.
+    /// @param first number of the first block, -1 to highlight all blocks.
+    /// @param last number of the last block.
+    void setHighlightedBlocks(int first, int last);
+
+    /// Defer the highlighting of all the blocks outside of the highlighted
+    /// range, including the already highlighted ones, until the next idle
+    /// time. Used before attaching the highlighter to a large document.
+    void deferHighlighting();
+
+#ifdef ENABLE_SPELLCHECK
     /// Set the dictionary used by the spellchecker.
+    /// The dictionary is provided by the DictionaryService and may
+    /// still be loading, in which case words are checked once it is loaded.
     /// @param filename the .dic file that corresponds to a hunspell dictionary.
     /// Those files are usually located in /usr/share/hunspell/.
     void setDictionary(const QString &filename);
 
     /// Getter on the Hunspell spellchecker.
     /// @return the hunspell spellchecker
-    Hunspell *checker() const;
+    SpellChecker *checker() const;
+#endif // ENABLE_SPELLCHECK
 
 public slots:
 #ifdef ENABLE_SPELLCHECK
@@ -78,21 +109,33 @@ protected:
     /// @param text the text on which the rules should be applied.
     void highlightBlock(const QString &text);
 
+#ifdef ENABLE_SPELLCHECK
     /// Apply spellchecking on a text.
     /// @param text the text on which the spellchecking should be applied.
     void spellCheck(const QString &text);
+#endif // ENABLE_SPELLCHECK
 
-    /// Apply spellchecking on a particular word.
-    /// @param word the word that is to be spellchecked.
-    /// @return true if the word is correctly spelled, false otherwise.
-    bool checkWord(const QString &word);
+private slots:
+    void highlightDeferredBlocks();
+#ifdef ENABLE_SPELLCHECK
+    void checkPendingWords();
+    void wordsChecked();
+    void dictionaryLoaded(const QString &dictionary);
+#endif // ENABLE_SPELLCHECK
 
 private:
-    struct HighlightingRule {
-        QRegExp pattern;
-        QTextCharFormat format;
+    bool deferBlock();
+    void rehighlightDocument();
+
+    enum MacroCategory {
+        KeywordCategory,
+        Keyword2Category,
+        EnvironmentCategory
     };
-    QVector<HighlightingRule> highlightingRules;
+
+    const QTextCharFormat *tokenFormat(const LatexLexer::Token &token) const;
+
+    LatexLexer m_lexer;
 
     QTextCharFormat keywordFormat;
     QTextCharFormat keyword2Format;
@@ -105,19 +148,29 @@ private:
 
     QTextCharFormat multiLineCommentFormat;
 
-    Hunspell *m_checker;
+    // highlighted range in large documents (-1 for the whole document)
+    int m_firstHighlightedBlock;
+    int m_lastHighlightedBlock;
+    bool m_isDeferringAll;
+    int m_nextDeferredBlock;
+    int m_idleBlock;
+    QTimer *m_idleTimer;
+
+#ifdef ENABLE_SPELLCHECK
+    QSharedPointer<SpellChecker> m_checker;
+    QString m_dictionary;
     bool m_isSpellCheckActive;
     QTextCharFormat m_spellCheckFormat;
-    QTextCodec *m_codec;
 
-    const static QRegExp reLaTeXOption;
-    const static QRegExp reLaTeXArgument;
-
-    const static QRegExp reChordsPattern;
-    const static QRegExp reCommentsPattern;
+    // spelling of the words, by dictionary and word
+    QCache<QString, bool> m_spellingCache;
+    QSet<QString> m_pendingWords;
+    QFutureWatcher<QHash<QString, bool> > *m_spellingWatcher;
+    bool m_isCheckScheduled;
+#endif // ENABLE_SPELLCHECK
 
-    const static QStringList _keywordPatterns;
-    const static QStringList _keyword2Patterns;
+    const static QStringList _keywords;
+    const static QStringList _keywords2;
     const static QStringList _delimiters;
 
     const static QColor _keywords1Color;
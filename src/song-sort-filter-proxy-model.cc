@@ -31,6 +31,8 @@ SongSortFilterProxyModel::SongSortFilterProxyModel(QObject *parent)
     , m_languageFilter()
     , m_negativeLanguageFilter()
     , m_keywordFilter()
+    , m_hasChordFilter(false)
+    , m_chordFilter()
 {
 }
 
@@ -48,6 +50,27 @@ void SongSortFilterProxyModel::setFilterString(const QString &filterString)
     m_onlyNotSelected = false;
 
     QString filter = m_filterString;
+
+    // the chord keywords are answered by the chord index of the library
+    m_hasChordFilter = false;
+    m_chordFilter.clear();
+    QRegExp chordFilter("\\bchord(s?):(\\S+)\\s?");
+    const ChordIndex &chordIndex = Library::instance()->chordIndex();
+    int chordPos = 0;
+    while ((chordPos = chordFilter.indexIn(filter, chordPos)) != -1) {
+        QStringList songs =
+            chordFilter.cap(1).isEmpty()
+                ? chordIndex.songsWithChord(chordFilter.cap(2))
+                : chordIndex.songsPlayableWith(
+                      chordFilter.cap(2).split(',', QString::SkipEmptyParts));
+        if (m_hasChordFilter)
+            m_chordFilter.intersect(songs.toSet());
+        else
+            m_chordFilter = songs.toSet();
+        m_hasChordFilter = true;
+        chordPos += chordFilter.matchedLength();
+    }
+    filter.remove(chordFilter);
     if (filter.contains("!:selection")) {
         m_onlyNotSelected = true;
         filter.remove("!:selection");
@@ -59,7 +82,7 @@ void SongSortFilterProxyModel::setFilterString(const QString &filterString)
         // parse the :keyword parameters and create the appropriate filter
         QRegExp langFilter("!?:(\\w{2})\\s?");
         int pos = 0;
-        while ((pos = langFilter.indexIn(m_filterString, pos)) != -1) {
+        while ((pos = langFilter.indexIn(filter, pos)) != -1) {
             QString language = langFilter.cap(1);
             QLocale locale(language);
             if (langFilter.cap(0).startsWith("!")) {
@@ -136,6 +159,11 @@ bool SongSortFilterProxyModel::filterAcceptsRow(
                                           ->data(index, Library::LanguageRole)
                                           .value<QLocale::Language>());
 
+    if (m_hasChordFilter)
+        accept = accept &&
+                 m_chordFilter.contains(
+                     sourceModel()->data(index, Library::PathRole).toString());
+
     if (m_onlySelected)
         accept = accept &&
                  qobject_cast<Songbook *>(sourceModel())->isChecked(index);
@@ -59,7 +59,9 @@ public slots:
     /*!
     Filter the view according to \a filterString.
     A filter string may contain keywords starting with :
-    or negative filters starting with !: (ie :fr or !:en)
+    or negative filters starting with !: (ie :fr or !:en).
+    The chord:Bbm7 keyword keeps the songs playing a chord and
+    chords:C,G,Am,F the songs only playing these chords.
   */
     void setFilterString(const QString &filterString);
 
@@ -156,6 +158,8 @@ private:
     QSet<QLocale::Language> m_languageFilter;
     QSet<QLocale::Language> m_negativeLanguageFilter;
     QStringList m_keywordFilter;
+    bool m_hasChordFilter;
+    QSet<QString> m_chordFilter;
 };
 
 #endif // __SONG_SORT_FILTER_PROXY_MODEL_HH__
@@ -0,0 +1,212 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "song-validator.hh"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QPair>
+#include <QRegExp>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include "chord.hh"
+#include "song.hh"
+
+#include <QDebug>
+
+namespace // anonymous namespace
+{
+SongIssue makeIssue(const QString &path, int line, const QString &message)
+{
+    SongIssue issue;
+    issue.path = path;
+    issue.line = line;
+    issue.message = message;
+    return issue;
+}
+
+void collectIssues(QList<SongIssue> &issues, const QList<SongIssue> &songIssues)
+{
+    issues << songIssues;
+}
+
+// removes the LaTeX comment of a line, if any
+QString stripComment(const QString &line)
+{
+    int index = -1;
+    while ((index = line.indexOf('%', index + 1)) != -1)
+        if (index == 0 || line[index - 1] != '\\')
+            return line.left(index);
+    return line;
+}
+
+// returns true if one of the usual extensions of file exists
+bool fileExists(const QDir &directory, const QString &file,
+                const QStringList &extensions)
+{
+    foreach (const QString &extension, extensions)
+        if (QFile::exists(directory.absoluteFilePath(file + extension)))
+            return true;
+    return false;
+}
+}
+
+QList<SongIssue> SongValidator::validateSong(const QString &path)
+{
+    QList<SongIssue> issues;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        issues << makeIssue(path, 0, tr("unable to read the song"));
+        return issues;
+    }
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    QStringList lines = stream.readAll().split('\n');
+    file.close();
+
+    // QRegExp objects are not reentrant: each call uses its own copies
+    QRegExp reEnvironment("\\\\(begin|end)(\\{([^\\}]+)\\}|"
+                          "song|verse|chorus|scripture)");
+    QRegExp reChordMacro("\\\\[ug]tab\\*?\\{");
+    QRegExp reChordWithFret(Chord::reChordWithFret);
+    QRegExp reChordWithoutFret(Chord::reChordWithoutFret);
+    QRegExp reChordStrings("[0-9Xx]+");
+    QRegExp reCoverName(Song::reCoverName);
+    QRegExp reImage("\\\\image(\\[[^\\]]*\\])?\\{([^\\}]+)\\}");
+
+    QDir directory = QFileInfo(path).absoluteDir();
+    QList<QPair<QString, int> > environments;
+
+    for (int i = 0; i < lines.size(); ++i) {
+        const int number = i + 1;
+        QString line = stripComment(lines[i]);
+        if (!line.contains('\\'))
+            continue;
+
+        // environment balance
+        int index = 0;
+        while ((index = reEnvironment.indexIn(line, index)) != -1) {
+            index += reEnvironment.matchedLength();
+            QString name = reEnvironment.cap(3).isEmpty()
+                               ? reEnvironment.cap(2)
+                               : reEnvironment.cap(3);
+            if (reEnvironment.cap(1) == "begin") {
+                environments << qMakePair(name, number);
+                continue;
+            }
+
+            int open = environments.size() - 1;
+            while (open >= 0 && environments[open].first != name)
+                --open;
+            if (open == -1) {
+                issues << makeIssue(path, number,
+                                    tr("\\end%1 without \\begin%1")
+                                        .arg(reEnvironment.cap(2)));
+                continue;
+            }
+            while (environments.size() > open + 1) {
+                QPair<QString, int> environment = environments.takeLast();
+                issues << makeIssue(
+                    path, environment.second,
+                    tr("\"%1\" is not closed before the end of \"%2\"")
+                        .arg(environment.first)
+                        .arg(name));
+            }
+            environments.removeLast();
+        }
+
+        // chords
+        index = 0;
+        while ((index = reChordMacro.indexIn(line, index)) != -1) {
+            QString chord = line.mid(index);
+            int end = chord.indexOf('}', chord.indexOf('}') + 1);
+            QString text = (end == -1) ? chord : chord.left(end + 1);
+            index += reChordMacro.matchedLength();
+
+            QString strings;
+            if (reChordWithFret.indexIn(text) == 0) {
+                strings = reChordWithFret.cap(3);
+            } else if (reChordWithoutFret.indexIn(QString(text).remove("~:")) ==
+                       0) {
+                strings = reChordWithoutFret.cap(2);
+            } else {
+                issues << makeIssue(path, number,
+                                    tr("invalid chord: %1").arg(text));
+                continue;
+            }
+
+            // fingers may follow the strings: X32010:032010
+            strings = strings.section(':', 0, 0);
+            int count = text.startsWith("\\utab") ? Chord::UkuleleStringCount
+                                                   : Chord::GuitarStringCount;
+            if (!reChordStrings.exactMatch(strings) || strings.size() != count)
+                issues << makeIssue(
+                    path, number,
+                    tr("invalid chord: %1 (%2 strings of 0-9 or X expected)")
+                        .arg(text)
+                        .arg(count));
+        }
+
+        // cover and images
+        if (line.contains("cov=") && reCoverName.indexIn(line) != -1) {
+            QString cover = reCoverName.cap(1).trimmed();
+            if (!fileExists(directory, cover, QStringList()
+                                                  << ""
+                                                  << ".jpg"
+                                                  << ".png"
+                                                  << ".jpeg"))
+                issues << makeIssue(path, number,
+                                    tr("cover not found: %1").arg(cover));
+        }
+        index = 0;
+        while ((index = reImage.indexIn(line, index)) != -1) {
+            index += reImage.matchedLength();
+            QString image = reImage.cap(2).trimmed();
+            if (!fileExists(directory, image, QStringList() << ""
+                                                             << ".jpg"
+                                                             << ".png"
+                                                             << ".pdf"
+                                                             << ".eps"))
+                issues << makeIssue(path, number,
+                                    tr("image not found: %1").arg(image));
+        }
+    }
+
+    // unclosed environments, from the outermost one
+    for (int i = 0; i < environments.size(); ++i) {
+        if (environments[i].first == "song")
+            issues << makeIssue(path, environments[i].second,
+                                tr("\\beginsong without \\endsong"));
+        else
+            issues << makeIssue(path, environments[i].second,
+                                tr("\"%1\" is never closed")
+                                    .arg(environments[i].first));
+    }
+
+    return issues;
+}
+
+QList<SongIssue> SongValidator::validateSongs(const QStringList &paths)
+{
+    return QtConcurrent::blockingMappedReduced<QList<SongIssue> >(
+        paths, &SongValidator::validateSong, collectIssues,
+        QtConcurrent::OrderedReduce);
+}
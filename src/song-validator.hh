@@ -0,0 +1,71 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __SONG_VALIDATOR_HH__
+#define __SONG_VALIDATOR_HH__
+
+#include <QCoreApplication>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/*!
+  \file song-validator.hh
+  \struct SongIssue "song-validator.hh"
+  \brief SongIssue is a problem found in a .sg file
+*/
+struct SongIssue {
+    QString path;    /*!< the path of the .sg file (absolute).*/
+    int line;        /*!< the line of the issue (1-based, 0 if unknown).*/
+    QString message; /*!< the description of the issue.*/
+};
+
+/*!
+  \class SongValidator
+  \brief SongValidator finds the errors of songs before LaTeX does
+
+  The validation is a fast, purely textual check of the .sg files that
+  reports:
+  \li unbalanced environments (\\beginsong/\\endsong, \\beginverse,
+  \\begin{...}/\\end{...} etc.)
+  \li \\gtab and \\utab chords that do not follow the syntax of the
+  Songs LaTeX Package
+  \li covers and images that do not exist
+
+  validateSongs() checks the songs on the global thread pool so that a
+  broken songbook is reported before starting a LaTeX compilation.
+*/
+class SongValidator
+{
+    Q_DECLARE_TR_FUNCTIONS(SongValidator)
+
+public:
+    /*!
+    Returns the issues of the song whose absolute path is \a path.
+    This function is reentrant.
+  */
+    static QList<SongIssue> validateSong(const QString &path);
+
+    /*!
+    Returns the issues of the songs whose absolute paths are \a paths,
+    in the order of \a paths. The songs are checked in parallel.
+  */
+    static QList<SongIssue> validateSongs(const QStringList &paths);
+};
+
+#endif // __SONG_VALIDATOR_HH__
@@ -56,6 +56,66 @@ Song Song::fromFile(const QString &path)
     return Song::fromString(fileStr, path);
 }
 
+Song Song::headerFromFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Song::headerFromFile: unable to open " << path;
+        return headerFromData(QByteArray(), path);
+    }
+
+    // read until the options of \beginsong are closed
+    const int ChunkSize = 4096;
+    QByteArray bytes;
+    int begin = -1;
+    while (!file.atEnd()) {
+        bytes += file.read(ChunkSize);
+        if (begin == -1)
+            begin = bytes.indexOf("\\begin");
+        if (begin != -1 && bytes.indexOf(']', begin) != -1)
+            break;
+    }
+    file.close();
+
+    return headerFromData(bytes, path);
+}
+
+Song Song::headerFromData(const QByteArray &bytes, const QString &path)
+{
+    Song song;
+    song.path = path;
+    song.coverPath = QFileInfo(path).absolutePath();
+    song.isLilypond = false;
+    song.isWebsite = false;
+    song.columnCount = 0;
+    song.capo = 0;
+    song.transpose = 0;
+
+    // QRegExp objects are not reentrant: each call uses its own copies
+    QString text = QString::fromUtf8(bytes.constData(), bytes.size());
+    QRegExp reHeader("\\\\begin\\{?song\\}?\\{([^\\}]+)\\}"
+                     "[^[]*\\[([^]]*)\\]");
+    if (reHeader.indexIn(text) == -1)
+        return song;
+
+    song.title = latexToUtf8(reHeader.cap(1));
+    QString options = reHeader.cap(2);
+
+    QRegExp regexp(reArtist);
+    if (regexp.indexIn(options) != -1)
+        song.artist = latexToUtf8(regexp.cap(1));
+
+    regexp = reAlbum;
+    if (regexp.indexIn(options) != -1)
+        song.album = latexToUtf8(regexp.cap(1));
+
+    regexp = reCoverName;
+    if (regexp.indexIn(options) != -1)
+        song.coverName = regexp.cap(1);
+
+    return song;
+}
+
 Song Song::fromString(const QString &text, const QString &path)
 {
     Song song;
@@ -59,6 +59,23 @@ struct Song {
   */
     static Song fromFile(const QString &path);
 
+    /*!
+    Constructs a Song object with the title, the artist, the album and
+    the cover of the .sg file \a path, without reading the contents of
+    the song. This function is thread-safe.
+    \sa fromFile
+  */
+    static Song headerFromFile(const QString &path);
+
+    /*!
+    Constructs a Song object with the title, the artist, the album and
+    the cover of the contents \a bytes of a .sg file \a path, such as
+    a song read from an archive. This function is thread-safe.
+    \sa headerFromFile
+  */
+    static Song headerFromData(const QByteArray &bytes,
+                               const QString &path = QString());
+
     /*!
     Constructs a Song object whose content is \a text.
     \sa fromString, toString
@@ -21,8 +21,10 @@ from PythonQt import *
 
 # Define global variables
 sb_builder = None
+sb_builder_key = None
 process = None
 stopProcess = False
+buildSucceeded = False
 # logging.basicConfig(level=logging.DEBUG)
 
 # Define locale according to user's parameters
@@ -40,10 +42,39 @@ def testPatacrep():
 def message(text):
     CPPprocess.message(text,0)
 
-# Load songbook and setup datadirs
+# Change the directory where the songbook is built
+def setWorkingDirectory(path):
+    os.chdir(path)
+
+# Identify a songbook setup: the sb file, its datadir and its templates
+def songbookKey(songbook_path, datadir):
+    key = [os.path.abspath(songbook_path), datadir]
+    try:
+        key.append(os.path.getmtime(songbook_path))
+        templates = os.path.join(datadir, 'templates')
+        if os.path.isdir(templates):
+            key.append(os.path.getmtime(templates))
+            for entry in os.scandir(templates):
+                key.append((entry.name, entry.stat().st_mtime))
+    except OSError:
+        return None
+    return tuple(key)
+
+# Forget the loaded songbook so that the next build loads it again
+def invalidateSongbook():
+    global sb_builder
+    global sb_builder_key
+    sb_builder = None
+    sb_builder_key = None
+
+# Load songbook and setup datadirs, unless it is already loaded
 def setupSongbook(songbook_path,datadir):
-    setLocale()
     global sb_builder
+    global sb_builder_key
+    key = songbookKey(songbook_path, datadir)
+    if sb_builder is not None and key is not None and key == sb_builder_key:
+        return
+    invalidateSongbook()
     basename = os.path.basename(songbook_path)[:-3]
     # Load songbook from sb file.
     try:
@@ -80,6 +111,7 @@ def setupSongbook(songbook_path,datadir):
     try:
         sb_builder = SongbookBuilder(songbook, basename)
         sb_builder.unsafe = True
+        sb_builder_key = key
     except errors.SongbookError as error:
         print("Error in formation of Songbook Builder")
         # Deal with error
@@ -88,7 +120,9 @@ def setupSongbook(songbook_path,datadir):
 def build(steps):
     global stopProcess
     global process
+    global buildSucceeded
     stopProcess = False
+    buildSucceeded = False
     process = threading.Thread(target=buildSongbook, args=(steps,))
     try:
         #logger.info('Starting process')
@@ -109,17 +143,23 @@ def build(steps):
         # Check in 2 seconds
         process.join(period)
     message("end build")
+    return buildSucceeded
 
 # Inner function that actually builds the songbook
 def buildSongbook(steps):
     global sb_builder
+    global buildSucceeded
     message("Inner Function Reached")
     sys.stdout.flush()
+    if sb_builder is None:
+        message("Building error: the songbook could not be loaded")
+        return
     try:
         for step in steps:
             message("Building songbook: " + step)
             sb_builder.build_steps([step])
         message("Building finished")
+        buildSucceeded = True
     except errors.SongbookError as error:
         message("Building error")
         # Call proper function in CPPprocess
@@ -130,4 +170,7 @@ def buildSongbook(steps):
 def stopBuild():
     message("Terminating process")
     global stopProcess
-    stopProcess = True
\ No newline at end of file
+    stopProcess = True
+
+# The locale only needs to be set once per interpreter
+setLocale()
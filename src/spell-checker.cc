@@ -0,0 +1,99 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "spell-checker.hh"
+
+#ifdef ENABLE_SPELLCHECK
+
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QTextCodec>
+
+#include "hunspell/hunspell.hxx"
+
+#include <QDebug>
+
+SpellChecker::SpellChecker(const QString &dictionary)
+    : m_dictionary(dictionary)
+    , m_hunspell(0)
+    , m_codec(0)
+    , m_mutex()
+{
+    QFileInfo fi(dictionary);
+    if (dictionary.isEmpty() || !fi.exists() || !fi.isReadable()) {
+        qWarning() << "SpellChecker: cannot open dictionary: " << dictionary;
+        return;
+    }
+
+    QString basename =
+        QString("%1/%2").arg(fi.absolutePath()).arg(fi.baseName());
+    m_hunspell = new Hunspell(QString("%1.aff").arg(basename).toLatin1(),
+                              QString("%1.dic").arg(basename).toLatin1());
+    m_codec = QTextCodec::codecForName(m_hunspell->get_dic_encoding());
+    if (!m_codec)
+        m_codec = QTextCodec::codecForName("UTF-8");
+}
+
+SpellChecker::~SpellChecker() { delete m_hunspell; }
+
+QString SpellChecker::dictionary() const { return m_dictionary; }
+
+bool SpellChecker::isValid() const { return m_hunspell != 0; }
+
+bool SpellChecker::spell(const QString &word)
+{
+    if (!m_hunspell)
+        return true;
+
+    QByteArray encodedString = m_codec->fromUnicode(word);
+    QMutexLocker locker(&m_mutex);
+    return m_hunspell->spell(encodedString.data());
+}
+
+QStringList SpellChecker::suggest(const QString &word)
+{
+    QStringList suggestions;
+    if (!m_hunspell)
+        return suggestions;
+
+    QByteArray encodedString = m_codec->fromUnicode(word);
+    QMutexLocker locker(&m_mutex);
+    if (m_hunspell->spell(encodedString.data()))
+        return suggestions;
+
+    char **list;
+    int count = m_hunspell->suggest(&list, encodedString.data());
+    if (count > 0) {
+        for (int i = 0; i < count; ++i)
+            suggestions << m_codec->toUnicode(list[i]);
+        m_hunspell->free_list(&list, count);
+    }
+    return suggestions;
+}
+
+void SpellChecker::add(const QString &word)
+{
+    if (!m_hunspell)
+        return;
+
+    QByteArray encodedString = m_codec->fromUnicode(word);
+    QMutexLocker locker(&m_mutex);
+    m_hunspell->add(encodedString.data());
+}
+
+#endif // ENABLE_SPELLCHECK
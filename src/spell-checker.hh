@@ -0,0 +1,90 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __SPELL_CHECKER_HH__
+#define __SPELL_CHECKER_HH__
+
+#include "config.hh"
+
+#ifdef ENABLE_SPELLCHECK
+
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+class Hunspell;
+class QTextCodec;
+
+/*!
+  \file spell-checker.hh
+  \class SpellChecker
+  \brief SpellChecker is a thread-safe Hunspell dictionary
+
+  A SpellChecker loads a Hunspell dictionary and converts the words to
+  its encoding. All the functions may be called from any thread, so that
+  words are checked in the background while the editor asks for
+  suggestions.
+*/
+class SpellChecker
+{
+public:
+    /*!
+    Loads the Hunspell \a dictionary (.dic file); the .aff file is
+    expected next to it.
+  */
+    SpellChecker(const QString &dictionary);
+
+    /// Destructor.
+    ~SpellChecker();
+
+    /*!
+    Returns the path of the .dic file of the dictionary.
+  */
+    QString dictionary() const;
+
+    /*!
+    Returns \a true if the dictionary could be loaded.
+  */
+    bool isValid() const;
+
+    /*!
+    Returns \a true if \a word is correctly spelled.
+  */
+    bool spell(const QString &word);
+
+    /*!
+    Returns the suggestions for the misspelled \a word; an empty list
+    if the word is correctly spelled.
+  */
+    QStringList suggest(const QString &word);
+
+    /*!
+    Adds \a word to the dictionary until the end of the session.
+  */
+    void add(const QString &word);
+
+private:
+    QString m_dictionary;
+    Hunspell *m_hunspell;
+    QTextCodec *m_codec;
+    QMutex m_mutex;
+};
+
+#endif // ENABLE_SPELLCHECK
+
+#endif // __SPELL_CHECKER_HH__